@@ -1,39 +1,306 @@
 #include "../ivy.h"
 
 #include <alsa/asoundlib.h>
+#include <errno.h>
+#include <string.h>
 
-audio_device_t audio_open(unsigned int channels, unsigned int sample_rate, float latency_secs)
+#ifndef IVY_ALSA_DEVICE
+#define IVY_ALSA_DEVICE "default"
+#endif // IVY_ALSA_DEVICE
+
+// Frames converted per write when the device is not float, also the
+// most frames audio_begin_write hands out when it can not return
+// device memory directly
+#ifndef IVY_ALSA_STAGING_FRAMES
+#define IVY_ALSA_STAGING_FRAMES 1024
+#endif // IVY_ALSA_STAGING_FRAMES
+
+typedef struct {
+	snd_pcm_t *pcm;
+	snd_pcm_uframes_t buffer_size;
+	bool_t mmap;
+	size_t sample_size;
+	void *staging;
+	float *float_staging;
+	u32_t dither[4];
+
+	// Area handed out by the last snd_pcm_mmap_begin
+	snd_pcm_uframes_t mmap_offset;
+	snd_pcm_uframes_t mmap_frames;
+	u8_t *mmap_area;
+} audio_native_t;
+
+static const struct {
+	snd_pcm_format_t alsa;
+	int format;
+	size_t sample_size;
+} audio_formats[] = {
+	{SND_PCM_FORMAT_FLOAT, IVY_AUDIO_FORMAT_F32, sizeof(float)},
+	{SND_PCM_FORMAT_S32, IVY_AUDIO_FORMAT_S32, sizeof(i32_t)},
+	{SND_PCM_FORMAT_S16, IVY_AUDIO_FORMAT_S16, sizeof(i16_t)},
+};
+
+// Picks the best format the device supports natively
+static int _alsa_pick_format(snd_pcm_t *pcm)
+{
+	snd_pcm_hw_params_t *params;
+	snd_pcm_hw_params_alloca(&params);
+	if (snd_pcm_hw_params_any(pcm, params) < 0) {
+		return 0;
+	}
+	for (size_t i = 0; i < sizeof(audio_formats) / sizeof(audio_formats[0]); i++) {
+		if (snd_pcm_hw_params_test_format(pcm, params, audio_formats[i].alsa) == 0) {
+			return i;
+		}
+	}
+	return 0;
+}
+
+static bool_t _alsa_can_mmap(snd_pcm_t *pcm)
 {
-	audio_device_t audio = {0};
-	unsigned int latency = latency_secs * 1000.0 * 1000.0;
-	if (snd_pcm_open((snd_pcm_t**)&audio.native, "default", SND_PCM_STREAM_PLAYBACK, 0)) {
+	snd_pcm_hw_params_t *params;
+	snd_pcm_hw_params_alloca(&params);
+	return snd_pcm_hw_params_any(pcm, params) >= 0 && snd_pcm_hw_params_test_access(pcm, params, SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0;
+}
+
+void *audio_open_native(audio_device_t *audio, audio_config_t config)
+{
+	unsigned int latency = config.latency_secs * 1000.0 * 1000.0;
+	audio_native_t *native = IVY_CALLOC(1, sizeof(audio_native_t));
+	if (!native) {
+		FATAL("Cannot allocate audio device");
+	}
+	if (snd_pcm_open(&native->pcm, IVY_ALSA_DEVICE, SND_PCM_STREAM_PLAYBACK, 0)) {
 		FATAL("Cannot open audio device");
 	}
-	if (snd_pcm_set_params(audio.native, SND_PCM_FORMAT_U8, SND_PCM_ACCESS_RW_INTERLEAVED, channels,
-						   sample_rate, 1, latency)) {
+
+	native->mmap = (config.flags & IVY_AUDIO_FLAG_MMAP) && _alsa_can_mmap(native->pcm);
+	if ((config.flags & IVY_AUDIO_FLAG_MMAP) && !native->mmap) {
+		WARN("Audio device does not support mmap access, using read/write access");
+	}
+	snd_pcm_access_t access = native->mmap ? SND_PCM_ACCESS_MMAP_INTERLEAVED : SND_PCM_ACCESS_RW_INTERLEAVED;
+
+	int f = _alsa_pick_format(native->pcm);
+	if (snd_pcm_set_params(native->pcm, audio_formats[f].alsa, access, config.channels,
+						   config.sample_rate, 1, latency)) {
 		FATAL("Cannot set audio device params");
 	}
-	return audio;
+	audio->format = audio_formats[f].format;
+	audio->flags = native->mmap ? IVY_AUDIO_FLAG_MMAP : 0;
+	native->sample_size = audio_formats[f].sample_size;
+	snd_pcm_uframes_t period_size;
+	if (snd_pcm_get_params(native->pcm, &native->buffer_size, &period_size) < 0) {
+		native->buffer_size = config.latency_secs * config.sample_rate;
+	}
+
+	native->float_staging = IVY_MALLOC(IVY_ALSA_STAGING_FRAMES * config.channels * sizeof(float));
+	if (!native->float_staging) {
+		FATAL("Cannot allocate audio staging buffer");
+	}
+	if (audio->format != IVY_AUDIO_FORMAT_F32 && !native->mmap) {
+		native->staging = IVY_MALLOC(IVY_ALSA_STAGING_FRAMES * config.channels * native->sample_size);
+		if (!native->staging) {
+			FATAL("Cannot allocate audio conversion buffer");
+		}
+	}
+	native->dither[0] = 0x9e3779b9;
+	native->dither[1] = 0x7f4a7c15;
+	native->dither[2] = 0xc2b2ae35;
+	native->dither[3] = 0x85ebca6b;
+	return native;
+}
+
+// Counts the failure and brings the pcm back, returns 0 when it stays broken
+static bool_t _alsa_recover(audio_device_t *audio, int err)
+{
+	audio_native_t *native = audio->native;
+	if (err == -EPIPE || err == -ESTRPIPE) {
+		audio_stats_xrun(audio);
+	}
+	if (snd_pcm_recover(native->pcm, err, 1) < 0) {
+		WARN("IVY AUDIO: Unable to recover from %s", snd_strerror(err));
+		return 0;
+	}
+	audio_stats_recovery(audio);
+	return 1;
+}
+
+// Samples how far ahead of the speaker the app is, one ioctl per write
+static void _alsa_account(audio_device_t *audio)
+{
+	audio_native_t *native = audio->native;
+	snd_pcm_sframes_t delay;
+	if (snd_pcm_delay(native->pcm, &delay) == 0) {
+		audio_stats_write(audio, delay > 0 ? delay : 0, native->buffer_size);
+	}
 }
 
 int audio_avail_frames(audio_device_t *audio)
 {
-	int n = snd_pcm_avail(audio->native);
+	audio_native_t *native = audio->native;
+	int n = snd_pcm_avail(native->pcm);
 	if (n < 0) {
-		snd_pcm_recover(audio->native, n, 0);
+		if (!_alsa_recover(audio, n)) {
+			return 0;
+		}
+		n = snd_pcm_avail(native->pcm);
 	}
-	return n;
+	return n > 0 ? n : 0;
 }
 
-void audio_write_buffer(audio_device_t *audio, float *buf, size_t buf_size)
+static void _alsa_convert(audio_device_t *audio, void *dst, const float *src, size_t frames)
 {
-	int r = snd_pcm_writei(audio->native, buf, buf_size);
+	audio_native_t *native = audio->native;
+	size_t count = frames * audio->channels;
+	switch (audio->format) {
+	case IVY_AUDIO_FORMAT_S16: audio_f32_to_s16(dst, src, count, native->dither); break;
+	case IVY_AUDIO_FORMAT_S32: audio_f32_to_s32(dst, src, count); break;
+	default: memcpy(dst, src, count * sizeof(float)); break;
+	}
+}
+
+// ---------------------------------------------------------------
+// READ / WRITE ACCESS
+
+static void _alsa_write(audio_device_t *audio, const void *buf, size_t frames)
+{
+	audio_native_t *native = audio->native;
+	_alsa_account(audio);
+	int r = snd_pcm_writei(native->pcm, buf, frames);
 	if (r < 0) {
-		snd_pcm_recover(audio->native, r, 0);
+		_alsa_recover(audio, r);
+	}
+}
+
+static void _alsa_write_rw(audio_device_t *audio, const float *buf, size_t buf_size)
+{
+	audio_native_t *native = audio->native;
+	if (audio->format == IVY_AUDIO_FORMAT_F32) {
+		_alsa_write(audio, buf, buf_size);
+		return;
+	}
+	for (size_t done = 0; done < buf_size; done += IVY_ALSA_STAGING_FRAMES) {
+		size_t frames = buf_size - done < IVY_ALSA_STAGING_FRAMES ? buf_size - done : IVY_ALSA_STAGING_FRAMES;
+		_alsa_convert(audio, native->staging, buf + done * audio->channels, frames);
+		_alsa_write(audio, native->staging, frames);
+	}
+}
+
+// ---------------------------------------------------------------
+// MMAP ACCESS
+
+// Waits for room and maps up to frames frames of the device buffer
+static size_t _alsa_mmap_acquire(audio_device_t *audio, size_t frames)
+{
+	audio_native_t *native = audio->native;
+	snd_pcm_sframes_t avail;
+	for (;;) {
+		avail = snd_pcm_avail_update(native->pcm);
+		if (avail < 0) {
+			if (!_alsa_recover(audio, avail)) {
+				return 0;
+			}
+			continue;
+		}
+		if (avail > 0) {
+			break;
+		}
+		// Buffer is full but the start threshold was never crossed
+		if (snd_pcm_state(native->pcm) == SND_PCM_STATE_PREPARED) {
+			snd_pcm_start(native->pcm);
+		}
+		snd_pcm_wait(native->pcm, 1000);
+	}
+
+	const snd_pcm_channel_area_t *areas;
+	native->mmap_frames = (size_t)avail < frames ? (size_t)avail : frames;
+	int err = snd_pcm_mmap_begin(native->pcm, &areas, &native->mmap_offset, &native->mmap_frames);
+	if (err < 0) {
+		_alsa_recover(audio, err);
+		native->mmap_frames = 0;
+		return 0;
+	}
+	// Interleaved, so every channel shares one area with a frame sized step
+	native->mmap_area = (u8_t *)areas[0].addr + (areas[0].first + native->mmap_offset * areas[0].step) / 8;
+	return native->mmap_frames;
+}
+
+static void _alsa_mmap_commit(audio_device_t *audio, size_t frames)
+{
+	audio_native_t *native = audio->native;
+	_alsa_account(audio);
+	snd_pcm_sframes_t r = snd_pcm_mmap_commit(native->pcm, native->mmap_offset, frames);
+	if (r < 0 || (size_t)r != frames) {
+		_alsa_recover(audio, r >= 0 ? -EPIPE : r);
+	}
+	native->mmap_frames = 0;
+}
+
+static void _alsa_write_mmap(audio_device_t *audio, const float *buf, size_t buf_size)
+{
+	audio_native_t *native = audio->native;
+	size_t done = 0;
+	while (done < buf_size) {
+		size_t frames = _alsa_mmap_acquire(audio, buf_size - done);
+		if (!frames) {
+			return;
+		}
+		// Converts straight into the device buffer, no intermediate copy
+		_alsa_convert(audio, native->mmap_area, buf + done * audio->channels, frames);
+		_alsa_mmap_commit(audio, frames);
+		done += frames;
+	}
+}
+
+void audio_write_buffer(audio_device_t *audio, float *buf, size_t buf_size)
+{
+	audio_native_t *native = audio->native;
+	if (native->mmap) {
+		_alsa_write_mmap(audio, buf, buf_size);
+	} else {
+		_alsa_write_rw(audio, buf, buf_size);
+	}
+}
+
+float *audio_begin_write(audio_device_t *audio, size_t *frames)
+{
+	audio_native_t *native = audio->native;
+	if (!native->mmap) {
+		*frames = *frames < IVY_ALSA_STAGING_FRAMES ? *frames : IVY_ALSA_STAGING_FRAMES;
+		return native->float_staging;
+	}
+	size_t want = *frames;
+	if (audio->format != IVY_AUDIO_FORMAT_F32 && want > IVY_ALSA_STAGING_FRAMES) {
+		want = IVY_ALSA_STAGING_FRAMES;
+	}
+	*frames = _alsa_mmap_acquire(audio, want);
+	if (audio->format == IVY_AUDIO_FORMAT_F32) {
+		return (float *)native->mmap_area;
+	}
+	return native->float_staging;
+}
+
+void audio_end_write(audio_device_t *audio, size_t frames)
+{
+	audio_native_t *native = audio->native;
+	if (!native->mmap) {
+		_alsa_write_rw(audio, native->float_staging, frames);
+		return;
+	}
+	if (frames > native->mmap_frames) {
+		frames = native->mmap_frames;
+	}
+	if (audio->format != IVY_AUDIO_FORMAT_F32) {
+		_alsa_convert(audio, native->mmap_area, native->float_staging, frames);
 	}
+	_alsa_mmap_commit(audio, frames);
 }
 
-void audio_close(audio_device_t *audio)
+void audio_close_native(audio_device_t *audio)
 {
-	snd_pcm_close(audio->native);
+	audio_native_t *native = audio->native;
+	snd_pcm_close(native->pcm);
+	IVY_FREE(native->staging);
+	IVY_FREE(native->float_staging);
+	IVY_FREE(native);
 }
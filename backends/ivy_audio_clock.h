@@ -0,0 +1,73 @@
+#ifndef IVY_AUDIO_CLOCK_H
+#define IVY_AUDIO_CLOCK_H
+
+// Simulated device buffer drained at the real time rate, shared by the
+// audio backends that have no hardware to pace them
+
+#include <time.h>
+
+typedef struct {
+	unsigned int sample_rate;
+	// Size of the simulated device buffer in frames
+	size_t capacity;
+	u64_t start_ns;
+	u64_t written;
+} audio_clock_t;
+
+static inline u64_t _audio_clock_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline void _audio_clock_init(audio_clock_t *clock, unsigned int sample_rate, float latency_secs)
+{
+	clock->sample_rate = sample_rate;
+	clock->capacity = latency_secs * sample_rate;
+	if (clock->capacity < 1) {
+		clock->capacity = 1;
+	}
+	clock->start_ns = _audio_clock_now();
+	clock->written = 0;
+}
+
+// Frames still queued, a buffer that ran dry is an underrun and playback
+// restarts from the next write, like a recovered device would
+static inline size_t _audio_clock_queued(audio_device_t *audio, audio_clock_t *clock)
+{
+	u64_t played = (_audio_clock_now() - clock->start_ns) * clock->sample_rate / 1000000000ull;
+	if (played >= clock->written) {
+		if (played > clock->written && clock->written) {
+			audio_stats_xrun(audio);
+			audio_stats_recovery(audio);
+		}
+		clock->start_ns = _audio_clock_now();
+		clock->written = 0;
+		return 0;
+	}
+	return clock->written - played;
+}
+
+static inline size_t _audio_clock_avail(audio_device_t *audio, audio_clock_t *clock)
+{
+	size_t queued = _audio_clock_queued(audio, clock);
+	return queued < clock->capacity ? clock->capacity - queued : 0;
+}
+
+// Blocks until frames frames fit, then counts them as written
+static inline void _audio_clock_write(audio_device_t *audio, audio_clock_t *clock, size_t frames)
+{
+	size_t want = frames < clock->capacity ? frames : clock->capacity;
+	size_t queued = _audio_clock_queued(audio, clock);
+	size_t avail = queued < clock->capacity ? clock->capacity - queued : 0;
+	audio_stats_write(audio, queued, clock->capacity);
+	if (avail < want) {
+		u64_t ns = (u64_t)(want - avail) * 1000000000ull / clock->sample_rate;
+		struct timespec ts = {ns / 1000000000ull, ns % 1000000000ull};
+		nanosleep(&ts, NULL);
+	}
+	clock->written += frames;
+}
+
+#endif // IVY_AUDIO_CLOCK_H
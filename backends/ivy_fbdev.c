@@ -0,0 +1,578 @@
+#include "../ivy.h"
+
+#include <fcntl.h>
+#include <linux/fb.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Framebuffer device, can also be a regular file acting as a fake device
+#ifndef IVY_FBDEV_PATH
+#define IVY_FBDEV_PATH "/dev/fb0"
+#endif // IVY_FBDEV_PATH
+
+#ifndef IVY_FBDEV_MAX_INPUTS
+#define IVY_FBDEV_MAX_INPUTS 16
+#endif // IVY_FBDEV_MAX_INPUTS
+
+typedef struct {
+	int fd;
+	bool_t is_file;
+	u8_t *mem;
+	size_t mem_size;
+
+	int width, height;
+	int stride; // in bytes
+	int pages;	// 2 when we can page flip
+	int back;
+
+	// Pixels are rendered straight into the back page unless the line
+	// length of the device does not match, then we copy on present
+	bool_t direct;
+
+	struct fb_var_screeninfo vinfo;
+	struct fb_var_screeninfo vinfo_orig;
+
+	int inputs[IVY_FBDEV_MAX_INPUTS];
+	int inputs_count;
+	int mouse_x, mouse_y;
+	bool_t mouse_moved;
+	int mods;
+} window_native_t;
+
+static int _fbdev_get_mapped_key(int code);
+static int _fbdev_get_mod(int code);
+static int _fbdev_lookup_text(window_native_t *native, int code, char *text, int size);
+
+static pixel_t *_fbdev_page(window_native_t *native, int page)
+{
+	return (pixel_t *)(native->mem + (size_t)page * native->height * native->stride);
+}
+
+static void _fbdev_attach_pixels(window_context_t *wnd, window_native_t *native)
+{
+	pixel_array_t *pixels = &wnd->pixels;
+	if (pixels->width != native->width || pixels->height != native->height) {
+		gfx_resize(pixels, native->width, native->height);
+	}
+	if (!native->direct) {
+		return;
+	}
+	if (!pixels->external) {
+		IVY_FREE(pixels->buffer);
+	}
+	pixels->buffer = _fbdev_page(native, native->back);
+	pixels->max_size = native->width * native->height;
+	pixels->external = 1;
+}
+
+static int _fbdev_open_device(window_native_t *native, const char *path, u32_t width, u32_t height)
+{
+	native->fd = open(path, O_RDWR | O_CLOEXEC);
+	if (native->fd < 0) {
+		WARN("IVY_FBDEV: Unable to open [%s]", path);
+		return 0;
+	}
+
+	struct stat st;
+	if (fstat(native->fd, &st) == 0 && S_ISREG(st.st_mode)) {
+		// Fake device, two XRGB8888 pages of the requested size back to back
+		native->is_file = 1;
+		native->width = width;
+		native->height = height;
+		native->stride = width * sizeof(pixel_t);
+		native->pages = 2;
+		native->mem_size = (size_t)native->stride * height * native->pages;
+		if (ftruncate(native->fd, native->mem_size) < 0) {
+			WARN("IVY_FBDEV: Unable to resize [%s]", path);
+			return 0;
+		}
+		return 1;
+	}
+
+	struct fb_fix_screeninfo finfo;
+	if (ioctl(native->fd, FBIOGET_VSCREENINFO, &native->vinfo) < 0 || ioctl(native->fd, FBIOGET_FSCREENINFO, &finfo) < 0) {
+		WARN("IVY_FBDEV: [%s] is not a framebuffer device", path);
+		return 0;
+	}
+	native->vinfo_orig = native->vinfo;
+
+	// Ask for a virtual screen twice the height so we can pan between pages
+	native->vinfo.bits_per_pixel = 32;
+	native->vinfo.xres_virtual = native->vinfo.xres;
+	native->vinfo.yres_virtual = native->vinfo.yres * 2;
+	native->vinfo.xoffset = 0;
+	native->vinfo.yoffset = 0;
+	if (ioctl(native->fd, FBIOPUT_VSCREENINFO, &native->vinfo) < 0) {
+		native->vinfo = native->vinfo_orig;
+	}
+	ioctl(native->fd, FBIOGET_VSCREENINFO, &native->vinfo);
+	ioctl(native->fd, FBIOGET_FSCREENINFO, &finfo);
+
+	if (native->vinfo.bits_per_pixel != 32) {
+		WARN("IVY_FBDEV: Only 32 bits per pixel is supported, device uses %u", native->vinfo.bits_per_pixel);
+		ioctl(native->fd, FBIOPUT_VSCREENINFO, &native->vinfo_orig);
+		return 0;
+	}
+	// Pixels are written as they are, so the channels must sit where
+	// pixel_t keeps them. BGR or 10 bit layouts would show wrong colors
+	const struct fb_var_screeninfo *v = &native->vinfo;
+	if (v->red.offset != 16 || v->red.length != 8 || v->green.offset != 8 || v->green.length != 8 || v->blue.offset != 0 || v->blue.length != 8) {
+		WARN("IVY_FBDEV: Only XRGB8888 is supported, device uses red %u:%u green %u:%u blue %u:%u (offset:length)", v->red.offset,
+			 v->red.length, v->green.offset, v->green.length, v->blue.offset, v->blue.length);
+		ioctl(native->fd, FBIOPUT_VSCREENINFO, &native->vinfo_orig);
+		return 0;
+	}
+
+	native->width = native->vinfo.xres;
+	native->height = native->vinfo.yres;
+	native->stride = finfo.line_length;
+	native->pages = native->vinfo.yres_virtual >= native->vinfo.yres * 2 ? 2 : 1;
+	native->mem_size = finfo.smem_len;
+	if ((size_t)native->stride * native->height * native->pages > native->mem_size) {
+		native->pages = 1;
+	}
+	if (native->pages == 1) {
+		WARN("IVY_FBDEV: Device can not pan, rendering without page flips");
+	}
+	return 1;
+}
+
+static void _fbdev_open_inputs(window_native_t *native)
+{
+	// IVY_FBDEV_INPUT can list evdev devices separated by ':'
+	// otherwise every readable /dev/input/event* device is used
+	const char *list = getenv("IVY_FBDEV_INPUT");
+	char path[256];
+	if (list) {
+		while (*list && native->inputs_count < IVY_FBDEV_MAX_INPUTS) {
+			size_t len = strcspn(list, ":");
+			if (len > 0 && len < sizeof(path)) {
+				memcpy(path, list, len);
+				path[len] = '\0';
+				int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+				if (fd >= 0) {
+					native->inputs[native->inputs_count++] = fd;
+				} else {
+					WARN("IVY_FBDEV: Unable to open input [%s]", path);
+				}
+			}
+			list += len + (list[len] == ':');
+		}
+		return;
+	}
+	for (int i = 0; i < 64 && native->inputs_count < IVY_FBDEV_MAX_INPUTS; i++) {
+		snprintf(path, sizeof(path), "/dev/input/event%d", i);
+		int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+		if (fd >= 0) {
+			native->inputs[native->inputs_count++] = fd;
+		}
+	}
+}
+
+void *wnd_create_native(window_context_t *wnd, u32_t width, u32_t height, const char *title)
+{
+	(void)title;
+	window_native_t *native = IVY_CALLOC(1, sizeof(window_native_t));
+	if (!native) {
+		WARN("IVY_FBDEV: Unable to allocate memory");
+		return NULL;
+	}
+
+	const char *path = getenv("IVY_FBDEV");
+	if (!path) {
+		path = IVY_FBDEV_PATH;
+	}
+	if (!_fbdev_open_device(native, path, width, height)) {
+		if (native->fd >= 0) {
+			close(native->fd);
+		}
+		IVY_FREE(native);
+		return NULL;
+	}
+
+	native->mem = mmap(NULL, native->mem_size, PROT_READ | PROT_WRITE, MAP_SHARED, native->fd, 0);
+	if (native->mem == MAP_FAILED) {
+		WARN("IVY_FBDEV: Unable to map [%s]", path);
+		close(native->fd);
+		IVY_FREE(native);
+		return NULL;
+	}
+
+	native->direct = native->stride == native->width * (int)sizeof(pixel_t);
+	native->back = native->pages > 1 ? 1 : 0;
+	_fbdev_attach_pixels(wnd, native);
+
+	_fbdev_open_inputs(native);
+	native->mouse_x = native->width / 2;
+	native->mouse_y = native->height / 2;
+	return native;
+}
+
+int wnd_update_native(window_context_t *wnd)
+{
+	window_native_t *native = wnd->native;
+	pixel_array_t *pixels = &wnd->pixels;
+
+	if (!native->direct) {
+		pixel_t *dst = _fbdev_page(native, native->back);
+		for (int y = 0; y < native->height; y++) {
+			memcpy((u8_t *)dst + (size_t)y * native->stride, pixels->buffer + y * pixels->width, native->width * sizeof(pixel_t));
+		}
+	}
+	if (native->pages < 2) {
+		return wnd->is_closed;
+	}
+
+	// Flip, the driver shows the new page at the next vertical blank
+	if (!native->is_file) {
+		native->vinfo.yoffset = native->back * native->height;
+		if (ioctl(native->fd, FBIOPAN_DISPLAY, &native->vinfo) == 0) {
+			int crtc = 0;
+			ioctl(native->fd, FBIO_WAITFORVSYNC, &crtc);
+		}
+	}
+	native->back = 1 - native->back;
+	if (native->direct) {
+		// The new back page still holds the frame before, carry over the
+		// one just presented so the pixels keep what the application drew
+		pixel_t *presented = _fbdev_page(native, 1 - native->back);
+		pixels->buffer = _fbdev_page(native, native->back);
+		memcpy(pixels->buffer, presented, (size_t)native->height * native->stride);
+	}
+	return wnd->is_closed;
+}
+
+// Returns how many events were pushed
+static int _fbdev_translate_event(window_context_t *wnd, window_native_t *native, const struct input_event *iev)
+{
+	int count = 0;
+	wnd_event_t e = {
+		.timestamp_ns = (u64_t)iev->input_event_sec * 1000000000ull + (u64_t)iev->input_event_usec * 1000ull,
+	};
+	switch (iev->type) {
+	case EV_KEY: {
+		int mod = _fbdev_get_mod(iev->code);
+		if (mod) {
+			native->mods = iev->value ? native->mods | mod : native->mods & ~mod;
+		}
+		// Lock keys toggle on the first press, repeats (value 2) do not
+		if (iev->value == 1 && iev->code == KEY_CAPSLOCK) {
+			native->mods ^= IVY_MOD_MASK_CAPS_LOCK;
+		} else if (iev->value == 1 && iev->code == KEY_NUMLOCK) {
+			native->mods ^= IVY_MOD_MASK_NUM_LOCK;
+		}
+		e.type = iev->value ? IVY_EVENT_KEY_PRESS : IVY_EVENT_KEY_RELEASE;
+		e.key = _fbdev_get_mapped_key(iev->code);
+		e.mods = native->mods;
+		// Presses and repeats also produce text, like X11 does
+		if (iev->value) {
+			wnd_push_event(wnd, &e);
+			count++;
+			e.text_len = _fbdev_lookup_text(native, iev->code, e.text, sizeof(e.text));
+			e.type = e.text_len ? IVY_EVENT_TEXT_INPUT : IVY_EVENT_NONE;
+		}
+	} break;
+	case EV_REL: {
+		if (iev->code == REL_X) {
+			native->mouse_x += iev->value;
+			native->mouse_moved = 1;
+		} else if (iev->code == REL_Y) {
+			native->mouse_y += iev->value;
+			native->mouse_moved = 1;
+		} else if (iev->code == REL_WHEEL && iev->value) {
+			// Report scrolling as button 4/5 clicks like X11 does
+			e.type = IVY_EVENT_KEY_PRESS;
+			e.key = iev->value > 0 ? IVY_KEY_BUTTON_4 : IVY_KEY_BUTTON_5;
+			e.mods = native->mods;
+			wnd_push_event(wnd, &e);
+			count++;
+			e.type = IVY_EVENT_KEY_RELEASE;
+		}
+	} break;
+	case EV_SYN: {
+		if (iev->code == SYN_REPORT && native->mouse_moved) {
+			native->mouse_x = native->mouse_x < 0 ? 0 : (native->mouse_x >= native->width ? native->width - 1 : native->mouse_x);
+			native->mouse_y = native->mouse_y < 0 ? 0 : (native->mouse_y >= native->height ? native->height - 1 : native->mouse_y);
+			native->mouse_moved = 0;
+			e.type = IVY_EVENT_MOUSE_MOVE;
+			e.x = native->mouse_x;
+			e.y = native->mouse_y;
+		}
+	} break;
+	default:
+		break;
+	}
+
+	if (e.type != IVY_EVENT_NONE) {
+		wnd_push_event(wnd, &e);
+		count++;
+	}
+	return count;
+}
+
+int wnd_poll_events_native(window_context_t *wnd, int timeout_ms)
+{
+	window_native_t *native = wnd->native;
+	if (!native->inputs_count) {
+		if (timeout_ms > 0) {
+			poll(NULL, 0, timeout_ms);
+		}
+		return 0;
+	}
+
+	struct pollfd pfds[IVY_FBDEV_MAX_INPUTS];
+	for (int i = 0; i < native->inputs_count; i++) {
+		pfds[i] = (struct pollfd){.fd = native->inputs[i], .events = POLLIN};
+	}
+	if (poll(pfds, native->inputs_count, timeout_ms) <= 0) {
+		return 0;
+	}
+
+	int count = 0;
+	struct input_event iev[64];
+	for (int i = 0; i < native->inputs_count; i++) {
+		if (!(pfds[i].revents & POLLIN)) {
+			continue;
+		}
+		ssize_t n;
+		while ((n = read(native->inputs[i], iev, sizeof(iev))) > 0) {
+			for (size_t j = 0; j < n / sizeof(iev[0]); j++) {
+				count += _fbdev_translate_event(wnd, native, &iev[j]);
+			}
+		}
+	}
+	return count;
+}
+
+void wnd_resize_native(window_context_t *wnd, int width, int height)
+{
+	// Scanout size is fixed by the video mode
+	(void)wnd, (void)width, (void)height;
+}
+
+void wnd_destroy_native(window_context_t *wnd)
+{
+	window_native_t *native = wnd->native;
+	for (int i = 0; i < native->inputs_count; i++) {
+		close(native->inputs[i]);
+	}
+	munmap(native->mem, native->mem_size);
+	if (!native->is_file) {
+		ioctl(native->fd, FBIOPUT_VSCREENINFO, &native->vinfo_orig);
+	}
+	close(native->fd);
+	IVY_FREE(native);
+}
+
+static int _fbdev_get_mod(int code)
+{
+	switch (code) {
+	case KEY_LEFTSHIFT:
+	case KEY_RIGHTSHIFT:
+		return IVY_MOD_MASK_SHIFT;
+	case KEY_LEFTCTRL:
+	case KEY_RIGHTCTRL:
+		return IVY_MOD_MASK_CONTROL;
+	case KEY_LEFTALT:
+	case KEY_RIGHTALT:
+		return IVY_MOD_MASK_ALT;
+	case KEY_LEFTMETA:
+	case KEY_RIGHTMETA:
+		return IVY_MOD_MASK_SUPER;
+	default:
+		return 0;
+	}
+}
+
+// US layout, unshifted and shifted, evdev codes carry no keymap
+// clang-format off
+static const char fbdev_text_us[KEY_DELETE + 1][2] = {
+	[KEY_1] = {'1', '!'}, [KEY_2] = {'2', '@'}, [KEY_3] = {'3', '#'}, [KEY_4] = {'4', '$'},
+	[KEY_5] = {'5', '%'}, [KEY_6] = {'6', '^'}, [KEY_7] = {'7', '&'}, [KEY_8] = {'8', '*'},
+	[KEY_9] = {'9', '('}, [KEY_0] = {'0', ')'}, [KEY_MINUS] = {'-', '_'}, [KEY_EQUAL] = {'=', '+'},
+	[KEY_Q] = {'q', 'Q'}, [KEY_W] = {'w', 'W'}, [KEY_E] = {'e', 'E'}, [KEY_R] = {'r', 'R'},
+	[KEY_T] = {'t', 'T'}, [KEY_Y] = {'y', 'Y'}, [KEY_U] = {'u', 'U'}, [KEY_I] = {'i', 'I'},
+	[KEY_O] = {'o', 'O'}, [KEY_P] = {'p', 'P'}, [KEY_LEFTBRACE] = {'[', '{'}, [KEY_RIGHTBRACE] = {']', '}'},
+	[KEY_A] = {'a', 'A'}, [KEY_S] = {'s', 'S'}, [KEY_D] = {'d', 'D'}, [KEY_F] = {'f', 'F'},
+	[KEY_G] = {'g', 'G'}, [KEY_H] = {'h', 'H'}, [KEY_J] = {'j', 'J'}, [KEY_K] = {'k', 'K'},
+	[KEY_L] = {'l', 'L'}, [KEY_SEMICOLON] = {';', ':'}, [KEY_APOSTROPHE] = {'\'', '"'}, [KEY_GRAVE] = {'`', '~'},
+	[KEY_BACKSLASH] = {'\\', '|'}, [KEY_Z] = {'z', 'Z'}, [KEY_X] = {'x', 'X'}, [KEY_C] = {'c', 'C'},
+	[KEY_V] = {'v', 'V'}, [KEY_B] = {'b', 'B'}, [KEY_N] = {'n', 'N'}, [KEY_M] = {'m', 'M'},
+	[KEY_COMMA] = {',', '<'}, [KEY_DOT] = {'.', '>'}, [KEY_SLASH] = {'/', '?'}, [KEY_SPACE] = {' ', ' '},
+	[KEY_102ND] = {'<', '>'},
+
+	[KEY_KP0] = {'0', '0'}, [KEY_KP1] = {'1', '1'}, [KEY_KP2] = {'2', '2'}, [KEY_KP3] = {'3', '3'},
+	[KEY_KP4] = {'4', '4'}, [KEY_KP5] = {'5', '5'}, [KEY_KP6] = {'6', '6'}, [KEY_KP7] = {'7', '7'},
+	[KEY_KP8] = {'8', '8'}, [KEY_KP9] = {'9', '9'}, [KEY_KPDOT] = {'.', '.'},
+	[KEY_KPSLASH] = {'/', '/'}, [KEY_KPASTERISK] = {'*', '*'}, [KEY_KPMINUS] = {'-', '-'}, [KEY_KPPLUS] = {'+', '+'},
+
+	// Control characters XLookupString also returns
+	[KEY_ESC] = {0x1b, 0x1b}, [KEY_BACKSPACE] = {'\b', '\b'}, [KEY_TAB] = {'\t', '\t'}, [KEY_ENTER] = {'\r', '\r'},
+	[KEY_KPENTER] = {'\r', '\r'}, [KEY_DELETE] = {0x7f, 0x7f},
+};
+// clang-format on
+
+static bool_t _fbdev_is_keypad_number(int code)
+{
+	return (code >= KEY_KP7 && code <= KEY_KPDOT && code != KEY_KPMINUS && code != KEY_KPPLUS);
+}
+
+static int _fbdev_lookup_text(window_native_t *native, int code, char *text, int size)
+{
+	// Control combinations are shortcuts, not text
+	if (code < 0 || code > KEY_DELETE || size < 2 || (native->mods & (IVY_MOD_MASK_CONTROL | IVY_MOD_MASK_ALT | IVY_MOD_MASK_SUPER))) {
+		return 0;
+	}
+	bool_t shift = (native->mods & IVY_MOD_MASK_SHIFT) != 0;
+	const char *keys = fbdev_text_us[code];
+	// Caps lock only shifts letters, keypad numbers need num lock which
+	// shift inverts
+	if (keys[0] >= 'a' && keys[0] <= 'z' && (native->mods & IVY_MOD_MASK_CAPS_LOCK)) {
+		shift = !shift;
+	}
+	if (_fbdev_is_keypad_number(code) && ((native->mods & IVY_MOD_MASK_NUM_LOCK) != 0) == shift) {
+		return 0;
+	}
+	text[0] = keys[shift];
+	text[1] = '\0';
+	return text[0] != 0;
+}
+
+// clang-format off
+static int _fbdev_get_mapped_key(int code)
+{
+	switch(code)
+	{
+		case BTN_LEFT:          return IVY_KEY_BUTTON_1;
+		case BTN_MIDDLE:        return IVY_KEY_BUTTON_2;
+		case BTN_RIGHT:         return IVY_KEY_BUTTON_3;
+
+		case KEY_ESC:           return IVY_KEY_ESCAPE;
+		case KEY_TAB:           return IVY_KEY_TAB;
+		case KEY_LEFTSHIFT:     return IVY_KEY_LEFT_SHIFT;
+		case KEY_RIGHTSHIFT:    return IVY_KEY_RIGHT_SHIFT;
+		case KEY_LEFTCTRL:      return IVY_KEY_LEFT_CONTROL;
+		case KEY_RIGHTCTRL:     return IVY_KEY_RIGHT_CONTROL;
+		case KEY_LEFTALT:       return IVY_KEY_LEFT_ALT;
+		case KEY_RIGHTALT:      return IVY_KEY_RIGHT_ALT;
+		case KEY_LEFTMETA:      return IVY_KEY_LEFT_SUPER;
+		case KEY_RIGHTMETA:     return IVY_KEY_RIGHT_SUPER;
+		case KEY_COMPOSE:       return IVY_KEY_MENU;
+		case KEY_NUMLOCK:       return IVY_KEY_NUM_LOCK;
+		case KEY_CAPSLOCK:      return IVY_KEY_CAPS_LOCK;
+		case KEY_SYSRQ:         return IVY_KEY_PRINT_SCREEN;
+		case KEY_SCROLLLOCK:    return IVY_KEY_SCROLL_LOCK;
+		case KEY_PAUSE:         return IVY_KEY_PAUSE;
+		case KEY_DELETE:        return IVY_KEY_DELETE;
+		case KEY_BACKSPACE:     return IVY_KEY_BACKSPACE;
+		case KEY_ENTER:         return IVY_KEY_ENTER;
+		case KEY_HOME:          return IVY_KEY_HOME;
+		case KEY_END:           return IVY_KEY_END;
+		case KEY_PAGEUP:        return IVY_KEY_PAGE_UP;
+		case KEY_PAGEDOWN:      return IVY_KEY_PAGE_DOWN;
+		case KEY_INSERT:        return IVY_KEY_INSERT;
+		case KEY_LEFT:          return IVY_KEY_LEFT;
+		case KEY_RIGHT:         return IVY_KEY_RIGHT;
+		case KEY_DOWN:          return IVY_KEY_DOWN;
+		case KEY_UP:            return IVY_KEY_UP;
+		case KEY_F1:            return IVY_KEY_F1;
+		case KEY_F2:            return IVY_KEY_F2;
+		case KEY_F3:            return IVY_KEY_F3;
+		case KEY_F4:            return IVY_KEY_F4;
+		case KEY_F5:            return IVY_KEY_F5;
+		case KEY_F6:            return IVY_KEY_F6;
+		case KEY_F7:            return IVY_KEY_F7;
+		case KEY_F8:            return IVY_KEY_F8;
+		case KEY_F9:            return IVY_KEY_F9;
+		case KEY_F10:           return IVY_KEY_F10;
+		case KEY_F11:           return IVY_KEY_F11;
+		case KEY_F12:           return IVY_KEY_F12;
+		case KEY_F13:           return IVY_KEY_F13;
+		case KEY_F14:           return IVY_KEY_F14;
+		case KEY_F15:           return IVY_KEY_F15;
+		case KEY_F16:           return IVY_KEY_F16;
+		case KEY_F17:           return IVY_KEY_F17;
+		case KEY_F18:           return IVY_KEY_F18;
+		case KEY_F19:           return IVY_KEY_F19;
+		case KEY_F20:           return IVY_KEY_F20;
+		case KEY_F21:           return IVY_KEY_F21;
+		case KEY_F22:           return IVY_KEY_F22;
+		case KEY_F23:           return IVY_KEY_F23;
+		case KEY_F24:           return IVY_KEY_F24;
+
+		case KEY_KPSLASH:       return IVY_KEY_KP_DIVIDE;
+		case KEY_KPASTERISK:    return IVY_KEY_KP_MULTIPLY;
+		case KEY_KPMINUS:       return IVY_KEY_KP_SUBTRACT;
+		case KEY_KPPLUS:        return IVY_KEY_KP_ADD;
+
+		case KEY_KP0:           return IVY_KEY_KP_0;
+		case KEY_KP1:           return IVY_KEY_KP_1;
+		case KEY_KP2:           return IVY_KEY_KP_2;
+		case KEY_KP3:           return IVY_KEY_KP_3;
+		case KEY_KP4:           return IVY_KEY_KP_4;
+		case KEY_KP6:           return IVY_KEY_KP_6;
+		case KEY_KP7:           return IVY_KEY_KP_7;
+		case KEY_KP8:           return IVY_KEY_KP_8;
+		case KEY_KP9:           return IVY_KEY_KP_9;
+		case KEY_KPDOT:         return IVY_KEY_KP_DECIMAL;
+		case KEY_KPEQUAL:       return IVY_KEY_KP_EQUAL;
+		case KEY_KPENTER:       return IVY_KEY_KP_ENTER;
+
+		case KEY_A:             return IVY_KEY_A;
+		case KEY_B:             return IVY_KEY_B;
+		case KEY_C:             return IVY_KEY_C;
+		case KEY_D:             return IVY_KEY_D;
+		case KEY_E:             return IVY_KEY_E;
+		case KEY_F:             return IVY_KEY_F;
+		case KEY_G:             return IVY_KEY_G;
+		case KEY_H:             return IVY_KEY_H;
+		case KEY_I:             return IVY_KEY_I;
+		case KEY_J:             return IVY_KEY_J;
+		case KEY_K:             return IVY_KEY_K;
+		case KEY_L:             return IVY_KEY_L;
+		case KEY_M:             return IVY_KEY_M;
+		case KEY_N:             return IVY_KEY_N;
+		case KEY_O:             return IVY_KEY_O;
+		case KEY_P:             return IVY_KEY_P;
+		case KEY_Q:             return IVY_KEY_Q;
+		case KEY_R:             return IVY_KEY_R;
+		case KEY_S:             return IVY_KEY_S;
+		case KEY_T:             return IVY_KEY_T;
+		case KEY_U:             return IVY_KEY_U;
+		case KEY_V:             return IVY_KEY_V;
+		case KEY_W:             return IVY_KEY_W;
+		case KEY_X:             return IVY_KEY_X;
+		case KEY_Y:             return IVY_KEY_Y;
+		case KEY_Z:             return IVY_KEY_Z;
+		case KEY_1:             return IVY_KEY_1;
+		case KEY_2:             return IVY_KEY_2;
+		case KEY_3:             return IVY_KEY_3;
+		case KEY_4:             return IVY_KEY_4;
+		case KEY_5:             return IVY_KEY_5;
+		case KEY_6:             return IVY_KEY_6;
+		case KEY_7:             return IVY_KEY_7;
+		case KEY_8:             return IVY_KEY_8;
+		case KEY_9:             return IVY_KEY_9;
+		case KEY_0:             return IVY_KEY_0;
+		case KEY_SPACE:         return IVY_KEY_SPACE;
+		case KEY_MINUS:         return IVY_KEY_MINUS;
+		case KEY_EQUAL:         return IVY_KEY_EQUAL;
+		case KEY_LEFTBRACE:     return IVY_KEY_LEFT_BRACKET;
+		case KEY_RIGHTBRACE:    return IVY_KEY_RIGHT_BRACKET;
+		case KEY_BACKSLASH:     return IVY_KEY_BACKSLASH;
+		case KEY_SEMICOLON:     return IVY_KEY_SEMICOLON;
+		case KEY_APOSTROPHE:    return IVY_KEY_APOSTROPHE;
+		case KEY_GRAVE:         return IVY_KEY_GRAVE_ACCENT;
+		case KEY_COMMA:         return IVY_KEY_COMMA;
+		case KEY_DOT:           return IVY_KEY_PERIOD;
+		case KEY_SLASH:         return IVY_KEY_SLASH;
+		case KEY_102ND:         return IVY_KEY_WORLD_1;
+		default:                return IVY_KEY_INVALID;
+	}
+}
+// clang-format on
@@ -0,0 +1,40 @@
+#include "../ivy.h"
+
+#include <poll.h>
+
+// Offscreen window, frames stay in wnd->pixels and are never presented
+// Useful for batch rendering on machines without a display
+
+// There is no native state, wnd_create only needs a handle that is not NULL
+static char headless_native;
+
+void *wnd_create_native(window_context_t *wnd, u32_t width, u32_t height, const char *title)
+{
+	(void)wnd, (void)width, (void)height, (void)title;
+	return &headless_native;
+}
+
+int wnd_update_native(window_context_t *wnd)
+{
+	return wnd->is_closed;
+}
+
+int wnd_poll_events_native(window_context_t *wnd, int timeout_ms)
+{
+	(void)wnd;
+	// Nothing will ever arrive, just keep the input thread from spinning
+	if (timeout_ms > 0) {
+		poll(NULL, 0, timeout_ms);
+	}
+	return 0;
+}
+
+void wnd_resize_native(window_context_t *wnd, int width, int height)
+{
+	(void)wnd, (void)width, (void)height;
+}
+
+void wnd_destroy_native(window_context_t *wnd)
+{
+	wnd->native = NULL;
+}
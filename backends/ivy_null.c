@@ -0,0 +1,62 @@
+#include "../ivy.h"
+
+#include "ivy_audio_clock.h"
+
+// Discards every sample at the real time rate of the device it pretends
+// to be, so audio code runs and is paced on machines without a sound card
+
+#ifndef IVY_NULL_STAGING_FRAMES
+#define IVY_NULL_STAGING_FRAMES 1024
+#endif // IVY_NULL_STAGING_FRAMES
+
+typedef struct {
+	audio_clock_t clock;
+	float *staging;
+} audio_native_t;
+
+void *audio_open_native(audio_device_t *audio, audio_config_t config)
+{
+	audio->format = IVY_AUDIO_FORMAT_F32;
+	audio_native_t *native = IVY_CALLOC(1, sizeof(audio_native_t));
+	if (!native) {
+		FATAL("Cannot allocate audio device");
+	}
+	native->staging = IVY_MALLOC(IVY_NULL_STAGING_FRAMES * config.channels * sizeof(float));
+	if (!native->staging) {
+		FATAL("Cannot allocate audio staging buffer");
+	}
+	_audio_clock_init(&native->clock, config.sample_rate, config.latency_secs);
+	return native;
+}
+
+int audio_avail_frames(audio_device_t *audio)
+{
+	audio_native_t *native = audio->native;
+	return _audio_clock_avail(audio, &native->clock);
+}
+
+void audio_write_buffer(audio_device_t *audio, float *buf, size_t buf_size)
+{
+	(void)buf;
+	audio_native_t *native = audio->native;
+	_audio_clock_write(audio, &native->clock, buf_size);
+}
+
+float *audio_begin_write(audio_device_t *audio, size_t *frames)
+{
+	audio_native_t *native = audio->native;
+	*frames = *frames < IVY_NULL_STAGING_FRAMES ? *frames : IVY_NULL_STAGING_FRAMES;
+	return native->staging;
+}
+
+void audio_end_write(audio_device_t *audio, size_t frames)
+{
+	audio_write_buffer(audio, NULL, frames);
+}
+
+void audio_close_native(audio_device_t *audio)
+{
+	audio_native_t *native = audio->native;
+	IVY_FREE(native->staging);
+	IVY_FREE(native);
+}
@@ -0,0 +1,130 @@
+#include "../ivy.h"
+
+#include "ivy_audio_clock.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Records everything written to a 32 bit float WAV file, paced at the real
+// time rate like a sound card. The file is IVY_AUDIO_WAV or ivy_audio.wav
+
+#ifndef IVY_WAVFILE_PATH
+#define IVY_WAVFILE_PATH "ivy_audio.wav"
+#endif // IVY_WAVFILE_PATH
+
+#ifndef IVY_WAVFILE_STAGING_FRAMES
+#define IVY_WAVFILE_STAGING_FRAMES 1024
+#endif // IVY_WAVFILE_STAGING_FRAMES
+
+#define WAVFILE_HEADER_SIZE 44
+
+typedef struct {
+	audio_clock_t clock;
+	FILE *file;
+	u64_t frames;
+	float *staging;
+} audio_native_t;
+
+static void _wavfile_u32(u8_t *p, u32_t v)
+{
+	p[0] = v, p[1] = v >> 8, p[2] = v >> 16, p[3] = v >> 24;
+}
+
+static void _wavfile_u16(u8_t *p, u16_t v)
+{
+	p[0] = v, p[1] = v >> 8;
+}
+
+// Sizes are patched on close. Until then they hold 0xffffffff, which WAV
+// readers, audio_clip_load_wav included, take as data running to the end
+// of the file, so a crashed run still leaves readable samples
+static void _wavfile_header(audio_device_t *audio, u8_t *h, u64_t frames)
+{
+	u32_t frame_size = audio->channels * sizeof(float);
+	u64_t data_size = frames * frame_size;
+	if (data_size > 0xffffffffull - WAVFILE_HEADER_SIZE) {
+		data_size = 0xffffffffull - WAVFILE_HEADER_SIZE;
+	}
+	memcpy(h, "RIFF", 4);
+	_wavfile_u32(h + 4, WAVFILE_HEADER_SIZE - 8 + data_size);
+	memcpy(h + 8, "WAVEfmt ", 8);
+	_wavfile_u32(h + 16, 16);
+	_wavfile_u16(h + 20, 3); // IEEE float
+	_wavfile_u16(h + 22, audio->channels);
+	_wavfile_u32(h + 24, audio->sample_rate);
+	_wavfile_u32(h + 28, audio->sample_rate * frame_size);
+	_wavfile_u16(h + 32, frame_size);
+	_wavfile_u16(h + 34, 32);
+	memcpy(h + 36, "data", 4);
+	_wavfile_u32(h + 40, data_size);
+}
+
+void *audio_open_native(audio_device_t *audio, audio_config_t config)
+{
+	audio->format = IVY_AUDIO_FORMAT_F32;
+	audio_native_t *native = IVY_CALLOC(1, sizeof(audio_native_t));
+	if (!native) {
+		FATAL("Cannot allocate audio device");
+	}
+	const char *path = getenv("IVY_AUDIO_WAV");
+	if (!path || !*path) {
+		path = IVY_WAVFILE_PATH;
+	}
+	native->file = fopen(path, "wb");
+	if (!native->file) {
+		FATAL("Cannot open audio file %s", path);
+	}
+	u8_t header[WAVFILE_HEADER_SIZE];
+	_wavfile_header(audio, header, 0);
+	_wavfile_u32(header + 4, 0xffffffff);
+	_wavfile_u32(header + 40, 0xffffffff);
+	fwrite(header, 1, WAVFILE_HEADER_SIZE, native->file);
+
+	native->staging = IVY_MALLOC(IVY_WAVFILE_STAGING_FRAMES * config.channels * sizeof(float));
+	if (!native->staging) {
+		FATAL("Cannot allocate audio staging buffer");
+	}
+	_audio_clock_init(&native->clock, config.sample_rate, config.latency_secs);
+	return native;
+}
+
+int audio_avail_frames(audio_device_t *audio)
+{
+	audio_native_t *native = audio->native;
+	return _audio_clock_avail(audio, &native->clock);
+}
+
+void audio_write_buffer(audio_device_t *audio, float *buf, size_t buf_size)
+{
+	audio_native_t *native = audio->native;
+	_audio_clock_write(audio, &native->clock, buf_size);
+	if (fwrite(buf, audio->channels * sizeof(float), buf_size, native->file) != buf_size) {
+		WARN("IVY AUDIO: Unable to write to audio file");
+	}
+	native->frames += buf_size;
+}
+
+float *audio_begin_write(audio_device_t *audio, size_t *frames)
+{
+	audio_native_t *native = audio->native;
+	*frames = *frames < IVY_WAVFILE_STAGING_FRAMES ? *frames : IVY_WAVFILE_STAGING_FRAMES;
+	return native->staging;
+}
+
+void audio_end_write(audio_device_t *audio, size_t frames)
+{
+	audio_native_t *native = audio->native;
+	audio_write_buffer(audio, native->staging, frames);
+}
+
+void audio_close_native(audio_device_t *audio)
+{
+	audio_native_t *native = audio->native;
+	u8_t header[WAVFILE_HEADER_SIZE];
+	_wavfile_header(audio, header, native->frames);
+	fseek(native->file, 0, SEEK_SET);
+	fwrite(header, 1, WAVFILE_HEADER_SIZE, native->file);
+	fclose(native->file);
+	IVY_FREE(native->staging);
+	IVY_FREE(native);
+}
@@ -0,0 +1,703 @@
+#define _GNU_SOURCE
+#include "../ivy.h"
+
+#include <errno.h>
+#include <linux/input-event-codes.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <wayland-client.h>
+#include <xkbcommon/xkbcommon.h>
+
+#include "ivy_x11_keys.h"
+#include "xdg-shell-protocol.h"
+
+// Number of wl_shm buffers pixels are rendered into
+#ifndef IVY_WAYLAND_BUFFERS
+#define IVY_WAYLAND_BUFFERS 2
+#endif // IVY_WAYLAND_BUFFERS
+
+typedef struct {
+	struct wl_buffer *buffer;
+	pixel_t *data;
+	bool_t busy;
+} wl_shm_buffer_t;
+
+typedef struct {
+	struct wl_display *dsp;
+	struct wl_registry *registry;
+	struct wl_compositor *compositor;
+	struct wl_shm *shm;
+	struct xdg_wm_base *wm_base;
+	struct wl_seat *seat;
+	struct wl_pointer *pointer;
+	struct wl_keyboard *keyboard;
+
+	struct wl_surface *surface;
+	struct xdg_surface *xdg_surface;
+	struct xdg_toplevel *toplevel;
+
+	// Buffer release and frame callbacks go to this queue, so the render
+	// thread can wait on them while input is read on another thread
+	struct wl_event_queue *queue;
+	struct wl_callback *frame;
+	bool_t frame_pending;
+
+	int pool_fd;
+	size_t pool_size;
+	struct wl_shm_pool *pool;
+	int back;
+	wl_shm_buffer_t buffers[IVY_WAYLAND_BUFFERS];
+
+	bool_t configured;
+	// Size of the latest toplevel configure, 0 when it is ours to pick
+	int configure_width, configure_height;
+	// Configure waiting to be acked, serial << 32 | width << 16 | height
+	atomic_uint_fast64_t configure;
+	int width, height;
+
+	struct xkb_context *xkb_ctx;
+	struct xkb_keymap *xkb_keymap;
+	struct xkb_state *xkb_state;
+	int mouse_x, mouse_y;
+
+	// Window that receives events, NULL until the first poll
+	window_context_t *wnd;
+} window_native_t;
+
+static void _wl_push_event(window_native_t *native, const wnd_event_t *e)
+{
+	if (native->wnd) {
+		wnd_push_event(native->wnd, e);
+	}
+}
+
+// ---------------------------------------------------------------
+// BUFFERS
+
+static void _wl_buffer_release(void *data, struct wl_buffer *buffer)
+{
+	wl_shm_buffer_t *buf = data;
+	buf->busy = 0;
+	(void)buffer;
+}
+
+static const struct wl_buffer_listener wl_buffer_listener = {
+	.release = _wl_buffer_release,
+};
+
+static void _wl_destroy_buffers(window_native_t *native)
+{
+	void *data = native->buffers[0].data;
+	for (int i = 0; i < IVY_WAYLAND_BUFFERS; i++) {
+		if (native->buffers[i].buffer) {
+			wl_buffer_destroy(native->buffers[i].buffer);
+		}
+		native->buffers[i] = (wl_shm_buffer_t){0};
+	}
+	if (native->pool) {
+		wl_shm_pool_destroy(native->pool);
+		native->pool = NULL;
+	}
+	if (native->pool_fd >= 0) {
+		if (data) {
+			munmap(data, native->pool_size);
+		}
+		close(native->pool_fd);
+		native->pool_fd = -1;
+	}
+}
+
+static int _wl_create_buffers(window_native_t *native, int width, int height)
+{
+	int stride = width * sizeof(pixel_t);
+	size_t size = (size_t)stride * height;
+	native->pool_size = size * IVY_WAYLAND_BUFFERS;
+	native->pool_fd = memfd_create("ivy-wl-shm", MFD_CLOEXEC);
+	if (native->pool_fd < 0) {
+		return 0;
+	}
+	if (ftruncate(native->pool_fd, native->pool_size) < 0) {
+		return 0;
+	}
+	u8_t *data = mmap(NULL, native->pool_size, PROT_READ | PROT_WRITE, MAP_SHARED, native->pool_fd, 0);
+	if (data == MAP_FAILED) {
+		return 0;
+	}
+
+	native->pool = wl_shm_create_pool(native->shm, native->pool_fd, native->pool_size);
+	for (int i = 0; i < IVY_WAYLAND_BUFFERS; i++) {
+		wl_shm_buffer_t *buf = &native->buffers[i];
+		buf->data = (pixel_t *)(data + size * i);
+		buf->buffer = wl_shm_pool_create_buffer(native->pool, size * i, width, height, stride, WL_SHM_FORMAT_XRGB8888);
+		wl_proxy_set_queue((struct wl_proxy *)buf->buffer, native->queue);
+		wl_buffer_add_listener(buf->buffer, &wl_buffer_listener, buf);
+	}
+	native->back = 0;
+	native->width = width;
+	native->height = height;
+	return 1;
+}
+
+static void _wl_attach_pixels(window_context_t *wnd, window_native_t *native)
+{
+	pixel_array_t *pixels = &wnd->pixels;
+	if (!pixels->external) {
+		IVY_FREE(pixels->buffer);
+	}
+	pixels->buffer = native->buffers[native->back].data;
+	pixels->max_size = pixels->width * pixels->height;
+	pixels->external = 1;
+}
+
+// ---------------------------------------------------------------
+// SHELL
+
+static void _wl_frame_done(void *data, struct wl_callback *cb, uint32_t time)
+{
+	window_native_t *native = data;
+	wl_callback_destroy(cb);
+	native->frame = NULL;
+	native->frame_pending = 0;
+	(void)time;
+}
+
+static const struct wl_callback_listener wl_frame_listener = {
+	.done = _wl_frame_done,
+};
+
+static void _wl_wm_base_ping(void *data, struct xdg_wm_base *wm_base, uint32_t serial)
+{
+	xdg_wm_base_pong(wm_base, serial);
+	(void)data;
+}
+
+static const struct xdg_wm_base_listener wl_wm_base_listener = {
+	.ping = _wl_wm_base_ping,
+};
+
+static void _wl_xdg_surface_configure(void *data, struct xdg_surface *xdg_surface, uint32_t serial)
+{
+	window_native_t *native = data;
+	// Acked by the render thread right before it commits a matching buffer
+	u64_t size = (u64_t)(native->configure_width & 0xffff) << 16 | (native->configure_height & 0xffff);
+	atomic_store(&native->configure, (u64_t)serial << 32 | size);
+	native->configured = 1;
+	(void)xdg_surface;
+}
+
+static const struct xdg_surface_listener wl_xdg_surface_listener = {
+	.configure = _wl_xdg_surface_configure,
+};
+
+static void _wl_toplevel_configure(void *data, struct xdg_toplevel *toplevel, int32_t width, int32_t height, struct wl_array *states)
+{
+	window_native_t *native = data;
+	// Zero means we are free to pick the size
+	if (width <= 0 || height <= 0) {
+		native->configure_width = native->configure_height = 0;
+		return;
+	}
+	native->configure_width = width;
+	native->configure_height = height;
+	if (!native->wnd) {
+		// Still inside wnd_create_native, size is applied there
+		native->width = width;
+		native->height = height;
+	} else {
+		wnd_event_t e = {
+			.type = IVY_EVENT_WINDOW_RESIZE,
+			.timestamp_ns = wnd_time_ns(),
+			.x = width,
+			.y = height,
+		};
+		_wl_push_event(native, &e);
+	}
+	(void)toplevel, (void)states;
+}
+
+static void _wl_toplevel_close(void *data, struct xdg_toplevel *toplevel)
+{
+	window_native_t *native = data;
+	wnd_event_t e = {.type = IVY_EVENT_WINDOW_CLOSE, .timestamp_ns = wnd_time_ns()};
+	_wl_push_event(native, &e);
+	(void)toplevel;
+}
+
+static const struct xdg_toplevel_listener wl_toplevel_listener = {
+	.configure = _wl_toplevel_configure,
+	.close = _wl_toplevel_close,
+};
+
+// ---------------------------------------------------------------
+// INPUT
+
+static int _wl_get_mods(window_native_t *native)
+{
+	int mods = 0;
+	struct xkb_state *state = native->xkb_state;
+	if (!state) {
+		return 0;
+	}
+	if (xkb_state_mod_name_is_active(state, XKB_MOD_NAME_SHIFT, XKB_STATE_MODS_EFFECTIVE) > 0)
+		mods |= IVY_MOD_MASK_SHIFT;
+	if (xkb_state_mod_name_is_active(state, XKB_MOD_NAME_CTRL, XKB_STATE_MODS_EFFECTIVE) > 0)
+		mods |= IVY_MOD_MASK_CONTROL;
+	if (xkb_state_mod_name_is_active(state, XKB_MOD_NAME_ALT, XKB_STATE_MODS_EFFECTIVE) > 0)
+		mods |= IVY_MOD_MASK_ALT;
+	if (xkb_state_mod_name_is_active(state, XKB_MOD_NAME_LOGO, XKB_STATE_MODS_EFFECTIVE) > 0)
+		mods |= IVY_MOD_MASK_SUPER;
+	if (xkb_state_mod_name_is_active(state, XKB_MOD_NAME_CAPS, XKB_STATE_MODS_EFFECTIVE) > 0)
+		mods |= IVY_MOD_MASK_CAPS_LOCK;
+	if (xkb_state_mod_name_is_active(state, XKB_MOD_NAME_NUM, XKB_STATE_MODS_EFFECTIVE) > 0)
+		mods |= IVY_MOD_MASK_NUM_LOCK;
+	return mods;
+}
+
+static void _wl_pointer_enter(void *data, struct wl_pointer *pointer, uint32_t serial, struct wl_surface *surface, wl_fixed_t sx, wl_fixed_t sy)
+{
+	window_native_t *native = data;
+	native->mouse_x = wl_fixed_to_int(sx);
+	native->mouse_y = wl_fixed_to_int(sy);
+	wnd_event_t e = {
+		.type = IVY_EVENT_MOUSE_ENTER,
+		.timestamp_ns = wnd_time_ns(),
+		.x = native->mouse_x,
+		.y = native->mouse_y,
+	};
+	_wl_push_event(native, &e);
+	(void)pointer, (void)serial, (void)surface;
+}
+
+static void _wl_pointer_leave(void *data, struct wl_pointer *pointer, uint32_t serial, struct wl_surface *surface)
+{
+	window_native_t *native = data;
+	wnd_event_t e = {
+		.type = IVY_EVENT_MOUSE_LEAVE,
+		.timestamp_ns = wnd_time_ns(),
+		.x = native->mouse_x,
+		.y = native->mouse_y,
+	};
+	_wl_push_event(native, &e);
+	(void)pointer, (void)serial, (void)surface;
+}
+
+static void _wl_pointer_motion(void *data, struct wl_pointer *pointer, uint32_t time, wl_fixed_t sx, wl_fixed_t sy)
+{
+	window_native_t *native = data;
+	native->mouse_x = wl_fixed_to_int(sx);
+	native->mouse_y = wl_fixed_to_int(sy);
+	wnd_event_t e = {
+		.type = IVY_EVENT_MOUSE_MOVE,
+		.timestamp_ns = wnd_time_ns(),
+		.x = native->mouse_x,
+		.y = native->mouse_y,
+	};
+	_wl_push_event(native, &e);
+	(void)pointer, (void)time;
+}
+
+static void _wl_pointer_button(void *data, struct wl_pointer *pointer, uint32_t serial, uint32_t time, uint32_t button, uint32_t state)
+{
+	window_native_t *native = data;
+	wnd_event_t e = {
+		.type = state == WL_POINTER_BUTTON_STATE_PRESSED ? IVY_EVENT_KEY_PRESS : IVY_EVENT_KEY_RELEASE,
+		.timestamp_ns = wnd_time_ns(),
+		.mods = _wl_get_mods(native),
+	};
+	switch (button) {
+	case BTN_LEFT: e.key = IVY_KEY_BUTTON_1; break;
+	case BTN_MIDDLE: e.key = IVY_KEY_BUTTON_2; break;
+	case BTN_RIGHT: e.key = IVY_KEY_BUTTON_3; break;
+	default: e.key = IVY_KEY_INVALID; break;
+	}
+	_wl_push_event(native, &e);
+	(void)pointer, (void)serial, (void)time;
+}
+
+static void _wl_pointer_axis(void *data, struct wl_pointer *pointer, uint32_t time, uint32_t axis, wl_fixed_t value)
+{
+	window_native_t *native = data;
+	if (axis != WL_POINTER_AXIS_VERTICAL_SCROLL || value == 0) {
+		return;
+	}
+	// Report scrolling as button 4/5 clicks like X11 does
+	wnd_event_t e = {
+		.type = IVY_EVENT_KEY_PRESS,
+		.timestamp_ns = wnd_time_ns(),
+		.key = value < 0 ? IVY_KEY_BUTTON_4 : IVY_KEY_BUTTON_5,
+		.mods = _wl_get_mods(native),
+	};
+	_wl_push_event(native, &e);
+	e.type = IVY_EVENT_KEY_RELEASE;
+	_wl_push_event(native, &e);
+	(void)pointer, (void)time;
+}
+
+static void _wl_pointer_frame(void *data, struct wl_pointer *pointer)
+{
+	(void)data, (void)pointer;
+}
+
+static void _wl_pointer_axis_source(void *data, struct wl_pointer *pointer, uint32_t source)
+{
+	(void)data, (void)pointer, (void)source;
+}
+
+static void _wl_pointer_axis_stop(void *data, struct wl_pointer *pointer, uint32_t time, uint32_t axis)
+{
+	(void)data, (void)pointer, (void)time, (void)axis;
+}
+
+static void _wl_pointer_axis_discrete(void *data, struct wl_pointer *pointer, uint32_t axis, int32_t discrete)
+{
+	(void)data, (void)pointer, (void)axis, (void)discrete;
+}
+
+static const struct wl_pointer_listener wl_pointer_listener = {
+	.enter = _wl_pointer_enter,
+	.leave = _wl_pointer_leave,
+	.motion = _wl_pointer_motion,
+	.button = _wl_pointer_button,
+	.axis = _wl_pointer_axis,
+	.frame = _wl_pointer_frame,
+	.axis_source = _wl_pointer_axis_source,
+	.axis_stop = _wl_pointer_axis_stop,
+	.axis_discrete = _wl_pointer_axis_discrete,
+};
+
+static void _wl_keyboard_keymap(void *data, struct wl_keyboard *keyboard, uint32_t format, int32_t fd, uint32_t size)
+{
+	window_native_t *native = data;
+	if (format != WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1) {
+		close(fd);
+		return;
+	}
+	char *str = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (str == MAP_FAILED) {
+		WARN("IVY_WAYLAND: Unable to map keymap");
+		return;
+	}
+	struct xkb_keymap *keymap = xkb_keymap_new_from_string(native->xkb_ctx, str, XKB_KEYMAP_FORMAT_TEXT_V1, XKB_KEYMAP_COMPILE_NO_FLAGS);
+	munmap(str, size);
+	if (!keymap) {
+		WARN("IVY_WAYLAND: Unable to compile keymap");
+		return;
+	}
+	xkb_state_unref(native->xkb_state);
+	xkb_keymap_unref(native->xkb_keymap);
+	native->xkb_keymap = keymap;
+	native->xkb_state = xkb_state_new(keymap);
+	(void)keyboard;
+}
+
+static void _wl_keyboard_enter(void *data, struct wl_keyboard *keyboard, uint32_t serial, struct wl_surface *surface, struct wl_array *keys)
+{
+	(void)data, (void)keyboard, (void)serial, (void)surface, (void)keys;
+}
+
+static void _wl_keyboard_leave(void *data, struct wl_keyboard *keyboard, uint32_t serial, struct wl_surface *surface)
+{
+	(void)data, (void)keyboard, (void)serial, (void)surface;
+}
+
+static void _wl_keyboard_key(void *data, struct wl_keyboard *keyboard, uint32_t serial, uint32_t time, uint32_t key, uint32_t state)
+{
+	window_native_t *native = data;
+	if (!native->xkb_state) {
+		return;
+	}
+	// evdev scancodes are offset by 8 in xkb
+	xkb_keycode_t keycode = key + 8;
+	const xkb_keysym_t *syms;
+	int nsyms = xkb_keymap_key_get_syms_by_level(native->xkb_keymap, keycode, 0, 0, &syms);
+
+	wnd_event_t e = {
+		.type = state == WL_KEYBOARD_KEY_STATE_PRESSED ? IVY_EVENT_KEY_PRESS : IVY_EVENT_KEY_RELEASE,
+		.timestamp_ns = wnd_time_ns(),
+		.key = _get_mapped_key(nsyms > 0 ? (int)syms[0] : 0),
+		.mods = _wl_get_mods(native),
+	};
+	_wl_push_event(native, &e);
+
+	if (e.type == IVY_EVENT_KEY_PRESS) {
+		e.type = IVY_EVENT_TEXT_INPUT;
+		e.text_len = xkb_state_key_get_utf8(native->xkb_state, keycode, e.text, sizeof(e.text));
+		if (e.text_len >= (int)sizeof(e.text)) {
+			e.text_len = sizeof(e.text) - 1;
+		}
+		_wl_push_event(native, &e);
+	}
+	(void)keyboard, (void)serial, (void)time;
+}
+
+static void _wl_keyboard_modifiers(void *data, struct wl_keyboard *keyboard, uint32_t serial, uint32_t depressed, uint32_t latched, uint32_t locked, uint32_t group)
+{
+	window_native_t *native = data;
+	if (native->xkb_state) {
+		xkb_state_update_mask(native->xkb_state, depressed, latched, locked, 0, 0, group);
+	}
+	(void)keyboard, (void)serial;
+}
+
+static void _wl_keyboard_repeat_info(void *data, struct wl_keyboard *keyboard, int32_t rate, int32_t delay)
+{
+	(void)data, (void)keyboard, (void)rate, (void)delay;
+}
+
+static const struct wl_keyboard_listener wl_keyboard_listener = {
+	.keymap = _wl_keyboard_keymap,
+	.enter = _wl_keyboard_enter,
+	.leave = _wl_keyboard_leave,
+	.key = _wl_keyboard_key,
+	.modifiers = _wl_keyboard_modifiers,
+	.repeat_info = _wl_keyboard_repeat_info,
+};
+
+static void _wl_seat_capabilities(void *data, struct wl_seat *seat, uint32_t caps)
+{
+	window_native_t *native = data;
+	if ((caps & WL_SEAT_CAPABILITY_POINTER) && !native->pointer) {
+		native->pointer = wl_seat_get_pointer(seat);
+		wl_pointer_add_listener(native->pointer, &wl_pointer_listener, native);
+	}
+	if ((caps & WL_SEAT_CAPABILITY_KEYBOARD) && !native->keyboard) {
+		native->keyboard = wl_seat_get_keyboard(seat);
+		wl_keyboard_add_listener(native->keyboard, &wl_keyboard_listener, native);
+	}
+}
+
+static void _wl_seat_name(void *data, struct wl_seat *seat, const char *name)
+{
+	(void)data, (void)seat, (void)name;
+}
+
+static const struct wl_seat_listener wl_seat_listener = {
+	.capabilities = _wl_seat_capabilities,
+	.name = _wl_seat_name,
+};
+
+// ---------------------------------------------------------------
+// REGISTRY
+
+static void _wl_registry_global(void *data, struct wl_registry *registry, uint32_t name, const char *interface, uint32_t version)
+{
+	window_native_t *native = data;
+	if (!strcmp(interface, wl_compositor_interface.name)) {
+		native->compositor = wl_registry_bind(registry, name, &wl_compositor_interface, version < 4 ? version : 4);
+	} else if (!strcmp(interface, wl_shm_interface.name)) {
+		native->shm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+	} else if (!strcmp(interface, xdg_wm_base_interface.name)) {
+		native->wm_base = wl_registry_bind(registry, name, &xdg_wm_base_interface, 1);
+		xdg_wm_base_add_listener(native->wm_base, &wl_wm_base_listener, native);
+	} else if (!strcmp(interface, wl_seat_interface.name) && !native->seat) {
+		native->seat = wl_registry_bind(registry, name, &wl_seat_interface, version < 5 ? version : 5);
+		wl_seat_add_listener(native->seat, &wl_seat_listener, native);
+	}
+}
+
+static void _wl_registry_global_remove(void *data, struct wl_registry *registry, uint32_t name)
+{
+	(void)data, (void)registry, (void)name;
+}
+
+static const struct wl_registry_listener wl_registry_listener = {
+	.global = _wl_registry_global,
+	.global_remove = _wl_registry_global_remove,
+};
+
+// ---------------------------------------------------------------
+// NATIVE API
+
+void *wnd_create_native(window_context_t *wnd, u32_t width, u32_t height, const char *title)
+{
+	window_native_t *native = IVY_CALLOC(1, sizeof(window_native_t));
+	if (!native) {
+		WARN("IVY_WAYLAND: Unable to allocate memory");
+		return NULL;
+	}
+	native->pool_fd = -1;
+
+	native->dsp = wl_display_connect(NULL);
+	if (!native->dsp) {
+		WARN("IVY_WAYLAND: Unable to connect to display");
+		IVY_FREE(native);
+		return NULL;
+	}
+	native->xkb_ctx = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+	native->queue = wl_display_create_queue(native->dsp);
+
+	native->registry = wl_display_get_registry(native->dsp);
+	wl_registry_add_listener(native->registry, &wl_registry_listener, native);
+	wl_display_roundtrip(native->dsp);
+	if (!native->compositor || !native->shm || !native->wm_base) {
+		WARN("IVY_WAYLAND: Compositor does not support wl_compositor, wl_shm and xdg_wm_base");
+		wl_display_disconnect(native->dsp);
+		IVY_FREE(native);
+		return NULL;
+	}
+
+	native->surface = wl_compositor_create_surface(native->compositor);
+	native->xdg_surface = xdg_wm_base_get_xdg_surface(native->wm_base, native->surface);
+	xdg_surface_add_listener(native->xdg_surface, &wl_xdg_surface_listener, native);
+	native->toplevel = xdg_surface_get_toplevel(native->xdg_surface);
+	xdg_toplevel_add_listener(native->toplevel, &wl_toplevel_listener, native);
+	xdg_toplevel_set_title(native->toplevel, title);
+	wl_surface_commit(native->surface);
+
+	// Wait for the initial configure before attaching any buffer
+	while (!native->configured) {
+		if (wl_display_dispatch(native->dsp) < 0) {
+			WARN("IVY_WAYLAND: Lost connection while waiting for configure");
+			wl_display_disconnect(native->dsp);
+			IVY_FREE(native);
+			return NULL;
+		}
+	}
+
+	if (native->width > 0 && native->height > 0) {
+		width = native->width;
+		height = native->height;
+		gfx_resize(&wnd->pixels, width, height);
+	}
+	if (!_wl_create_buffers(native, width, height)) {
+		WARN("IVY_WAYLAND: Unable to create shared memory buffers");
+		_wl_destroy_buffers(native);
+		wl_display_disconnect(native->dsp);
+		IVY_FREE(native);
+		return NULL;
+	}
+	_wl_attach_pixels(wnd, native);
+	return native;
+}
+
+int wnd_update_native(window_context_t *wnd)
+{
+	window_native_t *native = wnd->native;
+	pixel_array_t *pixels = &wnd->pixels;
+	wl_display_dispatch_queue_pending(native->dsp, native->queue);
+
+	// Compositor has not shown the last frame yet, keep drawing into
+	// the same buffer and commit the newest contents once it has
+	if (native->frame_pending) {
+		return wnd->is_closed;
+	}
+
+	// The resize event reaches wnd_resize_native through the input queue,
+	// until the buffers have the configured size keep committing the old
+	// state without acking it
+	u64_t configure = atomic_load(&native->configure);
+	if (configure) {
+		int width = (configure >> 16) & 0xffff, height = configure & 0xffff;
+		bool_t applied = !width || (width == native->width && height == native->height);
+		if (applied && atomic_compare_exchange_strong(&native->configure, &configure, 0)) {
+			xdg_surface_ack_configure(native->xdg_surface, configure >> 32);
+		}
+	}
+
+	wl_shm_buffer_t *buf = &native->buffers[native->back];
+	wl_surface_attach(native->surface, buf->buffer, 0, 0);
+	wl_surface_damage_buffer(native->surface, 0, 0, pixels->width, pixels->height);
+	native->frame = wl_surface_frame(native->surface);
+	wl_proxy_set_queue((struct wl_proxy *)native->frame, native->queue);
+	wl_callback_add_listener(native->frame, &wl_frame_listener, native);
+	native->frame_pending = 1;
+	buf->busy = 1;
+	wl_surface_commit(native->surface);
+	wl_display_flush(native->dsp);
+
+	// Pick a buffer the compositor released, waiting for one if needed.
+	// It holds an older frame, carry over the one just committed so the
+	// pixels keep what the application drew
+	for (;;) {
+		for (int i = 1; i <= IVY_WAYLAND_BUFFERS; i++) {
+			int next = (native->back + i) % IVY_WAYLAND_BUFFERS;
+			if (!native->buffers[next].busy) {
+				if (next != native->back) {
+					memcpy(native->buffers[next].data, buf->data, (size_t)pixels->width * pixels->height * sizeof(pixel_t));
+				}
+				native->back = next;
+				pixels->buffer = native->buffers[next].data;
+				return wnd->is_closed;
+			}
+		}
+		if (wl_display_dispatch_queue(native->dsp, native->queue) < 0) {
+			wnd->is_closed = 1;
+			return 1;
+		}
+	}
+}
+
+int wnd_poll_events_native(window_context_t *wnd, int timeout_ms)
+{
+	window_native_t *native = wnd->native;
+	// Listeners push events into the window that is polling, wnd is
+	// returned by value from wnd_create so it can not be kept earlier
+	native->wnd = wnd;
+
+	// Read protocol that allows another thread to wait on the render queue
+	while (wl_display_prepare_read(native->dsp) != 0) {
+		wl_display_dispatch_pending(native->dsp);
+	}
+	wl_display_flush(native->dsp);
+
+	struct pollfd pfd = {.fd = wl_display_get_fd(native->dsp), .events = POLLIN};
+	if (poll(&pfd, 1, timeout_ms) > 0) {
+		if (wl_display_read_events(native->dsp) < 0 && errno != EAGAIN) {
+			wnd_event_t e = {.type = IVY_EVENT_WINDOW_CLOSE, .timestamp_ns = wnd_time_ns()};
+			wnd_push_event(wnd, &e);
+			return 1;
+		}
+	} else {
+		wl_display_cancel_read(native->dsp);
+	}
+	return wl_display_dispatch_pending(native->dsp);
+}
+
+void wnd_resize_native(window_context_t *wnd, int width, int height)
+{
+	window_native_t *native = wnd->native;
+	if (width == native->width && height == native->height) {
+		return;
+	}
+	// The compositor keeps its own reference to buffers it still uses
+	_wl_destroy_buffers(native);
+	if (!_wl_create_buffers(native, width, height)) {
+		FATAL("IVY_WAYLAND: Unable to resize shared memory buffers");
+	}
+	_wl_attach_pixels(wnd, native);
+}
+
+void wnd_destroy_native(window_context_t *wnd)
+{
+	window_native_t *native = wnd->native;
+	_wl_destroy_buffers(native);
+	if (native->frame) {
+		wl_callback_destroy(native->frame);
+	}
+	if (native->pointer) {
+		wl_pointer_destroy(native->pointer);
+	}
+	if (native->keyboard) {
+		wl_keyboard_destroy(native->keyboard);
+	}
+	xkb_state_unref(native->xkb_state);
+	xkb_keymap_unref(native->xkb_keymap);
+	xkb_context_unref(native->xkb_ctx);
+	xdg_toplevel_destroy(native->toplevel);
+	xdg_surface_destroy(native->xdg_surface);
+	wl_surface_destroy(native->surface);
+	if (native->seat) {
+		wl_seat_destroy(native->seat);
+	}
+	xdg_wm_base_destroy(native->wm_base);
+	wl_shm_destroy(native->shm);
+	wl_compositor_destroy(native->compositor);
+	wl_registry_destroy(native->registry);
+	wl_event_queue_destroy(native->queue);
+	wl_display_disconnect(native->dsp);
+	IVY_FREE(native);
+}
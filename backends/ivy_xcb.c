@@ -0,0 +1,439 @@
+#include "../ivy.h"
+
+#include <poll.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <xcb/shm.h>
+#include <xcb/xcb.h>
+
+#include "ivy_x11_keys.h"
+
+// Number of shared memory images we cycle through while presenting
+#ifndef IVY_XCB_BUFFERS
+#define IVY_XCB_BUFFERS 2
+#endif // IVY_XCB_BUFFERS
+
+typedef struct {
+	xcb_shm_seg_t seg;
+	int shmid;
+	pixel_t *data;
+
+	// Reply to a request sent after the put image, once it arrives
+	// the server is done reading from this buffer
+	xcb_get_input_focus_cookie_t fence;
+	bool_t pending;
+} xcb_shm_buffer_t;
+
+typedef struct {
+	xcb_connection_t *conn;
+	xcb_screen_t *screen;
+	xcb_window_t wnd;
+	xcb_gcontext_t gc;
+	xcb_atom_t wnd_close_atom;
+
+	bool_t has_shm;
+	int back;
+	xcb_shm_buffer_t buffers[IVY_XCB_BUFFERS];
+
+	xcb_keycode_t min_keycode;
+	int keysyms_per_keycode;
+	int keysyms_len;
+	xcb_keysym_t *keysyms;
+} window_native_t;
+
+static void _xcb_wait_buffer(window_native_t *native, xcb_shm_buffer_t *buf)
+{
+	if (buf->pending) {
+		free(xcb_get_input_focus_reply(native->conn, buf->fence, NULL));
+		buf->pending = 0;
+	}
+}
+
+static void _xcb_destroy_buffers(window_native_t *native)
+{
+	for (int i = 0; i < IVY_XCB_BUFFERS; i++) {
+		xcb_shm_buffer_t *buf = &native->buffers[i];
+		if (!buf->data) {
+			continue;
+		}
+		_xcb_wait_buffer(native, buf);
+		xcb_shm_detach(native->conn, buf->seg);
+		shmdt(buf->data);
+		buf->data = NULL;
+	}
+}
+
+// Segments 0..count-1 were created and attached before a later one
+// failed, mark them for removal and drop their pending attach replies.
+// _xcb_destroy_buffers still detaches them
+static void _xcb_unwind_buffers(window_native_t *native, const xcb_void_cookie_t *cookies, int count)
+{
+	for (int i = 0; i < count; i++) {
+		xcb_discard_reply(native->conn, cookies[i].sequence);
+		shmctl(native->buffers[i].shmid, IPC_RMID, NULL);
+	}
+}
+
+static int _xcb_create_buffers(window_native_t *native, int width, int height)
+{
+	size_t size = (size_t)width * height * sizeof(pixel_t);
+	xcb_void_cookie_t cookies[IVY_XCB_BUFFERS];
+	for (int i = 0; i < IVY_XCB_BUFFERS; i++) {
+		xcb_shm_buffer_t *buf = &native->buffers[i];
+		buf->pending = 0;
+		buf->shmid = shmget(IPC_PRIVATE, size ? size : sizeof(pixel_t), IPC_CREAT | 0600);
+		if (buf->shmid < 0) {
+			_xcb_unwind_buffers(native, cookies, i);
+			return 0;
+		}
+		buf->data = shmat(buf->shmid, NULL, 0);
+		if (buf->data == (void *)-1) {
+			buf->data = NULL;
+			shmctl(buf->shmid, IPC_RMID, NULL);
+			_xcb_unwind_buffers(native, cookies, i);
+			return 0;
+		}
+		buf->seg = xcb_generate_id(native->conn);
+		cookies[i] = xcb_shm_attach_checked(native->conn, buf->seg, buf->shmid, 0);
+	}
+
+	// Only one round trip for all the segments, and only on create and resize
+	int ok = 1;
+	for (int i = 0; i < IVY_XCB_BUFFERS; i++) {
+		xcb_generic_error_t *err = xcb_request_check(native->conn, cookies[i]);
+		if (err) {
+			ok = 0;
+			free(err);
+		}
+		// Segment is freed once both we and the server detach it
+		shmctl(native->buffers[i].shmid, IPC_RMID, NULL);
+	}
+	native->back = 0;
+	return ok;
+}
+
+static void _xcb_attach_pixels(window_context_t *wnd, window_native_t *native)
+{
+	pixel_array_t *pixels = &wnd->pixels;
+	if (!pixels->external) {
+		IVY_FREE(pixels->buffer);
+	}
+	pixels->buffer = native->buffers[native->back].data;
+	pixels->max_size = pixels->width * pixels->height;
+	pixels->external = 1;
+}
+
+static void _xcb_load_keymap(window_native_t *native, xcb_get_keyboard_mapping_cookie_t cookie)
+{
+	xcb_get_keyboard_mapping_reply_t *reply = xcb_get_keyboard_mapping_reply(native->conn, cookie, NULL);
+	if (!reply) {
+		WARN("IVY_XCB: Unable to get keyboard mapping");
+		return;
+	}
+	int len = xcb_get_keyboard_mapping_keysyms_length(reply);
+	native->keysyms = IVY_MALLOC(len * sizeof(xcb_keysym_t));
+	if (native->keysyms) {
+		memcpy(native->keysyms, xcb_get_keyboard_mapping_keysyms(reply), len * sizeof(xcb_keysym_t));
+		native->keysyms_len = len;
+		native->keysyms_per_keycode = reply->keysyms_per_keycode;
+	}
+	free(reply);
+}
+
+static xcb_keysym_t _xcb_keysym(window_native_t *native, xcb_keycode_t keycode, int col)
+{
+	int i = (keycode - native->min_keycode) * native->keysyms_per_keycode + col;
+	if (col >= native->keysyms_per_keycode || i < 0 || i >= native->keysyms_len) {
+		return XK_VoidSymbol;
+	}
+	return native->keysyms[i];
+}
+
+// Minimal replacement for XLookupString, handles latin-1 and unicode keysyms
+static int _xcb_lookup_text(window_native_t *native, xcb_keycode_t keycode, uint16_t state, char *buf, int buf_size)
+{
+	xcb_keysym_t sym = _xcb_keysym(native, keycode, (state & ShiftMask) ? 1 : 0);
+	if (sym == XK_VoidSymbol || sym == NoSymbol) {
+		sym = _xcb_keysym(native, keycode, 0);
+	}
+	if ((state & LockMask) && sym >= XK_a && sym <= XK_z) {
+		sym -= XK_a - XK_A;
+	}
+
+	u32_t cp = 0;
+	if ((sym >= 0x20 && sym <= 0x7e) || (sym >= 0xa0 && sym <= 0xff)) {
+		cp = sym;
+	} else if ((sym & 0xff000000) == 0x01000000) {
+		cp = sym & 0x00ffffff;
+	} else if (sym == XK_Return || sym == XK_KP_Enter) {
+		cp = '\r';
+	} else if (sym == XK_Tab) {
+		cp = '\t';
+	} else if (sym == XK_BackSpace) {
+		cp = '\b';
+	} else if (sym == XK_Escape) {
+		cp = 0x1b;
+	} else if (sym == XK_Delete) {
+		cp = 0x7f;
+	}
+
+	int len = 0;
+	if (!cp || buf_size < 5) {
+		len = 0;
+	} else if (cp < 0x80) {
+		buf[len++] = cp;
+	} else if (cp < 0x800) {
+		buf[len++] = 0xc0 | (cp >> 6);
+		buf[len++] = 0x80 | (cp & 0x3f);
+	} else if (cp < 0x10000) {
+		buf[len++] = 0xe0 | (cp >> 12);
+		buf[len++] = 0x80 | ((cp >> 6) & 0x3f);
+		buf[len++] = 0x80 | (cp & 0x3f);
+	} else {
+		buf[len++] = 0xf0 | (cp >> 18);
+		buf[len++] = 0x80 | ((cp >> 12) & 0x3f);
+		buf[len++] = 0x80 | ((cp >> 6) & 0x3f);
+		buf[len++] = 0x80 | (cp & 0x3f);
+	}
+	buf[len] = '\0';
+	return len;
+}
+
+void *wnd_create_native(window_context_t *wnd, u32_t width, u32_t height, const char *title)
+{
+	window_native_t *native = IVY_CALLOC(1, sizeof(window_native_t));
+	if (!native) {
+		WARN("IVY_XCB: Unable to allocate memory");
+		return NULL;
+	}
+
+	native->conn = xcb_connect(NULL, NULL);
+	if (xcb_connection_has_error(native->conn)) {
+		WARN("IVY_XCB: Unable to open display");
+		xcb_disconnect(native->conn);
+		IVY_FREE(native);
+		return NULL;
+	}
+
+	const xcb_setup_t *setup = xcb_get_setup(native->conn);
+	native->screen = xcb_setup_roots_iterator(setup).data;
+	native->min_keycode = setup->min_keycode;
+
+	// Send every request we need a reply for up front, and only then
+	// wait for the replies, so creation costs a single round trip
+	xcb_intern_atom_cookie_t protocols_cookie = xcb_intern_atom(native->conn, 1, 12, "WM_PROTOCOLS");
+	xcb_intern_atom_cookie_t close_cookie = xcb_intern_atom(native->conn, 0, 16, "WM_DELETE_WINDOW");
+	xcb_get_keyboard_mapping_cookie_t keymap_cookie = xcb_get_keyboard_mapping(native->conn, setup->min_keycode, setup->max_keycode - setup->min_keycode + 1);
+	const xcb_query_extension_reply_t *shm_ext = xcb_get_extension_data(native->conn, &xcb_shm_id);
+
+	u32_t event_mask = XCB_EVENT_MASK_EXPOSURE | XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_KEY_RELEASE | XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE | XCB_EVENT_MASK_POINTER_MOTION | XCB_EVENT_MASK_ENTER_WINDOW | XCB_EVENT_MASK_LEAVE_WINDOW | XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+	u32_t values[] = {native->screen->black_pixel, event_mask};
+
+	native->wnd = xcb_generate_id(native->conn);
+	xcb_create_window(native->conn, XCB_COPY_FROM_PARENT, native->wnd, native->screen->root, 0, 0, width, height, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT, native->screen->root_visual, XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK, values);
+	xcb_change_property(native->conn, XCB_PROP_MODE_REPLACE, native->wnd, XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, strlen(title), title);
+
+	native->gc = xcb_generate_id(native->conn);
+	xcb_create_gc(native->conn, native->gc, native->wnd, 0, NULL);
+	xcb_map_window(native->conn, native->wnd);
+
+	xcb_intern_atom_reply_t *protocols = xcb_intern_atom_reply(native->conn, protocols_cookie, NULL);
+	xcb_intern_atom_reply_t *close = xcb_intern_atom_reply(native->conn, close_cookie, NULL);
+	if (protocols && close) {
+		native->wnd_close_atom = close->atom;
+		xcb_change_property(native->conn, XCB_PROP_MODE_REPLACE, native->wnd, protocols->atom, XCB_ATOM_ATOM, 32, 1, &close->atom);
+	} else {
+		WARN("IVY_XCB: Unable to register WM_DELETE_WINDOW");
+	}
+	free(protocols);
+	free(close);
+
+	_xcb_load_keymap(native, keymap_cookie);
+
+	native->has_shm = shm_ext && shm_ext->present;
+	if (native->has_shm && !_xcb_create_buffers(native, width, height)) {
+		WARN("IVY_XCB: MIT-SHM unavailable, falling back to xcb_put_image");
+		_xcb_destroy_buffers(native);
+		native->has_shm = 0;
+	}
+	if (native->has_shm) {
+		_xcb_attach_pixels(wnd, native);
+	}
+
+	xcb_flush(native->conn);
+	return native;
+}
+
+static void _xcb_put_image(window_native_t *native, pixel_array_t *pixels)
+{
+	// Split the image so every request fits the maximum request length
+	u32_t max_bytes = xcb_get_maximum_request_length(native->conn) * 4 - sizeof(xcb_put_image_request_t);
+	u32_t stride = pixels->width * sizeof(pixel_t);
+	int rows = stride ? max_bytes / stride : 0;
+	if (rows < 1) {
+		return;
+	}
+	for (int y = 0; y < pixels->height; y += rows) {
+		int h = (pixels->height - y < rows) ? pixels->height - y : rows;
+		xcb_put_image(native->conn, XCB_IMAGE_FORMAT_Z_PIXMAP, native->wnd, native->gc, pixels->width, h, 0, y, 0, native->screen->root_depth, h * stride, (const u8_t *)(pixels->buffer + y * pixels->width));
+	}
+}
+
+int wnd_update_native(window_context_t *wnd)
+{
+	window_native_t *native = wnd->native;
+	pixel_array_t *pixels = &wnd->pixels;
+
+	if (!native->has_shm) {
+		_xcb_put_image(native, pixels);
+		xcb_flush(native->conn);
+		return wnd->is_closed;
+	}
+
+	xcb_shm_buffer_t *buf = &native->buffers[native->back];
+	xcb_shm_put_image(native->conn, native->wnd, native->gc, pixels->width, pixels->height, 0, 0, pixels->width, pixels->height, 0, 0, native->screen->root_depth, XCB_IMAGE_FORMAT_Z_PIXMAP, 0, buf->seg, 0);
+	buf->fence = xcb_get_input_focus(native->conn);
+	buf->pending = 1;
+	xcb_flush(native->conn);
+
+	// Render the next frame into the other buffer, normally the server
+	// has long finished with it so this does not block. It still holds
+	// an older frame, carry over the one just presented so the pixels
+	// keep what the application drew, as on every other backend
+	pixel_t *presented = buf->data;
+	native->back = (native->back + 1) % IVY_XCB_BUFFERS;
+	buf = &native->buffers[native->back];
+	_xcb_wait_buffer(native, buf);
+	memcpy(buf->data, presented, (size_t)pixels->width * pixels->height * sizeof(pixel_t));
+	pixels->buffer = buf->data;
+	return wnd->is_closed;
+}
+
+static void _xcb_translate_event(window_context_t *wnd, window_native_t *native, xcb_generic_event_t *ev)
+{
+	wnd_event_t e = {.timestamp_ns = wnd_time_ns()};
+	switch (ev->response_type & ~0x80) {
+	case XCB_KEY_PRESS: {
+		xcb_key_press_event_t *kev = (xcb_key_press_event_t *)ev;
+		e.type = IVY_EVENT_KEY_PRESS;
+		e.mods = _get_mapped_mods(kev->state);
+		e.key = _get_mapped_key(_xcb_keysym(native, kev->detail, 0));
+		wnd_push_event(wnd, &e);
+
+		e.type = IVY_EVENT_TEXT_INPUT;
+		e.text_len = _xcb_lookup_text(native, kev->detail, kev->state, e.text, sizeof(e.text));
+	} break;
+	case XCB_KEY_RELEASE: {
+		xcb_key_release_event_t *kev = (xcb_key_release_event_t *)ev;
+		e.type = IVY_EVENT_KEY_RELEASE;
+		e.mods = _get_mapped_mods(kev->state);
+		e.key = _get_mapped_key(_xcb_keysym(native, kev->detail, 0));
+	} break;
+	case XCB_BUTTON_PRESS: {
+		xcb_button_press_event_t *bev = (xcb_button_press_event_t *)ev;
+		e.type = IVY_EVENT_KEY_PRESS;
+		e.mods = _get_mapped_mods(bev->state);
+		e.key = _get_mapped_key(bev->detail);
+	} break;
+	case XCB_BUTTON_RELEASE: {
+		xcb_button_release_event_t *bev = (xcb_button_release_event_t *)ev;
+		e.type = IVY_EVENT_KEY_RELEASE;
+		e.mods = _get_mapped_mods(bev->state);
+		e.key = _get_mapped_key(bev->detail);
+	} break;
+	case XCB_MOTION_NOTIFY: {
+		xcb_motion_notify_event_t *mev = (xcb_motion_notify_event_t *)ev;
+		e.type = IVY_EVENT_MOUSE_MOVE;
+		e.x = mev->event_x;
+		e.y = mev->event_y;
+	} break;
+	case XCB_ENTER_NOTIFY: {
+		xcb_enter_notify_event_t *cev = (xcb_enter_notify_event_t *)ev;
+		e.type = IVY_EVENT_MOUSE_ENTER;
+		e.x = cev->event_x;
+		e.y = cev->event_y;
+	} break;
+	case XCB_LEAVE_NOTIFY: {
+		xcb_leave_notify_event_t *cev = (xcb_leave_notify_event_t *)ev;
+		e.type = IVY_EVENT_MOUSE_LEAVE;
+		e.x = cev->event_x;
+		e.y = cev->event_y;
+	} break;
+	case XCB_CONFIGURE_NOTIFY: {
+		xcb_configure_notify_event_t *cev = (xcb_configure_notify_event_t *)ev;
+		if (cev->window == native->wnd) {
+			e.type = IVY_EVENT_WINDOW_RESIZE;
+			e.x = cev->width;
+			e.y = cev->height;
+		}
+	} break;
+	case XCB_CLIENT_MESSAGE: {
+		xcb_client_message_event_t *cev = (xcb_client_message_event_t *)ev;
+		if (cev->data.data32[0] == native->wnd_close_atom) {
+			e.type = IVY_EVENT_WINDOW_CLOSE;
+		}
+	} break;
+	default:
+		break;
+	}
+
+	if (e.type != IVY_EVENT_NONE) {
+		wnd_push_event(wnd, &e);
+	}
+}
+
+int wnd_poll_events_native(window_context_t *wnd, int timeout_ms)
+{
+	window_native_t *native = wnd->native;
+
+	if (xcb_connection_has_error(native->conn)) {
+		wnd_event_t e = {.type = IVY_EVENT_WINDOW_CLOSE, .timestamp_ns = wnd_time_ns()};
+		wnd_push_event(wnd, &e);
+		return 1;
+	}
+
+	xcb_generic_event_t *ev = xcb_poll_for_queued_event(native->conn);
+	if (!ev && timeout_ms != 0) {
+		struct pollfd pfd = {.fd = xcb_get_file_descriptor(native->conn), .events = POLLIN};
+		poll(&pfd, 1, timeout_ms);
+	}
+
+	int count = 0;
+	if (!ev) {
+		ev = xcb_poll_for_event(native->conn);
+	}
+	while (ev) {
+		_xcb_translate_event(wnd, native, ev);
+		free(ev);
+		count++;
+		ev = xcb_poll_for_event(native->conn);
+	}
+	return count;
+}
+
+void wnd_resize_native(window_context_t *wnd, int width, int height)
+{
+	window_native_t *native = wnd->native;
+	if (!native->has_shm) {
+		return;
+	}
+	_xcb_destroy_buffers(native);
+	if (!_xcb_create_buffers(native, width, height)) {
+		FATAL("IVY_XCB: Unable to resize shared memory images");
+	}
+	_xcb_attach_pixels(wnd, native);
+}
+
+void wnd_destroy_native(window_context_t *wnd)
+{
+	window_native_t *native = wnd->native;
+	if (native->has_shm) {
+		_xcb_destroy_buffers(native);
+	}
+	xcb_free_gc(native->conn, native->gc);
+	xcb_destroy_window(native->conn, native->wnd);
+	xcb_disconnect(native->conn);
+	IVY_FREE(native->keysyms);
+	IVY_FREE(native);
+}
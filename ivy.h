@@ -210,17 +210,131 @@ typedef struct {
 
 // IVY AUDIO STRUCTS
 
+// Sample format used by the device, apps always hand over float samples
+typedef enum {
+	IVY_AUDIO_FORMAT_F32 = 0,
+	IVY_AUDIO_FORMAT_S32,
+	IVY_AUDIO_FORMAT_S16,
+} IVY_AUDIO_FORMAT;
+
+typedef enum {
+	// Write straight into the device ring buffer (ALSA mmap access)
+	IVY_AUDIO_FLAG_MMAP = (1 << 0),
+} IVY_AUDIO_FLAG;
+
 typedef struct {
+	unsigned int channels;
+	unsigned int sample_rate;
+	float latency_secs;
+	int flags;
+} audio_config_t;
+
+typedef struct {
+	unsigned int channels;
+	unsigned int sample_rate;
+	int format;
+	int flags;
+	void *thread;
+	void *stats;
 	void *native;
 } audio_device_t;
 
+#define IVY_AUDIO_FILL_BUCKETS 16
+
+// Snapshot of the counters kept for every device since open or the last
+// audio_reset_stats
+typedef struct {
+	u64_t xruns;
+	u64_t recoveries;
+	u64_t writes;
+	// Device buffer fill at each write, bucket i counts writes that found
+	// the buffer between i and i + 1 sixteenths full
+	u64_t fill_histogram[IVY_AUDIO_FILL_BUCKETS];
+	// Time spent in the audio thread callback, percentiles are accurate
+	// to within 25%
+	u64_t callbacks;
+	u64_t callback_p50_ns;
+	u64_t callback_p90_ns;
+	u64_t callback_p99_ns;
+	u64_t callback_max_ns;
+	// Time from a write until its first frame is heard, as reported by
+	// the device at the last write
+	u64_t latency_ns;
+	u64_t latency_max_ns;
+} audio_stats_t;
+
+// Lock free single producer, single consumer ring of float frames
+typedef struct audio_ring_t audio_ring_t;
+
+// Called from the audio thread, must fill frames interleaved frames of buf
+typedef void (*audio_callback_t)(audio_device_t *audio, float *buf, size_t frames, void *user);
+
+// Interleaved float samples, not copied by the mixer. native is set when
+// the clip was loaded by ivy and must be released with audio_clip_free
+typedef struct {
+	const float *samples;
+	size_t frames;
+	unsigned int channels;
+	unsigned int sample_rate;
+	void *native;
+} audio_clip_t;
+
+// File decoded ahead of playback on a background thread
+typedef struct {
+	unsigned int channels;
+	unsigned int sample_rate;
+	size_t frames;
+	void *native;
+} audio_stream_t;
+
+typedef enum {
+	IVY_AUDIO_VOICE_LOOP = (1 << 0),
+	// Resamples the voice even at the mixer rate so its pitch can change
+	IVY_AUDIO_VOICE_PITCH = (1 << 1),
+} IVY_AUDIO_VOICE;
+
+// Handle to a playing voice, 0 is never a valid voice
+typedef u32_t audio_voice_t;
+
+typedef struct audio_mixer_t audio_mixer_t;
+
+// Streaming windowed sinc sample rate converter
+typedef struct audio_resampler_t audio_resampler_t;
+
+// Biquad sections available per DSP chain
+#define IVY_AUDIO_DSP_BIQUADS 8
+
+typedef enum {
+	IVY_AUDIO_BIQUAD_NONE = 0,
+	IVY_AUDIO_BIQUAD_LOWPASS,
+	IVY_AUDIO_BIQUAD_HIGHPASS,
+	IVY_AUDIO_BIQUAD_BANDPASS,
+	IVY_AUDIO_BIQUAD_NOTCH,
+	IVY_AUDIO_BIQUAD_PEAK,
+	IVY_AUDIO_BIQUAD_LOWSHELF,
+	IVY_AUDIO_BIQUAD_HIGHSHELF,
+} IVY_AUDIO_BIQUAD;
+
+// Positions mixer voices relative to a listener, see audio_spatializer_*
+typedef struct audio_spatializer_t audio_spatializer_t;
+
+// Handle to a spatialized source, 0 is never a valid source
+typedef u32_t audio_source_t;
+
+// Effects chain over interleaved float frames: biquads, compressor,
+// reverb, then limiter
+typedef struct audio_dsp_t audio_dsp_t;
+
 // IVY GFX STRUCTS
 typedef uint32_t pixel_t;
 
+// When external is set the buffer is owned by a window backend
+// (e.g. shared memory), gfx_resize and gfx_destroy will not free it
 typedef struct {
 	int width;
 	int height;
 	int max_size;
+	bool_t external;
 	pixel_t *buffer;
 } pixel_array_t;
 
@@ -366,6 +480,37 @@ typedef enum {
 	IVY_KEY_INVALID
 } IVY_KEY;
 
+typedef enum {
+	IVY_EVENT_NONE = 0,
+	IVY_EVENT_KEY_PRESS,
+	IVY_EVENT_KEY_RELEASE,
+	IVY_EVENT_MOUSE_MOVE,
+	IVY_EVENT_MOUSE_ENTER,
+	IVY_EVENT_MOUSE_LEAVE,
+	IVY_EVENT_TEXT_INPUT,
+	IVY_EVENT_WINDOW_RESIZE,
+	IVY_EVENT_WINDOW_CLOSE,
+} IVY_EVENT;
+
+// Backend independent window event
+// x, y holds mouse position for mouse events and new size for resize event
+typedef struct {
+	int type;
+	u64_t timestamp_ns;
+	int key, mods;
+	int x, y;
+	int text_len;
+	char text[32];
+} wnd_event_t;
+
+// Latest input state, can be sampled from any thread without locking
+typedef struct {
+	u64_t timestamp_ns;
+	int mouse_x, mouse_y;
+	int mods;
+	u8_t keys[IVY_KEY_LAST + 1];
+} wnd_input_t;
+
 typedef struct window_context_t window_context_t;
 
 struct window_context_t {
@@ -386,6 +531,7 @@ struct window_context_t {
 	void (*on_text_input)(window_context_t *wnd, const char *buf, int buf_size);
 	void (*on_window_resize)(window_context_t *wnd, int width, int height);
 
+	void *input;
 	void *native;
 };
 
@@ -404,13 +550,155 @@ EXTERN_C_START
 // IVY STL
 IVY_GLOBAL_API stl_data_t stl_load(const char *stl_filepath);
 IVY_GLOBAL_API void stl_free(stl_data_t stl_data);
+// Recomputes every face normal from its vertices, counter clockwise winding
+IVY_GLOBAL_API void stl_compute_normals(stl_data_t *stl_data);
 
 // IVY AUDIO
 IVY_GLOBAL_API audio_device_t audio_open(unsigned int channels, unsigned int sample_rate, float latency_secs);
+IVY_GLOBAL_API audio_device_t audio_open_config(audio_config_t config);
 IVY_GLOBAL_API int audio_avail_frames(audio_device_t *audio);
+// buf holds buf_size interleaved frames of float samples in [-1, 1]
 IVY_GLOBAL_API void audio_write_buffer(audio_device_t *audio, float *buf, size_t buf_size);
 IVY_GLOBAL_API void audio_close(audio_device_t *audio);
 
+// Zero copy writing, waits for room and returns where up to *frames
+// frames can be written, with *frames set to how many fit
+// With IVY_AUDIO_FLAG_MMAP and a float device it points into the device
+IVY_GLOBAL_API float *audio_begin_write(audio_device_t *audio, size_t *frames);
+IVY_GLOBAL_API void audio_end_write(audio_device_t *audio, size_t frames);
+
+// Runs callback on a real time priority thread which owns the device
+// audio must stay at the same address while the thread is running
+IVY_GLOBAL_API int audio_thread_start(audio_device_t *audio, audio_callback_t callback, void *user);
+// 1 once the thread gave up on a device that kept refusing writes,
+// audio_thread_stop must still be called before closing or restarting
+IVY_GLOBAL_API int audio_thread_failed(audio_device_t *audio);
+IVY_GLOBAL_API void audio_thread_stop(audio_device_t *audio);
+
+IVY_GLOBAL_API audio_ring_t *audio_ring_create(size_t frames, unsigned int channels);
+IVY_GLOBAL_API void audio_ring_destroy(audio_ring_t *ring);
+IVY_GLOBAL_API size_t audio_ring_readable(audio_ring_t *ring);
+IVY_GLOBAL_API size_t audio_ring_writable(audio_ring_t *ring);
+IVY_GLOBAL_API size_t audio_ring_write(audio_ring_t *ring, const float *buf, size_t frames);
+IVY_GLOBAL_API size_t audio_ring_read(audio_ring_t *ring, float *buf, size_t frames);
+// audio_callback_t reading from the ring passed as user, pads with silence
+IVY_GLOBAL_API void audio_ring_callback(audio_device_t *audio, float *buf, size_t frames, void *ring);
+
+// Cheap enough to leave on, counters are updated with relaxed atomics
+IVY_GLOBAL_API void audio_get_stats(audio_device_t *audio, audio_stats_t *stats);
+IVY_GLOBAL_API void audio_reset_stats(audio_device_t *audio);
+
+// Sample conversion, count is in samples
+// dither holds 4 non zero seeds, s16 output gets triangular dither
+IVY_GLOBAL_API void audio_f32_to_s16(i16_t *dst, const float *src, size_t count, u32_t dither[4]);
+IVY_GLOBAL_API void audio_f32_to_s32(i32_t *dst, const float *src, size_t count);
+
+// IVY AUDIO RESAMPLER
+IVY_GLOBAL_API audio_resampler_t *audio_resampler_create(unsigned int channels, unsigned int in_rate, unsigned int out_rate);
+IVY_GLOBAL_API void audio_resampler_destroy(audio_resampler_t *rs);
+// Forgets buffered input, for starting a new stream
+IVY_GLOBAL_API void audio_resampler_reset(audio_resampler_t *rs);
+// Scales the conversion ratio, the filter stays designed for pitch 1
+IVY_GLOBAL_API void audio_resampler_set_pitch(audio_resampler_t *rs, float pitch);
+// Reads up to *in_frames interleaved frames of in and writes up to
+// out_frames frames to out. *in_frames is set to the frames consumed,
+// returns the frames written. Input is buffered between calls
+IVY_GLOBAL_API size_t audio_resampler_process(audio_resampler_t *rs, const float *in, size_t *in_frames, float *out, size_t out_frames);
+
+// IVY AUDIO NATIVE
+// audio_open_config and audio_close wrap these, backends fill in format
+// and flags and report what the device does through the stats calls
+IVY_GLOBAL_API void *audio_open_native(audio_device_t *audio, audio_config_t config);
+IVY_GLOBAL_API void audio_close_native(audio_device_t *audio);
+IVY_GLOBAL_API void audio_stats_xrun(audio_device_t *audio);
+IVY_GLOBAL_API void audio_stats_recovery(audio_device_t *audio);
+// queued is the frames waiting in a buffer of capacity frames
+IVY_GLOBAL_API void audio_stats_write(audio_device_t *audio, size_t queued, size_t capacity);
+
+// IVY WAV
+// Loads PCM 8/16/24/32 bit or 32 bit float files. Float data is played
+// straight out of the mapped file, other formats are converted once
+IVY_GLOBAL_API audio_clip_t audio_clip_load_wav(const char *path);
+IVY_GLOBAL_API void audio_clip_free(audio_clip_t *clip);
+// Decodes the file in blocks on a background thread, resampled to
+// sample_rate unless it is 0. flags takes IVY_AUDIO_VOICE_LOOP
+IVY_GLOBAL_API audio_stream_t audio_stream_open_wav(const char *path, unsigned int sample_rate, int flags);
+// Lock free, safe to call from the audio thread. Returns fewer frames
+// than asked when the decoder falls behind or the file has ended
+IVY_GLOBAL_API size_t audio_stream_read(audio_stream_t *stream, float *buf, size_t frames);
+IVY_GLOBAL_API bool_t audio_stream_finished(audio_stream_t *stream);
+IVY_GLOBAL_API void audio_stream_close(audio_stream_t *stream);
+
+// IVY AUDIO MIXER
+// channels is the output channel count, 1 or 2. Clips at another rate than
+// sample_rate are resampled. Voice control must come from a single thread,
+// rendering may run on another (the audio thread)
+IVY_GLOBAL_API audio_mixer_t *audio_mixer_create(unsigned int max_voices, unsigned int channels, unsigned int sample_rate);
+IVY_GLOBAL_API void audio_mixer_destroy(audio_mixer_t *mixer);
+// pan goes from -1 (left) to 1 (right), returns 0 when no voice is free
+IVY_GLOBAL_API audio_voice_t audio_mixer_play(audio_mixer_t *mixer, const audio_clip_t *clip, float gain, float pan, int flags);
+// stream must be at the mixer rate and stay open while the voice plays
+IVY_GLOBAL_API audio_voice_t audio_mixer_play_stream(audio_mixer_t *mixer, audio_stream_t *stream, float gain, float pan);
+// Fades the voice out over a few milliseconds instead of cutting it
+IVY_GLOBAL_API void audio_mixer_stop(audio_mixer_t *mixer, audio_voice_t voice);
+IVY_GLOBAL_API void audio_mixer_set_gain(audio_mixer_t *mixer, audio_voice_t voice, float gain);
+IVY_GLOBAL_API void audio_mixer_set_pan(audio_mixer_t *mixer, audio_voice_t voice, float pan);
+// Playback speed factor, needs a voice played with IVY_AUDIO_VOICE_PITCH or
+// at another rate than the mixer
+IVY_GLOBAL_API void audio_mixer_set_pitch(audio_mixer_t *mixer, audio_voice_t voice, float pitch);
+// Gain, pan and pitch in a single command
+IVY_GLOBAL_API void audio_mixer_set_params(audio_mixer_t *mixer, audio_voice_t voice, float gain, float pan, float pitch);
+IVY_GLOBAL_API bool_t audio_mixer_playing(audio_mixer_t *mixer, audio_voice_t voice);
+// Overwrites frames interleaved frames of out with the mix of all voices
+IVY_GLOBAL_API void audio_mixer_render(audio_mixer_t *mixer, float *out, size_t frames);
+// audio_callback_t rendering the mixer passed as user
+IVY_GLOBAL_API void audio_mixer_callback(audio_device_t *audio, float *buf, size_t frames, void *mixer);
+// Runs dsp over every rendered block, NULL removes it. The chain must
+// match the mixer channels and rate, and outlive the mixer or be removed
+// and a block rendered before it is destroyed
+IVY_GLOBAL_API void audio_mixer_set_dsp(audio_mixer_t *mixer, audio_dsp_t *dsp);
+
+// IVY AUDIO SPATIALIZER
+// Drives gain, pan and pitch of mixer voices from 3D positions. Runs on
+// the control thread, all sources are recomputed in one batch per update
+IVY_GLOBAL_API audio_spatializer_t *audio_spatializer_create(audio_mixer_t *mixer, unsigned int max_sources);
+IVY_GLOBAL_API void audio_spatializer_destroy(audio_spatializer_t *sp);
+// view maps world to listener space, as built by mat4_lookat_lh/rh, with
+// +x to the right. velocity is in world units per second
+IVY_GLOBAL_API void audio_spatializer_set_listener(audio_spatializer_t *sp, mat4_t view, vec3_t velocity);
+// Units per second sound travels at, 0 disables doppler. Defaults to 343
+IVY_GLOBAL_API void audio_spatializer_set_speed_of_sound(audio_spatializer_t *sp, float speed);
+// Gain falls off as ref_distance / distance between ref_distance and
+// max_distance. Doppler needs the voice played with IVY_AUDIO_VOICE_PITCH.
+// Returns 0 when all sources are in use
+IVY_GLOBAL_API audio_source_t audio_spatializer_add(audio_spatializer_t *sp, audio_voice_t voice, float gain, float ref_distance, float max_distance);
+IVY_GLOBAL_API void audio_spatializer_remove(audio_spatializer_t *sp, audio_source_t source);
+IVY_GLOBAL_API void audio_spatializer_set_source(audio_spatializer_t *sp, audio_source_t source, vec3_t position, vec3_t velocity);
+// Sends the changed voice parameters to the mixer, call once per frame or
+// audio block
+IVY_GLOBAL_API void audio_spatializer_update(audio_spatializer_t *sp);
+
+// IVY AUDIO DSP
+// All memory is allocated here, processing never allocates or locks.
+// Setters come from a single control thread and take effect at the next
+// processed block
+IVY_GLOBAL_API audio_dsp_t *audio_dsp_create(unsigned int channels, unsigned int sample_rate);
+IVY_GLOBAL_API void audio_dsp_destroy(audio_dsp_t *dsp);
+// Every 4 sections in use add 3 frames of latency, counted up to the last
+// enabled section. Enabling or disabling the last section of a group
+// shifts the output by 3 frames, a group brought back starts from
+// silence. IVY_AUDIO_BIQUAD_NONE disables the section, gain_db only
+// applies to peak and shelf types
+IVY_GLOBAL_API void audio_dsp_set_biquad(audio_dsp_t *dsp, unsigned int section, int type, float freq, float q, float gain_db);
+// ratio 1 or below disables the compressor
+IVY_GLOBAL_API void audio_dsp_set_compressor(audio_dsp_t *dsp, float threshold_db, float ratio, float attack_ms, float release_ms, float makeup_db);
+// A ceiling above 0 dBFS disables the limiter
+IVY_GLOBAL_API void audio_dsp_set_limiter(audio_dsp_t *dsp, float ceiling_db, float release_ms);
+// room_size, damping and wet go from 0 to 1, wet 0 disables the reverb
+IVY_GLOBAL_API void audio_dsp_set_reverb(audio_dsp_t *dsp, float room_size, float damping, float wet);
+// Processes frames interleaved frames of buf in place
+IVY_GLOBAL_API void audio_dsp_process(audio_dsp_t *dsp, float *buf, size_t frames);
+
 // IVY GFX
 IVY_INLINE_API void _gfx_set_pixel_unsafe(pixel_array_t *ctx, int x, int y, pixel_t p)
 {
@@ -449,10 +737,20 @@ IVY_GLOBAL_API void gfx_draw_triangle(pixel_array_t *ctx, int sx, int sy, int ex
 IVY_GLOBAL_API window_context_t wnd_create(u32_t width, u32_t height, const char *title);
 IVY_GLOBAL_API int wnd_update(window_context_t *wnd);
 IVY_GLOBAL_API void wnd_destroy(window_context_t *wnd);
+IVY_GLOBAL_API u64_t wnd_time_ns(void);
+IVY_GLOBAL_API void wnd_push_event(window_context_t *wnd, const wnd_event_t *ev);
+IVY_GLOBAL_API wnd_input_t wnd_input_sample(window_context_t *wnd);
+
+// Reads events on a separate thread as soon as they arrive
+// wnd must stay at the same address while the thread is running
+IVY_GLOBAL_API int wnd_input_thread_start(window_context_t *wnd);
+IVY_GLOBAL_API void wnd_input_thread_stop(window_context_t *wnd);
 
 // IVY WND NATIVE
 IVY_GLOBAL_API void *wnd_create_native(window_context_t *wnd, u32_t width, u32_t height, const char *title);
 IVY_GLOBAL_API int wnd_update_native(window_context_t *wnd);
+IVY_GLOBAL_API int wnd_poll_events_native(window_context_t *wnd, int timeout_ms);
+IVY_GLOBAL_API void wnd_resize_native(window_context_t *wnd, int width, int height);
 IVY_GLOBAL_API void wnd_destroy_native(window_context_t *wnd);
 
 EXTERN_C_END
@@ -0,0 +1,465 @@
+#include "ivy.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Most frames rendered by the audio thread per write
+#ifndef IVY_AUDIO_BLOCK_FRAMES
+#define IVY_AUDIO_BLOCK_FRAMES 256
+#endif // IVY_AUDIO_BLOCK_FRAMES
+
+// Writes in a row the device may refuse before the audio thread gives up
+#ifndef IVY_AUDIO_MAX_FAILURES
+#define IVY_AUDIO_MAX_FAILURES 64
+#endif // IVY_AUDIO_MAX_FAILURES
+
+// Largest float below 1.0, keeps 1.0 * 2^31 from overflowing an i32
+#define AUDIO_S32_MAX_F 0.99999994f
+
+// Callback durations are kept in buckets of 4 per power of two, bucket
+// 4 * (e - 1) + m covers [(4 + m) << (e - 2), (5 + m) << (e - 2)) ns
+#define AUDIO_DURATION_BUCKETS 160
+
+typedef struct {
+	atomic_uint_fast64_t xruns;
+	atomic_uint_fast64_t recoveries;
+	atomic_uint_fast64_t writes;
+	atomic_uint_fast64_t fill[IVY_AUDIO_FILL_BUCKETS];
+	atomic_uint_fast64_t duration[AUDIO_DURATION_BUCKETS];
+	atomic_uint_fast64_t duration_max;
+	atomic_uint_fast64_t latency;
+	atomic_uint_fast64_t latency_max;
+} audio_stats_state_t;
+
+audio_device_t audio_open(unsigned int channels, unsigned int sample_rate, float latency_secs)
+{
+	return audio_open_config((audio_config_t){
+		.channels = channels,
+		.sample_rate = sample_rate,
+		.latency_secs = latency_secs,
+	});
+}
+
+audio_device_t audio_open_config(audio_config_t config)
+{
+	audio_device_t audio = {
+		.channels = config.channels,
+		.sample_rate = config.sample_rate,
+	};
+	audio.stats = IVY_CALLOC(1, sizeof(audio_stats_state_t));
+	if (!audio.stats) {
+		FATAL("Cannot allocate audio stats");
+	}
+	audio.native = audio_open_native(&audio, config);
+	return audio;
+}
+
+void audio_close(audio_device_t *audio)
+{
+	audio_thread_stop(audio);
+	audio_close_native(audio);
+	IVY_FREE(audio->stats);
+	audio->stats = NULL;
+	audio->native = NULL;
+}
+
+// ---------------------------------------------------------------
+// STATS
+
+static u64_t _audio_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline void _audio_count(atomic_uint_fast64_t *counter)
+{
+	atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+}
+
+// Only the audio thread raises these, so load and store is enough
+static inline void _audio_raise(atomic_uint_fast64_t *max, u64_t value)
+{
+	if (value > atomic_load_explicit(max, memory_order_relaxed)) {
+		atomic_store_explicit(max, value, memory_order_relaxed);
+	}
+}
+
+static int _audio_duration_bucket(u64_t ns)
+{
+	if (ns < 4) {
+		return ns;
+	}
+	int e = 63 - __builtin_clzll(ns);
+	int bucket = (e - 1) * 4 + ((ns >> (e - 2)) & 3);
+	return bucket < AUDIO_DURATION_BUCKETS ? bucket : AUDIO_DURATION_BUCKETS - 1;
+}
+
+static u64_t _audio_duration_upper(int bucket)
+{
+	if (bucket < 4) {
+		return bucket + 1;
+	}
+	int e = bucket / 4 + 1;
+	return (u64_t)(5 + bucket % 4) << (e - 2);
+}
+
+void audio_stats_xrun(audio_device_t *audio)
+{
+	audio_stats_state_t *st = audio->stats;
+	_audio_count(&st->xruns);
+}
+
+void audio_stats_recovery(audio_device_t *audio)
+{
+	audio_stats_state_t *st = audio->stats;
+	_audio_count(&st->recoveries);
+}
+
+void audio_stats_write(audio_device_t *audio, size_t queued, size_t capacity)
+{
+	audio_stats_state_t *st = audio->stats;
+	size_t bucket = capacity ? queued * IVY_AUDIO_FILL_BUCKETS / capacity : 0;
+	if (bucket >= IVY_AUDIO_FILL_BUCKETS) {
+		bucket = IVY_AUDIO_FILL_BUCKETS - 1;
+	}
+	_audio_count(&st->writes);
+	_audio_count(&st->fill[bucket]);
+	u64_t latency = (u64_t)queued * 1000000000ull / audio->sample_rate;
+	atomic_store_explicit(&st->latency, latency, memory_order_relaxed);
+	_audio_raise(&st->latency_max, latency);
+}
+
+static void _audio_stats_callback(audio_device_t *audio, u64_t ns)
+{
+	audio_stats_state_t *st = audio->stats;
+	_audio_count(&st->duration[_audio_duration_bucket(ns)]);
+	_audio_raise(&st->duration_max, ns);
+}
+
+void audio_get_stats(audio_device_t *audio, audio_stats_t *stats)
+{
+	audio_stats_state_t *st = audio->stats;
+	memset(stats, 0, sizeof(audio_stats_t));
+	stats->xruns = atomic_load_explicit(&st->xruns, memory_order_relaxed);
+	stats->recoveries = atomic_load_explicit(&st->recoveries, memory_order_relaxed);
+	stats->writes = atomic_load_explicit(&st->writes, memory_order_relaxed);
+	for (int i = 0; i < IVY_AUDIO_FILL_BUCKETS; i++) {
+		stats->fill_histogram[i] = atomic_load_explicit(&st->fill[i], memory_order_relaxed);
+	}
+	stats->latency_ns = atomic_load_explicit(&st->latency, memory_order_relaxed);
+	stats->latency_max_ns = atomic_load_explicit(&st->latency_max, memory_order_relaxed);
+	stats->callback_max_ns = atomic_load_explicit(&st->duration_max, memory_order_relaxed);
+
+	u64_t duration[AUDIO_DURATION_BUCKETS];
+	u64_t total = 0;
+	for (int i = 0; i < AUDIO_DURATION_BUCKETS; i++) {
+		duration[i] = atomic_load_explicit(&st->duration[i], memory_order_relaxed);
+		total += duration[i];
+	}
+	stats->callbacks = total;
+	u64_t *pct[] = {&stats->callback_p50_ns, &stats->callback_p90_ns, &stats->callback_p99_ns};
+	const u64_t rank[] = {50, 90, 99};
+	u64_t seen = 0;
+	int p = 0;
+	for (int i = 0; i < AUDIO_DURATION_BUCKETS && p < 3 && total; i++) {
+		seen += duration[i];
+		while (p < 3 && seen * 100 >= total * rank[p]) {
+			// The bucket bound can overshoot the slowest callback seen
+			u64_t upper = _audio_duration_upper(i);
+			*pct[p++] = upper < stats->callback_max_ns ? upper : stats->callback_max_ns;
+		}
+	}
+}
+
+void audio_reset_stats(audio_device_t *audio)
+{
+	// Every field is a counter of the same type
+	audio_stats_state_t *st = audio->stats;
+	atomic_uint_fast64_t *counters = (atomic_uint_fast64_t *)st;
+	for (size_t i = 0; i < sizeof(audio_stats_state_t) / sizeof(atomic_uint_fast64_t); i++) {
+		atomic_store_explicit(&counters[i], 0, memory_order_relaxed);
+	}
+}
+
+// ---------------------------------------------------------------
+// SAMPLE CONVERSION
+
+// Each of the 4 lanes runs its own xorshift32, the high and low 16 bits
+// of one step are two uniform values whose difference is triangular
+// dither of +-1 LSB. Scalar and SIMD paths produce the same output.
+static inline u32_t _audio_xorshift(u32_t x)
+{
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+static inline float _audio_tpdf(u32_t x)
+{
+	return (float)((i32_t)(x >> 16) - (i32_t)(x & 0xffff)) * (1.0f / 65536.0f);
+}
+
+void audio_f32_to_s16(i16_t *dst, const float *src, size_t count, u32_t dither[4])
+{
+	size_t i = 0;
+#if defined(__SSE2__)
+	__m128i seed = _mm_loadu_si128((const __m128i *)dither);
+	const __m128i mask = _mm_set1_epi32(0xffff);
+	const __m128 lo = _mm_set1_ps(-1.0f);
+	const __m128 hi = _mm_set1_ps(1.0f);
+	const __m128 scale = _mm_set1_ps(32767.0f);
+	const __m128 dscale = _mm_set1_ps(1.0f / 65536.0f);
+	for (; i + 8 <= count; i += 8) {
+		__m128 d[2];
+		for (int k = 0; k < 2; k++) {
+			seed = _mm_xor_si128(seed, _mm_slli_epi32(seed, 13));
+			seed = _mm_xor_si128(seed, _mm_srli_epi32(seed, 17));
+			seed = _mm_xor_si128(seed, _mm_slli_epi32(seed, 5));
+			__m128i tri = _mm_sub_epi32(_mm_srli_epi32(seed, 16), _mm_and_si128(seed, mask));
+			d[k] = _mm_mul_ps(_mm_cvtepi32_ps(tri), dscale);
+		}
+		__m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), lo), hi);
+		__m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), lo), hi);
+		a = _mm_add_ps(_mm_mul_ps(a, scale), d[0]);
+		b = _mm_add_ps(_mm_mul_ps(b, scale), d[1]);
+		__m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+		_mm_storeu_si128((__m128i *)(dst + i), packed);
+	}
+	_mm_storeu_si128((__m128i *)dither, seed);
+#endif
+	for (; i < count; i++) {
+		u32_t *seed = &dither[i & 3];
+		*seed = _audio_xorshift(*seed);
+		float v = fminf(fmaxf(src[i], -1.0f), 1.0f) * 32767.0f + _audio_tpdf(*seed);
+		long s = lrintf(v);
+		dst[i] = s > 32767 ? 32767 : (s < -32768 ? -32768 : s);
+	}
+}
+
+// float only carries 24 bits of precision, so s32 output needs no dither
+void audio_f32_to_s32(i32_t *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+#if defined(__SSE2__)
+	const __m128 lo = _mm_set1_ps(-1.0f);
+	const __m128 hi = _mm_set1_ps(AUDIO_S32_MAX_F);
+	const __m128 scale = _mm_set1_ps(2147483648.0f);
+	for (; i + 8 <= count; i += 8) {
+		__m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), lo), hi);
+		__m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), lo), hi);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_cvtps_epi32(_mm_mul_ps(a, scale)));
+		_mm_storeu_si128((__m128i *)(dst + i + 4), _mm_cvtps_epi32(_mm_mul_ps(b, scale)));
+	}
+#endif
+	for (; i < count; i++) {
+		float v = fminf(fmaxf(src[i], -1.0f), AUDIO_S32_MAX_F) * 2147483648.0f;
+		dst[i] = (i32_t)lrintf(v);
+	}
+}
+
+// ---------------------------------------------------------------
+// RING BUFFER
+
+struct audio_ring_t {
+	float *data;
+	size_t capacity; // frames, power of two
+	unsigned int channels;
+	atomic_size_t write_pos;
+	atomic_size_t read_pos;
+};
+
+audio_ring_t *audio_ring_create(size_t frames, unsigned int channels)
+{
+	size_t capacity = 1;
+	while (capacity < frames) {
+		capacity <<= 1;
+	}
+	audio_ring_t *ring = IVY_CALLOC(1, sizeof(audio_ring_t));
+	if (!ring) {
+		WARN("IVY AUDIO: Unable to allocate ring buffer");
+		return NULL;
+	}
+	ring->data = IVY_CALLOC(capacity * channels, sizeof(float));
+	if (!ring->data) {
+		WARN("IVY AUDIO: Unable to allocate ring buffer");
+		IVY_FREE(ring);
+		return NULL;
+	}
+	ring->capacity = capacity;
+	ring->channels = channels;
+	return ring;
+}
+
+void audio_ring_destroy(audio_ring_t *ring)
+{
+	if (ring) {
+		IVY_FREE(ring->data);
+		IVY_FREE(ring);
+	}
+}
+
+size_t audio_ring_readable(audio_ring_t *ring)
+{
+	size_t w = atomic_load_explicit(&ring->write_pos, memory_order_acquire);
+	size_t r = atomic_load_explicit(&ring->read_pos, memory_order_relaxed);
+	return w - r;
+}
+
+size_t audio_ring_writable(audio_ring_t *ring)
+{
+	size_t w = atomic_load_explicit(&ring->write_pos, memory_order_relaxed);
+	size_t r = atomic_load_explicit(&ring->read_pos, memory_order_acquire);
+	return ring->capacity - (w - r);
+}
+
+size_t audio_ring_write(audio_ring_t *ring, const float *buf, size_t frames)
+{
+	size_t w = atomic_load_explicit(&ring->write_pos, memory_order_relaxed);
+	size_t r = atomic_load_explicit(&ring->read_pos, memory_order_acquire);
+	size_t space = ring->capacity - (w - r);
+	if (frames > space) {
+		frames = space;
+	}
+	size_t start = w & (ring->capacity - 1);
+	size_t first = ring->capacity - start < frames ? ring->capacity - start : frames;
+	size_t ch = ring->channels;
+	memcpy(ring->data + start * ch, buf, first * ch * sizeof(float));
+	memcpy(ring->data, buf + first * ch, (frames - first) * ch * sizeof(float));
+	atomic_store_explicit(&ring->write_pos, w + frames, memory_order_release);
+	return frames;
+}
+
+size_t audio_ring_read(audio_ring_t *ring, float *buf, size_t frames)
+{
+	size_t r = atomic_load_explicit(&ring->read_pos, memory_order_relaxed);
+	size_t w = atomic_load_explicit(&ring->write_pos, memory_order_acquire);
+	if (frames > w - r) {
+		frames = w - r;
+	}
+	size_t start = r & (ring->capacity - 1);
+	size_t first = ring->capacity - start < frames ? ring->capacity - start : frames;
+	size_t ch = ring->channels;
+	memcpy(buf, ring->data + start * ch, first * ch * sizeof(float));
+	memcpy(buf + first * ch, ring->data, (frames - first) * ch * sizeof(float));
+	atomic_store_explicit(&ring->read_pos, r + frames, memory_order_release);
+	return frames;
+}
+
+void audio_ring_callback(audio_device_t *audio, float *buf, size_t frames, void *ring)
+{
+	size_t got = audio_ring_read(ring, buf, frames);
+	if (got < frames) {
+		// Producer fell behind, play silence instead of stale samples
+		memset(buf + got * audio->channels, 0, (frames - got) * audio->channels * sizeof(float));
+	}
+}
+
+// ---------------------------------------------------------------
+// AUDIO THREAD
+
+typedef struct {
+	pthread_t thread;
+	atomic_bool running;
+	atomic_bool failed;
+	audio_device_t *audio;
+	audio_callback_t callback;
+	void *user;
+} audio_thread_t;
+
+static void *_audio_thread(void *arg)
+{
+	audio_thread_t *t = arg;
+	audio_device_t *audio = t->audio;
+	// A refused write did not block, so sleep a block instead of spinning
+	// at real time priority while the device fails to recover
+	long nap = (long)(IVY_AUDIO_BLOCK_FRAMES * 1000000000.0 / audio->sample_rate);
+	struct timespec ts = {nap / 1000000000, nap % 1000000000};
+	int failures = 0;
+	while (atomic_load_explicit(&t->running, memory_order_acquire)) {
+		// Blocks until the device has room, which paces the thread
+		size_t frames = IVY_AUDIO_BLOCK_FRAMES;
+		float *buf = audio_begin_write(audio, &frames);
+		if (!buf || !frames) {
+			if (++failures >= IVY_AUDIO_MAX_FAILURES) {
+				WARN("IVY AUDIO: Device stopped accepting writes, audio thread exiting");
+				atomic_store_explicit(&t->failed, 1, memory_order_release);
+				break;
+			}
+			nanosleep(&ts, NULL);
+			continue;
+		}
+		failures = 0;
+		u64_t start = _audio_now_ns();
+		t->callback(audio, buf, frames, t->user);
+		_audio_stats_callback(audio, _audio_now_ns() - start);
+		audio_end_write(audio, frames);
+	}
+	return NULL;
+}
+
+int audio_thread_start(audio_device_t *audio, audio_callback_t callback, void *user)
+{
+	if (audio->thread) {
+		WARN("IVY AUDIO: Audio thread already running");
+		return 0;
+	}
+	audio_thread_t *t = IVY_CALLOC(1, sizeof(audio_thread_t));
+	if (!t) {
+		WARN("IVY AUDIO: Unable to allocate audio thread");
+		return 0;
+	}
+	t->audio = audio;
+	t->callback = callback;
+	t->user = user;
+	atomic_store(&t->running, 1);
+
+	// Ask for real time scheduling, fall back to a normal thread when
+	// the process is not allowed to (no CAP_SYS_NICE or rtprio limit)
+	pthread_attr_t attr;
+	struct sched_param param = {.sched_priority = sched_get_priority_min(SCHED_FIFO) + 10};
+	pthread_attr_init(&attr);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+	pthread_attr_setschedparam(&attr, &param);
+	int err = pthread_create(&t->thread, &attr, _audio_thread, t);
+	pthread_attr_destroy(&attr);
+	if (err) {
+		WARN("IVY AUDIO: Real time priority not permitted, using normal priority");
+		err = pthread_create(&t->thread, NULL, _audio_thread, t);
+	}
+	if (err) {
+		WARN("IVY AUDIO: Unable to create audio thread");
+		IVY_FREE(t);
+		return 0;
+	}
+	audio->thread = t;
+	return 1;
+}
+
+int audio_thread_failed(audio_device_t *audio)
+{
+	audio_thread_t *t = audio->thread;
+	return t && atomic_load_explicit(&t->failed, memory_order_acquire);
+}
+
+void audio_thread_stop(audio_device_t *audio)
+{
+	audio_thread_t *t = audio->thread;
+	if (!t) {
+		return;
+	}
+	atomic_store(&t->running, 0);
+	pthread_join(t->thread, NULL);
+	IVY_FREE(t);
+	audio->thread = NULL;
+}
@@ -0,0 +1,494 @@
+#include "ivy.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Sections run 4 at a time, one per SIMD lane
+#define DSP_LANES 4
+#define DSP_GROUPS ((IVY_AUDIO_DSP_BIQUADS + DSP_LANES - 1) / DSP_LANES)
+
+#define DSP_COMBS 4
+#define DSP_ALLPASSES 2
+
+// Freeverb tunings at 44.1kHz, in frames
+static const int dsp_comb_tuning[DSP_COMBS] = {1116, 1188, 1277, 1356};
+static const int dsp_allpass_tuning[DSP_ALLPASSES] = {556, 441};
+// Extra delay per channel, decorrelates the sides
+#define DSP_STEREO_SPREAD 23
+#define DSP_REVERB_INPUT 0.015f
+#define DSP_REVERB_WET_SCALE 3.0f
+
+// Coefficients of up to 4 cascaded biquads, lane i is section i of the
+// group. A disabled section passes its input through
+typedef struct {
+	float b0[DSP_LANES];
+	float b1[DSP_LANES];
+	float b2[DSP_LANES];
+	float a1[DSP_LANES];
+	float a2[DSP_LANES];
+} dsp_biquads_t;
+
+// Transposed direct form II state. The group is pipelined, y holds the
+// previous output of every lane which the next lane takes as input
+typedef struct {
+	float z1[DSP_LANES];
+	float z2[DSP_LANES];
+	float y[DSP_LANES];
+} dsp_biquad_state_t;
+
+// Everything the audio thread needs, published as one snapshot
+typedef struct {
+	dsp_biquads_t biquads[DSP_GROUPS];
+	int groups;
+
+	bool_t compressor;
+	float comp_threshold_db;
+	float comp_slope;
+	float comp_attack;
+	float comp_release;
+	float comp_makeup;
+
+	bool_t limiter;
+	float limit_ceiling;
+	float limit_release;
+
+	bool_t reverb;
+	float reverb_feedback;
+	float reverb_damp;
+	float reverb_wet;
+	float reverb_dry;
+} dsp_config_t;
+
+typedef struct {
+	float *buf;
+	int size;
+	int pos;
+	float store;
+} dsp_delay_t;
+
+struct audio_dsp_t {
+	unsigned int channels;
+	unsigned int sample_rate;
+
+	// Control side copy, every setter edits it and republishes
+	dsp_config_t staged;
+	bool_t enabled[IVY_AUDIO_DSP_BIQUADS];
+
+	// Seqlock protected snapshot shared with the audio thread
+	atomic_uint seq;
+	dsp_config_t shared;
+
+	// Audio thread only
+	unsigned int seen;
+	dsp_config_t active;
+	dsp_biquad_state_t *state; // channels * DSP_GROUPS
+	float comp_env;
+	float limit_gain;
+	dsp_delay_t *combs;		// channels * DSP_COMBS
+	dsp_delay_t *allpasses; // channels * DSP_ALLPASSES
+	float *delay_memory;
+};
+
+// ---------------------------------------------------------------
+// BIQUADS
+
+static void _dsp_biquad_passthrough(dsp_biquads_t *group, int lane)
+{
+	group->b0[lane] = 1.0f;
+	group->b1[lane] = group->b2[lane] = 0.0f;
+	group->a1[lane] = group->a2[lane] = 0.0f;
+}
+
+// Audio EQ cookbook coefficients, normalized so a0 is 1
+static void _dsp_biquad_design(dsp_biquads_t *group, int lane, int type, double w0, double q, double gain_db)
+{
+	double a = pow(10.0, gain_db / 40.0);
+	double cw = cos(w0), sw = sin(w0);
+	double alpha = sw / (2.0 * q);
+	double sa = 2.0 * sqrt(a) * alpha;
+	double b0, b1, b2, a0, a1, a2;
+	switch (type) {
+	case IVY_AUDIO_BIQUAD_LOWPASS:
+		b0 = (1.0 - cw) / 2.0, b1 = 1.0 - cw, b2 = (1.0 - cw) / 2.0;
+		a0 = 1.0 + alpha, a1 = -2.0 * cw, a2 = 1.0 - alpha;
+		break;
+	case IVY_AUDIO_BIQUAD_HIGHPASS:
+		b0 = (1.0 + cw) / 2.0, b1 = -(1.0 + cw), b2 = (1.0 + cw) / 2.0;
+		a0 = 1.0 + alpha, a1 = -2.0 * cw, a2 = 1.0 - alpha;
+		break;
+	case IVY_AUDIO_BIQUAD_BANDPASS:
+		b0 = alpha, b1 = 0.0, b2 = -alpha;
+		a0 = 1.0 + alpha, a1 = -2.0 * cw, a2 = 1.0 - alpha;
+		break;
+	case IVY_AUDIO_BIQUAD_NOTCH:
+		b0 = 1.0, b1 = -2.0 * cw, b2 = 1.0;
+		a0 = 1.0 + alpha, a1 = -2.0 * cw, a2 = 1.0 - alpha;
+		break;
+	case IVY_AUDIO_BIQUAD_PEAK:
+		b0 = 1.0 + alpha * a, b1 = -2.0 * cw, b2 = 1.0 - alpha * a;
+		a0 = 1.0 + alpha / a, a1 = -2.0 * cw, a2 = 1.0 - alpha / a;
+		break;
+	case IVY_AUDIO_BIQUAD_LOWSHELF:
+		b0 = a * ((a + 1.0) - (a - 1.0) * cw + sa);
+		b1 = 2.0 * a * ((a - 1.0) - (a + 1.0) * cw);
+		b2 = a * ((a + 1.0) - (a - 1.0) * cw - sa);
+		a0 = (a + 1.0) + (a - 1.0) * cw + sa;
+		a1 = -2.0 * ((a - 1.0) + (a + 1.0) * cw);
+		a2 = (a + 1.0) + (a - 1.0) * cw - sa;
+		break;
+	case IVY_AUDIO_BIQUAD_HIGHSHELF:
+		b0 = a * ((a + 1.0) + (a - 1.0) * cw + sa);
+		b1 = -2.0 * a * ((a - 1.0) + (a + 1.0) * cw);
+		b2 = a * ((a + 1.0) + (a - 1.0) * cw - sa);
+		a0 = (a + 1.0) - (a - 1.0) * cw + sa;
+		a1 = 2.0 * ((a - 1.0) - (a + 1.0) * cw);
+		a2 = (a + 1.0) - (a - 1.0) * cw - sa;
+		break;
+	default:
+		_dsp_biquad_passthrough(group, lane);
+		return;
+	}
+	group->b0[lane] = b0 / a0;
+	group->b1[lane] = b1 / a0;
+	group->b2[lane] = b2 / a0;
+	group->a1[lane] = a1 / a0;
+	group->a2[lane] = a2 / a0;
+}
+
+// Lane i works on the frame i frames behind lane 0, so a group adds
+// DSP_LANES - 1 frames of latency and the 4 sections run side by side
+#if defined(__SSE2__)
+static void _dsp_biquads_sse(const dsp_biquads_t *c, dsp_biquad_state_t *s, float *buf, size_t frames, unsigned int stride)
+{
+	const __m128 b0 = _mm_loadu_ps(c->b0);
+	const __m128 b1 = _mm_loadu_ps(c->b1);
+	const __m128 b2 = _mm_loadu_ps(c->b2);
+	const __m128 a1 = _mm_loadu_ps(c->a1);
+	const __m128 a2 = _mm_loadu_ps(c->a2);
+	__m128 z1 = _mm_loadu_ps(s->z1);
+	__m128 z2 = _mm_loadu_ps(s->z2);
+	__m128 y = _mm_loadu_ps(s->y);
+	for (size_t i = 0; i < frames; i++) {
+		// Shift the previous outputs up a lane and feed the new frame in
+		__m128 x = _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(y), 4));
+		x = _mm_move_ss(x, _mm_set_ss(buf[i * stride]));
+		y = _mm_add_ps(_mm_mul_ps(b0, x), z1);
+		z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), z2);
+		z2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+		buf[i * stride] = _mm_cvtss_f32(_mm_shuffle_ps(y, y, _MM_SHUFFLE(3, 3, 3, 3)));
+	}
+	_mm_storeu_ps(s->z1, z1);
+	_mm_storeu_ps(s->z2, z2);
+	_mm_storeu_ps(s->y, y);
+}
+#else
+static void _dsp_biquads_scalar(const dsp_biquads_t *c, dsp_biquad_state_t *s, float *buf, size_t frames, unsigned int stride)
+{
+	float z1[DSP_LANES], z2[DSP_LANES], y[DSP_LANES];
+	memcpy(z1, s->z1, sizeof(z1));
+	memcpy(z2, s->z2, sizeof(z2));
+	memcpy(y, s->y, sizeof(y));
+	for (size_t i = 0; i < frames; i++) {
+		float x[DSP_LANES] = {buf[i * stride], y[0], y[1], y[2]};
+		for (int k = 0; k < DSP_LANES; k++) {
+			y[k] = c->b0[k] * x[k] + z1[k];
+			z1[k] = c->b1[k] * x[k] - c->a1[k] * y[k] + z2[k];
+			z2[k] = c->b2[k] * x[k] - c->a2[k] * y[k];
+		}
+		buf[i * stride] = y[DSP_LANES - 1];
+	}
+	memcpy(s->z1, z1, sizeof(z1));
+	memcpy(s->z2, z2, sizeof(z2));
+	memcpy(s->y, y, sizeof(y));
+}
+#endif
+
+static void _dsp_biquads(audio_dsp_t *dsp, float *buf, size_t frames)
+{
+	for (unsigned int ch = 0; ch < dsp->channels; ch++) {
+		for (int g = 0; g < dsp->active.groups; g++) {
+			dsp_biquad_state_t *s = &dsp->state[ch * DSP_GROUPS + g];
+#if defined(__SSE2__)
+			_dsp_biquads_sse(&dsp->active.biquads[g], s, buf + ch, frames, dsp->channels);
+#else
+			_dsp_biquads_scalar(&dsp->active.biquads[g], s, buf + ch, frames, dsp->channels);
+#endif
+		}
+	}
+}
+
+// ---------------------------------------------------------------
+// DYNAMICS
+
+static void _dsp_compress(audio_dsp_t *dsp, float *buf, size_t frames)
+{
+	const dsp_config_t *c = &dsp->active;
+	unsigned int ch = dsp->channels;
+	float env = dsp->comp_env;
+	for (size_t i = 0; i < frames; i++) {
+		// Channels are linked so the stereo image does not move
+		float level = 0.0f;
+		for (unsigned int k = 0; k < ch; k++) {
+			level = fmaxf(level, fabsf(buf[i * ch + k]));
+		}
+		float coef = level > env ? c->comp_attack : c->comp_release;
+		env = level + (env - level) * coef;
+		float gain = c->comp_makeup;
+		float env_db = 20.0f * log10f(env + 1e-20f);
+		if (env_db > c->comp_threshold_db) {
+			gain *= exp2f((c->comp_threshold_db - env_db) * c->comp_slope * (3.32192809f / 20.0f));
+		}
+		for (unsigned int k = 0; k < ch; k++) {
+			buf[i * ch + k] *= gain;
+		}
+	}
+	dsp->comp_env = env;
+}
+
+// Instant attack keeps every sample under the ceiling
+static void _dsp_limit(audio_dsp_t *dsp, float *buf, size_t frames)
+{
+	const dsp_config_t *c = &dsp->active;
+	unsigned int ch = dsp->channels;
+	float gain = dsp->limit_gain;
+	for (size_t i = 0; i < frames; i++) {
+		float peak = 0.0f;
+		for (unsigned int k = 0; k < ch; k++) {
+			peak = fmaxf(peak, fabsf(buf[i * ch + k]));
+		}
+		gain = 1.0f + (gain - 1.0f) * c->limit_release;
+		if (peak * gain > c->limit_ceiling) {
+			gain = c->limit_ceiling / peak;
+		}
+		for (unsigned int k = 0; k < ch; k++) {
+			buf[i * ch + k] *= gain;
+		}
+	}
+	dsp->limit_gain = gain;
+}
+
+// ---------------------------------------------------------------
+// REVERB
+
+// Schroeder reverb as in freeverb, parallel damped combs into allpasses
+static void _dsp_reverb(audio_dsp_t *dsp, float *buf, size_t frames)
+{
+	const dsp_config_t *c = &dsp->active;
+	unsigned int ch = dsp->channels;
+	float damp = c->reverb_damp;
+	for (size_t i = 0; i < frames; i++) {
+		float in = 0.0f;
+		for (unsigned int k = 0; k < ch; k++) {
+			in += buf[i * ch + k];
+		}
+		in *= DSP_REVERB_INPUT;
+		for (unsigned int k = 0; k < ch; k++) {
+			float out = 0.0f;
+			dsp_delay_t *comb = &dsp->combs[k * DSP_COMBS];
+			for (int j = 0; j < DSP_COMBS; j++) {
+				dsp_delay_t *d = &comb[j];
+				float v = d->buf[d->pos];
+				d->store = v + (d->store - v) * damp;
+				d->buf[d->pos] = in + d->store * c->reverb_feedback;
+				d->pos = d->pos + 1 == d->size ? 0 : d->pos + 1;
+				out += v;
+			}
+			dsp_delay_t *allpass = &dsp->allpasses[k * DSP_ALLPASSES];
+			for (int j = 0; j < DSP_ALLPASSES; j++) {
+				dsp_delay_t *d = &allpass[j];
+				float v = d->buf[d->pos];
+				d->buf[d->pos] = out + v * 0.5f;
+				d->pos = d->pos + 1 == d->size ? 0 : d->pos + 1;
+				out = v - out;
+			}
+			float *x = &buf[i * ch + k];
+			*x = *x * c->reverb_dry + out * c->reverb_wet;
+		}
+	}
+}
+
+// ---------------------------------------------------------------
+// CHAIN
+
+void audio_dsp_process(audio_dsp_t *dsp, float *buf, size_t frames)
+{
+	// Picks up a new configuration between blocks, a torn read keeps the
+	// old one and is retried on the next block
+	unsigned int seq0 = atomic_load_explicit(&dsp->seq, memory_order_acquire);
+	if (seq0 != dsp->seen && !(seq0 & 1)) {
+		dsp_config_t config;
+		memcpy(&config, &dsp->shared, sizeof(config));
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(&dsp->seq, memory_order_relaxed) == seq0) {
+			// Skipped groups kept the state they stopped with, groups
+			// coming back start from silence instead of a stale click
+			for (int g = dsp->active.groups; g < config.groups; g++) {
+				for (unsigned int ch = 0; ch < dsp->channels; ch++) {
+					memset(&dsp->state[ch * DSP_GROUPS + g], 0, sizeof(dsp_biquad_state_t));
+				}
+			}
+			dsp->active = config;
+			dsp->seen = seq0;
+		}
+	}
+
+	const dsp_config_t *c = &dsp->active;
+	_dsp_biquads(dsp, buf, frames);
+	if (c->compressor) {
+		_dsp_compress(dsp, buf, frames);
+	}
+	if (c->reverb) {
+		_dsp_reverb(dsp, buf, frames);
+	}
+	if (c->limiter) {
+		_dsp_limit(dsp, buf, frames);
+	}
+}
+
+static void _dsp_publish(audio_dsp_t *dsp)
+{
+	unsigned int seq = atomic_load_explicit(&dsp->seq, memory_order_relaxed);
+	atomic_store_explicit(&dsp->seq, seq + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	memcpy(&dsp->shared, &dsp->staged, sizeof(dsp_config_t));
+	atomic_store_explicit(&dsp->seq, seq + 2, memory_order_release);
+}
+
+audio_dsp_t *audio_dsp_create(unsigned int channels, unsigned int sample_rate)
+{
+	if (!channels || !sample_rate) {
+		WARN("IVY AUDIO: DSP chain needs non zero channels and rate");
+		return NULL;
+	}
+	audio_dsp_t *dsp = IVY_CALLOC(1, sizeof(audio_dsp_t));
+	if (!dsp) {
+		WARN("IVY AUDIO: Unable to allocate DSP chain");
+		return NULL;
+	}
+	dsp->channels = channels;
+	dsp->sample_rate = sample_rate;
+	dsp->state = IVY_CALLOC(channels * DSP_GROUPS, sizeof(dsp_biquad_state_t));
+	dsp->combs = IVY_CALLOC(channels * DSP_COMBS, sizeof(dsp_delay_t));
+	dsp->allpasses = IVY_CALLOC(channels * DSP_ALLPASSES, sizeof(dsp_delay_t));
+
+	// Every delay line is sized for the rate up front, so reconfiguring
+	// never allocates
+	double scale = sample_rate / 44100.0;
+	size_t total = 0;
+	for (unsigned int k = 0; k < channels; k++) {
+		for (int j = 0; j < DSP_COMBS; j++) {
+			total += (dsp_comb_tuning[j] + k * DSP_STEREO_SPREAD) * scale + 1;
+		}
+		for (int j = 0; j < DSP_ALLPASSES; j++) {
+			total += (dsp_allpass_tuning[j] + k * DSP_STEREO_SPREAD) * scale + 1;
+		}
+	}
+	dsp->delay_memory = IVY_CALLOC(total, sizeof(float));
+	if (!dsp->state || !dsp->combs || !dsp->allpasses || !dsp->delay_memory) {
+		WARN("IVY AUDIO: Unable to allocate DSP chain");
+		audio_dsp_destroy(dsp);
+		return NULL;
+	}
+	float *mem = dsp->delay_memory;
+	for (unsigned int k = 0; k < channels; k++) {
+		for (int j = 0; j < DSP_COMBS; j++) {
+			dsp_delay_t *d = &dsp->combs[k * DSP_COMBS + j];
+			d->size = (dsp_comb_tuning[j] + k * DSP_STEREO_SPREAD) * scale + 1;
+			d->buf = mem;
+			mem += d->size;
+		}
+		for (int j = 0; j < DSP_ALLPASSES; j++) {
+			dsp_delay_t *d = &dsp->allpasses[k * DSP_ALLPASSES + j];
+			d->size = (dsp_allpass_tuning[j] + k * DSP_STEREO_SPREAD) * scale + 1;
+			d->buf = mem;
+			mem += d->size;
+		}
+	}
+
+	for (int i = 0; i < IVY_AUDIO_DSP_BIQUADS; i++) {
+		_dsp_biquad_passthrough(&dsp->staged.biquads[i / DSP_LANES], i % DSP_LANES);
+	}
+	dsp->limit_gain = 1.0f;
+	_dsp_publish(dsp);
+	return dsp;
+}
+
+void audio_dsp_destroy(audio_dsp_t *dsp)
+{
+	if (dsp) {
+		IVY_FREE(dsp->state);
+		IVY_FREE(dsp->combs);
+		IVY_FREE(dsp->allpasses);
+		IVY_FREE(dsp->delay_memory);
+		IVY_FREE(dsp);
+	}
+}
+
+static float _dsp_coef(audio_dsp_t *dsp, float ms)
+{
+	return ms > 0.0f ? expf(-1000.0f / (ms * dsp->sample_rate)) : 0.0f;
+}
+
+void audio_dsp_set_biquad(audio_dsp_t *dsp, unsigned int section, int type, float freq, float q, float gain_db)
+{
+	if (section >= IVY_AUDIO_DSP_BIQUADS) {
+		WARN("IVY AUDIO: DSP chain has %d biquad sections", IVY_AUDIO_DSP_BIQUADS);
+		return;
+	}
+	dsp_biquads_t *group = &dsp->staged.biquads[section / DSP_LANES];
+	int lane = section % DSP_LANES;
+	double nyquist = dsp->sample_rate * 0.5;
+	if (type == IVY_AUDIO_BIQUAD_NONE || freq <= 0.0f || freq >= nyquist || q <= 0.0f) {
+		_dsp_biquad_passthrough(group, lane);
+		dsp->enabled[section] = 0;
+	} else {
+		_dsp_biquad_design(group, lane, type, 2.0 * PI * freq / dsp->sample_rate, q, gain_db);
+		dsp->enabled[section] = 1;
+	}
+	// Groups past the last enabled section are skipped entirely
+	dsp->staged.groups = 0;
+	for (int i = 0; i < IVY_AUDIO_DSP_BIQUADS; i++) {
+		if (dsp->enabled[i]) {
+			dsp->staged.groups = i / DSP_LANES + 1;
+		}
+	}
+	_dsp_publish(dsp);
+}
+
+void audio_dsp_set_compressor(audio_dsp_t *dsp, float threshold_db, float ratio, float attack_ms, float release_ms, float makeup_db)
+{
+	dsp_config_t *c = &dsp->staged;
+	c->compressor = ratio > 1.0f;
+	c->comp_threshold_db = threshold_db;
+	c->comp_slope = ratio > 1.0f ? 1.0f - 1.0f / ratio : 0.0f;
+	c->comp_attack = _dsp_coef(dsp, attack_ms);
+	c->comp_release = _dsp_coef(dsp, release_ms);
+	c->comp_makeup = powf(10.0f, makeup_db / 20.0f);
+	_dsp_publish(dsp);
+}
+
+void audio_dsp_set_limiter(audio_dsp_t *dsp, float ceiling_db, float release_ms)
+{
+	dsp_config_t *c = &dsp->staged;
+	c->limiter = ceiling_db <= 0.0f;
+	c->limit_ceiling = powf(10.0f, ceiling_db / 20.0f);
+	c->limit_release = _dsp_coef(dsp, release_ms);
+	_dsp_publish(dsp);
+}
+
+void audio_dsp_set_reverb(audio_dsp_t *dsp, float room_size, float damping, float wet)
+{
+	dsp_config_t *c = &dsp->staged;
+	room_size = fminf(fmaxf(room_size, 0.0f), 1.0f);
+	wet = fminf(fmaxf(wet, 0.0f), 1.0f);
+	c->reverb = wet > 0.0f;
+	c->reverb_feedback = 0.7f + 0.28f * room_size;
+	c->reverb_damp = 0.4f * fminf(fmaxf(damping, 0.0f), 1.0f);
+	c->reverb_wet = wet * DSP_REVERB_WET_SCALE;
+	c->reverb_dry = 1.0f - wet;
+	_dsp_publish(dsp);
+}
@@ -21,8 +21,11 @@ void gfx_resize(pixel_array_t *ctx, int width, int height)
 		if (!buffer) {
 			FATAL("IVY GFX: Unable to allocate memory");
 		}
-		free(ctx->buffer);
+		if (!ctx->external) {
+			IVY_FREE(ctx->buffer);
+		}
 		ctx->buffer = buffer;
+		ctx->external = 0;
 		ctx->max_size = width * height;
 	}
 	ctx->width = width;
@@ -31,9 +34,12 @@ void gfx_resize(pixel_array_t *ctx, int width, int height)
 
 void gfx_destroy(pixel_array_t *ctx)
 {
-	IVY_FREE(ctx->buffer);
+	if (!ctx->external) {
+		IVY_FREE(ctx->buffer);
+	}
 	ctx->buffer = NULL;
 	ctx->max_size = 0;
 	ctx->width = 0;
 	ctx->height = 0;
+	ctx->external = 0;
 }
@@ -2,6 +2,24 @@
 #define IVY_MATH_H
 
 #include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+// Define IVY_MATH_NO_SIMD to keep every function on the scalar code
+#if !defined(IVY_MATH_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IVY_MATH_SSE
+#endif
+#if defined(IVY_MATH_SSE) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define IVY_MATH_AVX
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IVY_MATH_NEON
+#endif
+#endif // IVY_MATH_NO_SIMD
 
 // ---------------------------------------------------------------------------
 // IVY MATH DEFINATIONS
@@ -42,6 +60,27 @@ typedef struct {
 } mat4_t;
 #endif // IVY_MATH_MAT4_T
 
+#ifndef IVY_MATH_AFFINE_T
+#define IVY_MATH_AFFINE_T
+
+// Affine transform, a mat4_t without its last column which is always
+// 0 0 0 1. Rows 0-2 are the linear part, row 3 the translation
+typedef struct {
+	float m00, m01, m02;
+	float m10, m11, m12;
+	float m20, m21, m22;
+	float m30, m31, m32;
+} affine_t;
+#endif // IVY_MATH_AFFINE_T
+
+#ifndef IVY_MATH_QUAT_T
+#define IVY_MATH_QUAT_T
+
+typedef struct {
+	float x, y, z, w;
+} quat_t;
+#endif // IVY_MATH_QUAT_T
+
 // ---------------------------------------------------------------------------
 // IVY MATH IMPLEMENTATION
 // ---------------------------------------------------------------------------
@@ -94,6 +133,144 @@ static inline float fremap(float value, float smin, float smax, float emin, floa
 	return emin + (value - smin) * (emax - emin) / (smax - smin);
 }
 
+// ---------------------------------------------------------------------------
+// FAST FLOAT
+
+// Polynomial replacements for libm in loops that can take a small error.
+// Opt-in: nothing uses them unless IVY_MATH_FAST is defined, see below.
+// Errors are measured over the stated ranges against libm in double:
+//   fsin_fast, fcos_fast  |x| < 1e5      abs error < 2e-6, < 5e-7 for |x| < 100
+//   fexp_fast             -87 < x < 88   rel error < 2e-7, clamped outside
+//   flog_fast             normal x > 0   error < 2e-7 * max(1, |log(x)|)
+//   fatan2_fast           any y and x    abs error < 2e-6
+//   frsqrt_fast           normal x > 0   rel error < 5e-6
+
+#define IVY_MATH_PI_HI 3.140625f
+#define IVY_MATH_PI_LO 9.67653589793e-4f
+#define IVY_MATH_TWO_PI_HI 6.28125f
+#define IVY_MATH_TWO_PI_LO 1.9353071795864769e-3f
+#define IVY_MATH_LN2_HI 0.693359375f
+#define IVY_MATH_LN2_LO -2.12194440e-4f
+
+// Minimax on [-pi/2, pi/2], odd terms
+#define IVY_MATH_SIN_C1 9.999999766e-01f
+#define IVY_MATH_SIN_C3 -1.666664764e-01f
+#define IVY_MATH_SIN_C5 8.332899855e-03f
+#define IVY_MATH_SIN_C7 -1.980089942e-04f
+#define IVY_MATH_SIN_C9 2.590491427e-06f
+
+// Minimax of exp(r) - 1 - r on [-ln2/2, ln2/2], from r^2 up
+#define IVY_MATH_EXP_C2 5.000000095e-01f
+#define IVY_MATH_EXP_C3 1.666651890e-01f
+#define IVY_MATH_EXP_C4 4.166620599e-02f
+#define IVY_MATH_EXP_C5 8.368882249e-03f
+#define IVY_MATH_EXP_C6 1.395047862e-03f
+
+// Minimax on [0, 1], odd terms
+#define IVY_MATH_ATAN_C1 9.999772191e-01f
+#define IVY_MATH_ATAN_C3 -3.326228285e-01f
+#define IVY_MATH_ATAN_C5 1.935403778e-01f
+#define IVY_MATH_ATAN_C7 -1.164264834e-01f
+#define IVY_MATH_ATAN_C9 5.264735118e-02f
+#define IVY_MATH_ATAN_C11 -1.171913518e-02f
+
+typedef union {
+	float f;
+	unsigned int u;
+} _ivy_math_bits_t;
+
+// sin(x + phase) for a phase of 0 or pi/2. x is reduced by whole multiples
+// of pi and the sign flipped for odd ones, the phase is added after the
+// reduction so cos keeps the accuracy of sin for large x. No branches,
+// they mispredict on varied input and cost more than the polynomial
+static inline float _fsin_fast(float x, float phase)
+{
+	float t = (x + phase) * (float)(1.0 / PI);
+	int k = (int)(t + copysignf(0.5f, t));
+	float r = (x - k * IVY_MATH_PI_HI) - k * IVY_MATH_PI_LO + phase;
+	float r2 = r * r;
+	_ivy_math_bits_t b = {.f = r * (IVY_MATH_SIN_C1 + r2 * (IVY_MATH_SIN_C3 + r2 * (IVY_MATH_SIN_C5 + r2 * (IVY_MATH_SIN_C7 + r2 * IVY_MATH_SIN_C9))))};
+	b.u ^= (unsigned int)k << 31;
+	return b.f;
+}
+
+static inline float fsin_fast(float x)
+{
+	return _fsin_fast(x, 0.0f);
+}
+
+static inline float fcos_fast(float x)
+{
+	return _fsin_fast(x, (float)(PI / 2));
+}
+
+static inline float fexp_fast(float x)
+{
+	x = fclamp(x, -87.0f, 88.0f);
+	float t = x * 1.442695041f;
+	int n = (int)(t + copysignf(0.5f, t));
+	float r = (x - n * IVY_MATH_LN2_HI) - n * IVY_MATH_LN2_LO;
+	float p = 1.0f + r + r * r * (IVY_MATH_EXP_C2 + r * (IVY_MATH_EXP_C3 + r * (IVY_MATH_EXP_C4 + r * (IVY_MATH_EXP_C5 + r * IVY_MATH_EXP_C6))));
+	_ivy_math_bits_t scale = {.u = (unsigned int)(n + 127) << 23};
+	return p * scale.f;
+}
+
+// x = m * 2^e with m in [sqrt(1/2), sqrt(2)), then
+// log(m) = 2 atanh(s) = 2 (s + s^3/3 + s^5/5 + s^7/7) with s = (m-1)/(m+1).
+// Offsetting the bits by those of sqrt(1/2) picks e without a compare
+static inline float flog_fast(float x)
+{
+	_ivy_math_bits_t b = {.f = x};
+	unsigned int u = b.u - 0x3f3504f3;
+	float e = (float)((int)u >> 23);
+	b.u = (u & 0x007fffff) + 0x3f3504f3;
+	float s = (b.f - 1.0f) / (b.f + 1.0f);
+	float s2 = s * s;
+	float l = 2.0f * s * (1.0f + s2 * (1.0f / 3.0f + s2 * (1.0f / 5.0f + s2 * (1.0f / 7.0f))));
+	return e * IVY_MATH_LN2_HI + (e * IVY_MATH_LN2_LO + l);
+}
+
+static inline float fatan2_fast(float y, float x)
+{
+	float ax = fabsf(x), ay = fabsf(y);
+	float lo = ax < ay ? ax : ay;
+	float hi = ax < ay ? ay : ax;
+	float z = hi > 0.0f ? lo / hi : 0.0f;
+	float z2 = z * z;
+	float a = z * (IVY_MATH_ATAN_C1 + z2 * (IVY_MATH_ATAN_C3 + z2 * (IVY_MATH_ATAN_C5 + z2 * (IVY_MATH_ATAN_C7 + z2 * (IVY_MATH_ATAN_C9 + z2 * IVY_MATH_ATAN_C11)))));
+	a = ax < ay ? (float)(PI / 2) - a : a;
+	a = x < 0.0f ? (float)PI - a : a;
+	return copysignf(a, y);
+}
+
+// Estimate refined with Newton steps, one from the SSE estimate and two
+// from the bit trick
+static inline float frsqrt_fast(float x)
+{
+#if defined(IVY_MATH_SSE)
+	float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+	return y * (1.5f - 0.5f * x * y * y);
+#else
+	_ivy_math_bits_t b = {.f = x};
+	b.u = 0x5f375a86 - (b.u >> 1);
+	float y = b.f;
+	y = y * (1.5f - 0.5f * x * y * y);
+	return y * (1.5f - 0.5f * x * y * y);
+#endif
+}
+
+// Define IVY_MATH_FAST to run the trig of the helpers below through the
+// fast versions
+#if defined(IVY_MATH_FAST)
+#define IVY_MATH_SINF fsin_fast
+#define IVY_MATH_COSF fcos_fast
+#define IVY_MATH_ATAN2F fatan2_fast
+#else
+#define IVY_MATH_SINF sinf
+#define IVY_MATH_COSF cosf
+#define IVY_MATH_ATAN2F atan2f
+#endif
+
 // ---------------------------------------------------------------------------
 // VECTOR2
 
@@ -202,7 +379,7 @@ static inline vec2_t vec2_normalize(vec2_t a)
 
 static inline vec2_t vec2_invert(vec2_t a)
 {
-	return (vec2_t){1.0 / a.x, 1.0 / a.y};
+	return (vec2_t){1.0f / a.x, 1.0f / a.y};
 }
 
 static inline float vec2_dot(vec2_t a, vec2_t b)
@@ -217,13 +394,13 @@ static inline float vec2_cross(vec2_t a, vec2_t b)
 
 static inline float vec2_angle(vec2_t a, vec2_t b)
 {
-	return atan2f(vec2_cross(a, b), vec2_dot(a, b));
+	return IVY_MATH_ATAN2F(vec2_cross(a, b), vec2_dot(a, b));
 }
 
 static inline vec2_t vec2_rotate(vec2_t a, float angle_rad)
 {
-	float c = cosf(angle_rad);
-	float s = sinf(angle_rad);
+	float c = IVY_MATH_COSF(angle_rad);
+	float s = IVY_MATH_SINF(angle_rad);
 	return (vec2_t){a.x * c - a.y * s, a.x * s + a.y * c};
 }
 
@@ -313,12 +490,12 @@ static inline vec3_t vec3_lerp(vec3_t a, vec3_t b, float t)
 
 static inline vec3_t vec3_min(vec3_t a, vec3_t b)
 {
-	return (vec3_t){fminf(a.x, b.x), fminf(a.y, b.y), fminf(a.x, b.x)};
+	return (vec3_t){fminf(a.x, b.x), fminf(a.y, b.y), fminf(a.z, b.z)};
 }
 
 static inline vec3_t vec3_max(vec3_t a, vec3_t b)
 {
-	return (vec3_t){fmaxf(a.x, b.x), fmaxf(a.y, b.y), fmaxf(a.x, b.x)};
+	return (vec3_t){fmaxf(a.x, b.x), fmaxf(a.y, b.y), fmaxf(a.z, b.z)};
 }
 
 static inline vec3_t vec3_normalize(vec3_t a)
@@ -331,7 +508,7 @@ static inline vec3_t vec3_normalize(vec3_t a)
 
 static inline vec3_t vec3_invert(vec3_t a)
 {
-	return (vec3_t){1.0 / a.x, 1.0 / a.y, 1.0 / a.z};
+	return (vec3_t){1.0f / a.x, 1.0f / a.y, 1.0f / a.z};
 }
 
 static inline float vec3_dot(vec3_t a, vec3_t b)
@@ -351,16 +528,16 @@ static inline vec3_t vec3_cross(vec3_t a, vec3_t b)
 static inline vec3_t vec3_transform(vec3_t v, mat4_t m)
 {
 	return (vec3_t){
-		v.x * m.m00 + v.y * m.m10 + v.z * m.m20 + 1.0 * m.m30,
-		v.x * m.m01 + v.y * m.m11 + v.z * m.m21 + 1.0 * m.m31,
-		v.x * m.m02 + v.y * m.m12 + v.z * m.m22 + 1.0 * m.m32,
+		v.x * m.m00 + v.y * m.m10 + v.z * m.m20 + m.m30,
+		v.x * m.m01 + v.y * m.m11 + v.z * m.m21 + m.m31,
+		v.x * m.m02 + v.y * m.m12 + v.z * m.m22 + m.m32,
 	};
 }
 
 static inline float vec3_angle(vec3_t a, vec3_t b)
 {
 
-	return atan2f(vec3_len(vec3_cross(a, b)), vec3_dot(a, b));
+	return IVY_MATH_ATAN2F(vec3_len(vec3_cross(a, b)), vec3_dot(a, b));
 }
 
 static inline vec3_t vec3_rotate_axis(vec3_t v, vec3_t axis, float angle_rad)
@@ -368,8 +545,8 @@ static inline vec3_t vec3_rotate_axis(vec3_t v, vec3_t axis, float angle_rad)
 	// Ref:
 	// https://en.wikipedia.org/wiki/Rodrigues%27_rotation_formula
 	axis = vec3_normalize(axis);
-	float c = cosf(angle_rad);
-	float s = sinf(angle_rad);
+	float c = IVY_MATH_COSF(angle_rad);
+	float s = IVY_MATH_SINF(angle_rad);
 	vec3_t p0 = vec3_mulv(v, c);
 	vec3_t p1 = vec3_mulv(vec3_cross(axis, v), s);
 	vec3_t p2 = vec3_mulv(axis, vec3_dot(axis, v) * (1 - c));
@@ -423,8 +600,10 @@ static inline mat4_t mat4_identity()
 	};
 }
 
-static inline mat4_t mat4_mul(mat4_t a, mat4_t b) {
-	return (mat4_t) {
+static inline void _mat4_mul_scalar(mat4_t *out, const mat4_t *pa, const mat4_t *pb)
+{
+	const mat4_t a = *pa, b = *pb;
+	*out = (mat4_t) {
 		(a.m00 * b.m00) + (a.m01 * b.m10) + (a.m02 * b.m20) + (a.m03 * b.m30),
 		(a.m00 * b.m01) + (a.m01 * b.m11) + (a.m02 * b.m21) + (a.m03 * b.m31),
 		(a.m00 * b.m02) + (a.m01 * b.m12) + (a.m02 * b.m22) + (a.m03 * b.m32),
@@ -447,9 +626,10 @@ static inline mat4_t mat4_mul(mat4_t a, mat4_t b) {
 	};
 }
 
-static inline mat4_t mat4_transpose(mat4_t m)
+static inline void _mat4_transpose_scalar(mat4_t *out, const mat4_t *pm)
 {
-	return (mat4_t) {
+	const mat4_t m = *pm;
+	*out = (mat4_t) {
 		m.m00, m.m10, m.m20, m.m30,
 		m.m01, m.m11, m.m21, m.m31,
 		m.m02, m.m12, m.m22, m.m32,
@@ -457,6 +637,418 @@ static inline mat4_t mat4_transpose(mat4_t m)
 	};
 }
 
+static inline void _mat4_inverse_scalar(mat4_t *out, const mat4_t *m)
+{
+	float a00 = m->m00, a01 = m->m01, a02 = m->m02, a03 = m->m03;
+	float a10 = m->m10, a11 = m->m11, a12 = m->m12, a13 = m->m13;
+	float a20 = m->m20, a21 = m->m21, a22 = m->m22, a23 = m->m23;
+	float a30 = m->m30, a31 = m->m31, a32 = m->m32, a33 = m->m33;
+
+	float b00 = a00*a11 - a01*a10;
+	float b01 = a00*a12 - a02*a10;
+	float b02 = a00*a13 - a03*a10;
+	float b03 = a01*a12 - a02*a11;
+	float b04 = a01*a13 - a03*a11;
+	float b05 = a02*a13 - a03*a12;
+	float b06 = a20*a31 - a21*a30;
+	float b07 = a20*a32 - a22*a30;
+	float b08 = a20*a33 - a23*a30;
+	float b09 = a21*a32 - a22*a31;
+	float b10 = a21*a33 - a23*a31;
+	float b11 = a22*a33 - a23*a32;
+
+	float invDet = 1.0f/(b00*b11 - b01*b10 + b02*b09 + b03*b08 - b04*b07 + b05*b06);
+
+	out->m00 = (a11*b11 - a12*b10 + a13*b09)*invDet;
+	out->m01 = (-a01*b11 + a02*b10 - a03*b09)*invDet;
+	out->m02 = (a31*b05 - a32*b04 + a33*b03)*invDet;
+	out->m03 = (-a21*b05 + a22*b04 - a23*b03)*invDet;
+	out->m10 = (-a10*b11 + a12*b08 - a13*b07)*invDet;
+	out->m11 = (a00*b11 - a02*b08 + a03*b07)*invDet;
+	out->m12 = (-a30*b05 + a32*b02 - a33*b01)*invDet;
+	out->m13 = (a20*b05 - a22*b02 + a23*b01)*invDet;
+	out->m20 = (a10*b10 - a11*b08 + a13*b06)*invDet;
+	out->m21 = (-a00*b10 + a01*b08 - a03*b06)*invDet;
+	out->m22 = (a30*b04 - a31*b02 + a33*b00)*invDet;
+	out->m23 = (-a20*b04 + a21*b02 - a23*b00)*invDet;
+	out->m30 = (-a10*b09 + a11*b07 - a12*b06)*invDet;
+	out->m31 = (a00*b09 - a01*b07 + a02*b06)*invDet;
+	out->m32 = (-a30*b03 + a31*b01 - a32*b00)*invDet;
+	out->m33 = (a20*b03 - a21*b01 + a22*b00)*invDet;
+}
+// clang-format on
+
+// The SIMD kernels add in the same order as the scalar ones, mul and
+// transpose match them exactly and inverse to within rounding
+
+#if defined(IVY_MATH_SSE)
+// Row a of a matrix times b, spread over b's rows b0-b3
+static inline __m128 _mat4_row_sse(__m128 a, __m128 b0, __m128 b1, __m128 b2, __m128 b3)
+{
+	__m128 r = _mm_mul_ps(_mm_shuffle_ps(a, a, 0x00), b0);
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(a, a, 0x55), b1));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(a, a, 0xaa), b2));
+	return _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(a, a, 0xff), b3));
+}
+
+static inline void _mat4_mul_sse(mat4_t *out, const mat4_t *a, const mat4_t *b)
+{
+	const __m128 b0 = _mm_loadu_ps(&b->m00);
+	const __m128 b1 = _mm_loadu_ps(&b->m10);
+	const __m128 b2 = _mm_loadu_ps(&b->m20);
+	const __m128 b3 = _mm_loadu_ps(&b->m30);
+	__m128 r0 = _mat4_row_sse(_mm_loadu_ps(&a->m00), b0, b1, b2, b3);
+	__m128 r1 = _mat4_row_sse(_mm_loadu_ps(&a->m10), b0, b1, b2, b3);
+	__m128 r2 = _mat4_row_sse(_mm_loadu_ps(&a->m20), b0, b1, b2, b3);
+	__m128 r3 = _mat4_row_sse(_mm_loadu_ps(&a->m30), b0, b1, b2, b3);
+	// Stored last so out may alias a or b
+	_mm_storeu_ps(&out->m00, r0);
+	_mm_storeu_ps(&out->m10, r1);
+	_mm_storeu_ps(&out->m20, r2);
+	_mm_storeu_ps(&out->m30, r3);
+}
+
+static inline void _mat4_transpose_sse(mat4_t *out, const mat4_t *m)
+{
+	__m128 r0 = _mm_loadu_ps(&m->m00);
+	__m128 r1 = _mm_loadu_ps(&m->m10);
+	__m128 r2 = _mm_loadu_ps(&m->m20);
+	__m128 r3 = _mm_loadu_ps(&m->m30);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_mm_storeu_ps(&out->m00, r0);
+	_mm_storeu_ps(&out->m10, r1);
+	_mm_storeu_ps(&out->m20, r2);
+	_mm_storeu_ps(&out->m30, r3);
+}
+
+// Same cofactor expansion as the scalar inverse, 4 lanes of each row at
+// once. b00-b11 are the 2x2 minors of the top and bottom row pairs
+static inline void _mat4_inverse_sse(mat4_t *out, const mat4_t *m)
+{
+	const __m128 a0 = _mm_loadu_ps(&m->m00);
+	const __m128 a1 = _mm_loadu_ps(&m->m10);
+	const __m128 a2 = _mm_loadu_ps(&m->m20);
+	const __m128 a3 = _mm_loadu_ps(&m->m30);
+
+	// [b00 b01 b02 b03], [b06 b07 b08 b09] and [b04 b05 b10 b11]
+	__m128 v1 = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(a0, a0, _MM_SHUFFLE(1, 0, 0, 0)), _mm_shuffle_ps(a1, a1, _MM_SHUFFLE(2, 3, 2, 1))),
+						   _mm_mul_ps(_mm_shuffle_ps(a0, a0, _MM_SHUFFLE(2, 3, 2, 1)), _mm_shuffle_ps(a1, a1, _MM_SHUFFLE(1, 0, 0, 0))));
+	__m128 v3 = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(a2, a2, _MM_SHUFFLE(1, 0, 0, 0)), _mm_shuffle_ps(a3, a3, _MM_SHUFFLE(2, 3, 2, 1))),
+						   _mm_mul_ps(_mm_shuffle_ps(a2, a2, _MM_SHUFFLE(2, 3, 2, 1)), _mm_shuffle_ps(a3, a3, _MM_SHUFFLE(1, 0, 0, 0))));
+	__m128 v2 = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(a0, a2, _MM_SHUFFLE(2, 1, 2, 1)), _mm_shuffle_ps(a1, a3, _MM_SHUFFLE(3, 3, 3, 3))),
+						   _mm_mul_ps(_mm_shuffle_ps(a0, a2, _MM_SHUFFLE(3, 3, 3, 3)), _mm_shuffle_ps(a1, a3, _MM_SHUFFLE(2, 1, 2, 1))));
+
+	// Minor pairs [bx bx by by], each bottom minor next to its top one
+	__m128 b11_05 = _mm_shuffle_ps(v2, v2, _MM_SHUFFLE(1, 1, 3, 3));
+	__m128 b10_04 = _mm_shuffle_ps(v2, v2, _MM_SHUFFLE(0, 0, 2, 2));
+	__m128 b09_03 = _mm_shuffle_ps(v3, v1, _MM_SHUFFLE(3, 3, 3, 3));
+	__m128 b08_02 = _mm_shuffle_ps(v3, v1, _MM_SHUFFLE(2, 2, 2, 2));
+	__m128 b07_01 = _mm_shuffle_ps(v3, v1, _MM_SHUFFLE(1, 1, 1, 1));
+	__m128 b06_00 = _mm_shuffle_ps(v3, v1, _MM_SHUFFLE(0, 0, 0, 0));
+
+	// Columns with the rows swapped in pairs and every other lane negated,
+	// ck = [a1k -a0k a3k -a2k]
+	const __m128 sign = _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f);
+	__m128 lo01 = _mm_unpacklo_ps(a1, a0), lo23 = _mm_unpacklo_ps(a3, a2);
+	__m128 hi01 = _mm_unpackhi_ps(a1, a0), hi23 = _mm_unpackhi_ps(a3, a2);
+	__m128 c0 = _mm_xor_ps(_mm_movelh_ps(lo01, lo23), sign);
+	__m128 c1 = _mm_xor_ps(_mm_movehl_ps(lo23, lo01), sign);
+	__m128 c2 = _mm_xor_ps(_mm_movelh_ps(hi01, hi23), sign);
+	__m128 c3 = _mm_xor_ps(_mm_movehl_ps(hi23, hi01), sign);
+
+	__m128 r0 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(c1, b11_05), _mm_mul_ps(c2, b10_04)), _mm_mul_ps(c3, b09_03));
+	__m128 r1 = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(c2, b08_02), _mm_mul_ps(c0, b11_05)), _mm_mul_ps(c3, b07_01));
+	__m128 r2 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(c0, b10_04), _mm_mul_ps(c1, b08_02)), _mm_mul_ps(c3, b06_00));
+	__m128 r3 = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(c1, b07_01), _mm_mul_ps(c0, b09_03)), _mm_mul_ps(c2, b06_00));
+
+	// The determinant is the first column of m against the first row of
+	// the adjugate
+	__m128 col0 = _mm_shuffle_ps(_mm_xor_ps(c0, sign), _mm_xor_ps(c0, sign), _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 det = _mm_mul_ps(col0, r0);
+	det = _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(2, 3, 0, 1)));
+	det = _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(1, 0, 3, 2)));
+	__m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+	_mm_storeu_ps(&out->m00, _mm_mul_ps(r0, inv));
+	_mm_storeu_ps(&out->m10, _mm_mul_ps(r1, inv));
+	_mm_storeu_ps(&out->m20, _mm_mul_ps(r2, inv));
+	_mm_storeu_ps(&out->m30, _mm_mul_ps(r3, inv));
+}
+#endif // IVY_MATH_SSE
+
+#if defined(IVY_MATH_AVX)
+// Two rows of the result per 256 bit register
+__attribute__((target("avx"))) static inline void _mat4_mul_avx(mat4_t *out, const mat4_t *a, const mat4_t *b)
+{
+	const __m256 b0 = _mm256_broadcast_ps((const __m128 *)&b->m00);
+	const __m256 b1 = _mm256_broadcast_ps((const __m128 *)&b->m10);
+	const __m256 b2 = _mm256_broadcast_ps((const __m128 *)&b->m20);
+	const __m256 b3 = _mm256_broadcast_ps((const __m128 *)&b->m30);
+	__m256 a01 = _mm256_loadu_ps(&a->m00);
+	__m256 a23 = _mm256_loadu_ps(&a->m20);
+	__m256 r01 = _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0x00), b0);
+	__m256 r23 = _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0x00), b0);
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0x55), b1));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0x55), b1));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0xaa), b2));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0xaa), b2));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0xff), b3));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0xff), b3));
+	_mm256_storeu_ps(&out->m00, r01);
+	_mm256_storeu_ps(&out->m20, r23);
+}
+#endif // IVY_MATH_AVX
+
+#if defined(IVY_MATH_NEON)
+static inline void _mat4_mul_neon(mat4_t *out, const mat4_t *a, const mat4_t *b)
+{
+	const float32x4_t b0 = vld1q_f32(&b->m00);
+	const float32x4_t b1 = vld1q_f32(&b->m10);
+	const float32x4_t b2 = vld1q_f32(&b->m20);
+	const float32x4_t b3 = vld1q_f32(&b->m30);
+	const float *pa = &a->m00;
+	float32x4_t r[4];
+	for (int i = 0; i < 4; i++) {
+		float32x4_t row = vmulq_n_f32(b0, pa[i * 4 + 0]);
+		row = vaddq_f32(row, vmulq_n_f32(b1, pa[i * 4 + 1]));
+		row = vaddq_f32(row, vmulq_n_f32(b2, pa[i * 4 + 2]));
+		r[i] = vaddq_f32(row, vmulq_n_f32(b3, pa[i * 4 + 3]));
+	}
+	vst1q_f32(&out->m00, r[0]);
+	vst1q_f32(&out->m10, r[1]);
+	vst1q_f32(&out->m20, r[2]);
+	vst1q_f32(&out->m30, r[3]);
+}
+
+static inline void _mat4_transpose_neon(mat4_t *out, const mat4_t *m)
+{
+	// De-interleaving load puts every column in its own register
+	float32x4x4_t c = vld4q_f32(&m->m00);
+	vst1q_f32(&out->m00, c.val[0]);
+	vst1q_f32(&out->m10, c.val[1]);
+	vst1q_f32(&out->m20, c.val[2]);
+	vst1q_f32(&out->m30, c.val[3]);
+}
+#endif // IVY_MATH_NEON
+
+// ---------------------------------------------------------------------------
+// AFFINE
+
+// clang-format off
+static inline affine_t affine_identity()
+{
+	return (affine_t) {
+		1, 0, 0,
+		0, 1, 0,
+		0, 0, 1,
+		0, 0, 0,
+	};
+}
+
+// Drops the last column, which must be 0 0 0 1
+static inline affine_t affine_from_mat4(mat4_t m)
+{
+	return (affine_t) {
+		m.m00, m.m01, m.m02,
+		m.m10, m.m11, m.m12,
+		m.m20, m.m21, m.m22,
+		m.m30, m.m31, m.m32,
+	};
+}
+
+static inline mat4_t affine_to_mat4(affine_t a)
+{
+	return (mat4_t) {
+		a.m00, a.m01, a.m02, 0,
+		a.m10, a.m11, a.m12, 0,
+		a.m20, a.m21, a.m22, 0,
+		a.m30, a.m31, a.m32, 1,
+	};
+}
+
+static inline vec3_t affine_transform(vec3_t v, affine_t a)
+{
+	return (vec3_t){
+		v.x * a.m00 + v.y * a.m10 + v.z * a.m20 + a.m30,
+		v.x * a.m01 + v.y * a.m11 + v.z * a.m21 + a.m31,
+		v.x * a.m02 + v.y * a.m12 + v.z * a.m22 + a.m32,
+	};
+}
+
+// Directions and normals skip the translation
+static inline vec3_t affine_transform_dir(vec3_t v, affine_t a)
+{
+	return (vec3_t){
+		v.x * a.m00 + v.y * a.m10 + v.z * a.m20,
+		v.x * a.m01 + v.y * a.m11 + v.z * a.m21,
+		v.x * a.m02 + v.y * a.m12 + v.z * a.m22,
+	};
+}
+
+// a then b like mat4_mul, 36 multiplies instead of 64
+static inline affine_t affine_mul(affine_t a, affine_t b)
+{
+	vec3_t r0 = affine_transform_dir(vec3(a.m00, a.m01, a.m02), b);
+	vec3_t r1 = affine_transform_dir(vec3(a.m10, a.m11, a.m12), b);
+	vec3_t r2 = affine_transform_dir(vec3(a.m20, a.m21, a.m22), b);
+	vec3_t t = affine_transform(vec3(a.m30, a.m31, a.m32), b);
+	return (affine_t){
+		r0.x, r0.y, r0.z,
+		r1.x, r1.y, r1.z,
+		r2.x, r2.y, r2.z,
+		t.x, t.y, t.z,
+	};
+}
+
+// Inverse of the 3x3 part from cross products of its rows, then the
+// translation moved through it. One divide
+static inline affine_t affine_inverse(affine_t a)
+{
+	vec3_t r0 = {a.m00, a.m01, a.m02};
+	vec3_t r1 = {a.m10, a.m11, a.m12};
+	vec3_t r2 = {a.m20, a.m21, a.m22};
+	vec3_t c0 = vec3_cross(r1, r2);
+	vec3_t c1 = vec3_cross(r2, r0);
+	vec3_t c2 = vec3_cross(r0, r1);
+	float inv_det = 1.0f / vec3_dot(r0, c0);
+	c0 = vec3_mulv(c0, inv_det);
+	c1 = vec3_mulv(c1, inv_det);
+	c2 = vec3_mulv(c2, inv_det);
+	affine_t r = {
+		c0.x, c1.x, c2.x,
+		c0.y, c1.y, c2.y,
+		c0.z, c1.z, c2.z,
+		0, 0, 0,
+	};
+	vec3_t t = affine_transform_dir(vec3(a.m30, a.m31, a.m32), r);
+	r.m30 = -t.x, r.m31 = -t.y, r.m32 = -t.z;
+	return r;
+}
+
+// For rotation and translation only, like views from lookat. The inverse
+// rotation is the transpose, no divide at all
+static inline affine_t affine_inverse_rigid(affine_t a)
+{
+	affine_t r = {
+		a.m00, a.m10, a.m20,
+		a.m01, a.m11, a.m21,
+		a.m02, a.m12, a.m22,
+		0, 0, 0,
+	};
+	vec3_t t = affine_transform_dir(vec3(a.m30, a.m31, a.m32), r);
+	r.m30 = -t.x, r.m31 = -t.y, r.m32 = -t.z;
+	return r;
+}
+
+static inline affine_t affine_lookat_lh(vec3_t eye, vec3_t center, vec3_t up)
+{
+	vec3_t f = vec3_normalize(vec3_sub(center, eye));
+	vec3_t s = vec3_normalize(vec3_cross(up, f));
+	vec3_t u = vec3_cross(f, s);
+	return (affine_t){
+		s.x, u.x, f.x,
+		s.y, u.y, f.y,
+		s.z, u.z, f.z,
+		-vec3_dot(s, eye), -vec3_dot(u, eye), -vec3_dot(f, eye),
+	};
+}
+
+static inline affine_t affine_lookat_rh(vec3_t eye, vec3_t center, vec3_t up)
+{
+	return affine_lookat_lh(eye, vec3_add(eye, vec3_sub(eye, center)), up);
+}
+
+// True when the last column is 0 0 0 1, so the affine functions apply
+static inline int mat4_is_affine(const mat4_t *m)
+{
+	return m->m03 == 0 && m->m13 == 0 && m->m23 == 0 && m->m33 == 1;
+}
+// clang-format on
+
+static inline mat4_t mat4_inverse_rigid(mat4_t m)
+{
+	return affine_to_mat4(affine_inverse_rigid(affine_from_mat4(m)));
+}
+
+// ---------------------------------------------------------------------------
+// MATRIX4 DISPATCH
+
+typedef struct {
+	void (*mul)(mat4_t *out, const mat4_t *a, const mat4_t *b);
+	void (*transpose)(mat4_t *out, const mat4_t *m);
+	void (*inverse)(mat4_t *out, const mat4_t *m);
+} ivy_math_kernels_t;
+
+// Picks the widest kernels the CPU runs. The tables are constant and the
+// CPU check only reads what the runtime filled before main, so threads
+// may call this concurrently
+static inline const ivy_math_kernels_t *ivy_math_kernels(void)
+{
+#if defined(IVY_MATH_NEON)
+	static const ivy_math_kernels_t kernels = {_mat4_mul_neon, _mat4_transpose_neon, _mat4_inverse_scalar};
+#elif defined(IVY_MATH_SSE)
+	static const ivy_math_kernels_t kernels = {_mat4_mul_sse, _mat4_transpose_sse, _mat4_inverse_sse};
+#else
+	static const ivy_math_kernels_t kernels = {_mat4_mul_scalar, _mat4_transpose_scalar, _mat4_inverse_scalar};
+#endif
+#if defined(IVY_MATH_AVX)
+	static const ivy_math_kernels_t kernels_avx = {_mat4_mul_avx, _mat4_transpose_sse, _mat4_inverse_sse};
+	if (__builtin_cpu_supports("avx")) {
+		return &kernels_avx;
+	}
+#endif
+	return &kernels;
+}
+
+// Pointer variants, out may alias the inputs
+static inline void mat4_mul_p(mat4_t *out, const mat4_t *a, const mat4_t *b)
+{
+	ivy_math_kernels()->mul(out, a, b);
+}
+
+static inline void mat4_transpose_p(mat4_t *out, const mat4_t *m)
+{
+	ivy_math_kernels()->transpose(out, m);
+}
+
+// General inverse whatever the matrix holds. Callers that know theirs is
+// rigid or affine can opt in to mat4_inverse_rigid or affine_inverse, run
+// make bench to see which wins on a target
+static inline void mat4_inverse_p(mat4_t *out, const mat4_t *m)
+{
+	ivy_math_kernels()->inverse(out, m);
+}
+
+// The by value functions stay inlinable, they use the best kernel known at
+// compile time instead of the dispatch table
+static inline mat4_t mat4_mul(mat4_t a, mat4_t b)
+{
+	mat4_t r;
+#if defined(IVY_MATH_NEON)
+	_mat4_mul_neon(&r, &a, &b);
+#elif defined(IVY_MATH_SSE)
+	_mat4_mul_sse(&r, &a, &b);
+#else
+	_mat4_mul_scalar(&r, &a, &b);
+#endif
+	return r;
+}
+
+static inline mat4_t mat4_transpose(mat4_t m)
+{
+	mat4_t r;
+#if defined(IVY_MATH_NEON)
+	_mat4_transpose_neon(&r, &m);
+#elif defined(IVY_MATH_SSE)
+	_mat4_transpose_sse(&r, &m);
+#else
+	_mat4_transpose_scalar(&r, &m);
+#endif
+	return r;
+}
+
+// clang-format off
+
 // Ref: https://journalppw.com/index.php/jpsp/article/download/1313/668/1516
 
 static inline mat4_t mat4_translate(vec3_t t)
@@ -471,8 +1063,8 @@ static inline mat4_t mat4_translate(vec3_t t)
 
 static inline mat4_t mat4_rotate_x(float angle_rad)
 {
-	float c = cosf(angle_rad);
-	float s = sinf(angle_rad);
+	float c = IVY_MATH_COSF(angle_rad);
+	float s = IVY_MATH_SINF(angle_rad);
 	return (mat4_t) {
 		 1,  0,  0,  0,
 		 0,  c, -s,  0,
@@ -483,8 +1075,8 @@ static inline mat4_t mat4_rotate_x(float angle_rad)
 
 static inline mat4_t mat4_rotate_y(float angle_rad)
 {
-	float c = cosf(angle_rad);
-	float s = sinf(angle_rad);
+	float c = IVY_MATH_COSF(angle_rad);
+	float s = IVY_MATH_SINF(angle_rad);
 	return (mat4_t) {
 		 c,  0,  s,  0,
 		 0,  1,  0,  0,
@@ -495,8 +1087,8 @@ static inline mat4_t mat4_rotate_y(float angle_rad)
 
 static inline mat4_t mat4_rotate_z(float angle_rad)
 {
-	float c = cosf(angle_rad);
-	float s = sinf(angle_rad);
+	float c = IVY_MATH_COSF(angle_rad);
+	float s = IVY_MATH_SINF(angle_rad);
 	return (mat4_t) {
 		 c, -s,  0,  0,
 		 s,  c,  0,  0,
@@ -521,8 +1113,8 @@ static inline mat4_t mat4_scale(vec3_t s)
 
 static inline mat4_t mat4_rotate_axis(vec3_t axis, float angle_rad)
 {
-	float c = cosf(angle_rad);
-	float s = sinf(angle_rad);
+	float c = IVY_MATH_COSF(angle_rad);
+	float s = IVY_MATH_SINF(angle_rad);
 	vec3_t u = vec3_normalize(axis);
 	return (mat4_t) {
 		        fsq(u.x) * (1 - c) + c, u.x * u.y * (1 - c) + u.z * s, u.x * u.z * (1 - c) - u.y * s, 0,
@@ -538,33 +1130,14 @@ static inline mat4_t mat4_rotate_axis(vec3_t axis, float angle_rad)
 
 static inline mat4_t mat4_lookat_lh(vec3_t eye, vec3_t center, vec3_t up)
 {
-	vec3_t f = vec3_normalize(vec3_sub(center, eye)); // vz
-	vec3_t s = vec3_normalize(vec3_cross(up, f)); // vx
-	vec3_t u = vec3_cross(f, s); // vy
-	
-	return (mat4_t) {
-		              s.x,               u.x,               f.x, 0,
-		              s.y,               u.y,               f.y, 0,
-		              s.z,               u.z,               f.z, 0,
-		-vec3_dot(s, eye), -vec3_dot(u, eye), -vec3_dot(f, eye), 1,
-	};
+	return affine_to_mat4(affine_lookat_lh(eye, center, up));
 }
 
 static inline mat4_t mat4_lookat_rh(vec3_t eye, vec3_t center, vec3_t up)
 {
-	vec3_t f = vec3_normalize(vec3_sub(eye, center)); // vz
-	vec3_t s = vec3_normalize(vec3_cross(up, f)); // vx
-	vec3_t u = vec3_cross(f, s); // vy
-	
-	return (mat4_t) {
-		              s.x,               u.x,               f.x, 0,
-		              s.y,               u.y,               f.y, 0,
-		              s.z,               u.z,               f.z, 0,
-		-vec3_dot(s, eye), -vec3_dot(u, eye), -vec3_dot(f, eye), 1,
-	};
+	return affine_to_mat4(affine_lookat_rh(eye, center, up));
 }
 
-
 // Reference uses column major
 // Ref: https://docs.gl/gl3/glFrustum
 
@@ -606,55 +1179,1411 @@ static inline mat4_t mat4_perspective(float fov_rad, float aspect, float n, floa
 	};
 }
 
-// TODO: confirm if the math is right or not
 static inline mat4_t mat4_inverse(mat4_t m)
 {
-	// Matrix result = { 0 };
-	
-	    // Cache the matrix values (speed optimization)
-	    float a00 = m.m00, a01 = m.m01, a02 = m.m02, a03 = m.m03;
-	    float a10 = m.m10, a11 = m.m11, a12 = m.m12, a13 = m.m13;
-	    float a20 = m.m20, a21 = m.m21, a22 = m.m22, a23 = m.m23;
-	    float a30 = m.m30, a31 = m.m31, a32 = m.m32, a33 = m.m33;
-	
-	    float b00 = a00*a11 - a01*a10;
-	    float b01 = a00*a12 - a02*a10;
-	    float b02 = a00*a13 - a03*a10;
-	    float b03 = a01*a12 - a02*a11;
-	    float b04 = a01*a13 - a03*a11;
-	    float b05 = a02*a13 - a03*a12;
-	    float b06 = a20*a31 - a21*a30;
-	    float b07 = a20*a32 - a22*a30;
-	    float b08 = a20*a33 - a23*a30;
-	    float b09 = a21*a32 - a22*a31;
-	    float b10 = a21*a33 - a23*a31;
-	    float b11 = a22*a33 - a23*a32;
-	
-	    // Calculate the invert determinant (inlined to avoid double-caching)
-	    float invDet = 1.0f/(b00*b11 - b01*b10 + b02*b09 + b03*b08 - b04*b07 + b05*b06);
-
-		mat4_t result = {0};
-	    result.m00 = (a11*b11 - a12*b10 + a13*b09)*invDet;
-	    result.m01 = (-a01*b11 + a02*b10 - a03*b09)*invDet;
-	    result.m02 = (a31*b05 - a32*b04 + a33*b03)*invDet;
-	    result.m03 = (-a21*b05 + a22*b04 - a23*b03)*invDet;
-	    result.m10 = (-a10*b11 + a12*b08 - a13*b07)*invDet;
-	    result.m11 = (a00*b11 - a02*b08 + a03*b07)*invDet;
-	    result.m12 = (-a30*b05 + a32*b02 - a33*b01)*invDet;
-	    result.m13 = (a20*b05 - a22*b02 + a23*b01)*invDet;
-	    result.m20 = (a10*b10 - a11*b08 + a13*b06)*invDet;
-	    result.m21 = (-a00*b10 + a01*b08 - a03*b06)*invDet;
-	    result.m22 = (a30*b04 - a31*b02 + a33*b00)*invDet;
-	    result.m23 = (-a20*b04 + a21*b02 - a23*b00)*invDet;
-	    result.m30 = (-a10*b09 + a11*b07 - a12*b06)*invDet;
-	    result.m31 = (a00*b09 - a01*b07 + a02*b06)*invDet;
-	    result.m32 = (-a30*b03 + a31*b01 - a32*b00)*invDet;
-	    result.m33 = (a20*b03 - a21*b01 + a22*b00)*invDet;
-	    return result;
+	mat4_t r;
+#if defined(IVY_MATH_SSE)
+	_mat4_inverse_sse(&r, &m);
+#else
+	_mat4_inverse_scalar(&r, &m);
+#endif
+	return r;
+}
+
+// clang-format on
+
+// ---------------------------------------------------------------------------
+// VEC3 PACKETS
+
+// 4 or 8 vec3_t held as one register per component, so a kernel written
+// against vec3x4_t/vec3x8_t runs on every lane at once. Without SIMD the
+// packets are plain arrays and the same code runs scalar. vec3x8_t is one
+// AVX register per component when built with AVX enabled, two vec3x4_t
+// halves otherwise
+
+#if defined(IVY_MATH_SSE)
+typedef __m128 floatx4_t;
+#elif defined(IVY_MATH_NEON)
+typedef float32x4_t floatx4_t;
+#else
+typedef struct {
+	float v[4];
+} floatx4_t;
+#endif
+
+#if defined(IVY_MATH_SSE) && defined(__AVX__)
+#include <immintrin.h>
+#define IVY_MATH_X8_AVX
+typedef __m256 floatx8_t;
+#else
+typedef struct {
+	floatx4_t lo, hi;
+} floatx8_t;
+#endif
+
+typedef struct {
+	floatx4_t x, y, z;
+} vec3x4_t;
+
+typedef struct {
+	floatx8_t x, y, z;
+} vec3x8_t;
+
+#if defined(IVY_MATH_SSE)
+static inline floatx4_t floatx4_set1(float f)
+{
+	return _mm_set1_ps(f);
+}
+
+static inline floatx4_t floatx4_load(const float *p)
+{
+	return _mm_loadu_ps(p);
+}
+
+static inline void floatx4_store(float *p, floatx4_t a)
+{
+	_mm_storeu_ps(p, a);
+}
+
+static inline floatx4_t floatx4_add(floatx4_t a, floatx4_t b)
+{
+	return _mm_add_ps(a, b);
+}
+
+static inline floatx4_t floatx4_sub(floatx4_t a, floatx4_t b)
+{
+	return _mm_sub_ps(a, b);
+}
+
+static inline floatx4_t floatx4_mul(floatx4_t a, floatx4_t b)
+{
+	return _mm_mul_ps(a, b);
+}
+
+static inline floatx4_t floatx4_div(floatx4_t a, floatx4_t b)
+{
+	return _mm_div_ps(a, b);
+}
+
+static inline floatx4_t floatx4_min(floatx4_t a, floatx4_t b)
+{
+	return _mm_min_ps(a, b);
+}
+
+static inline floatx4_t floatx4_max(floatx4_t a, floatx4_t b)
+{
+	return _mm_max_ps(a, b);
+}
+
+static inline floatx4_t floatx4_sqrt(floatx4_t a)
+{
+	return _mm_sqrt_ps(a);
+}
+
+// 1 / a, 0 where a is 0
+static inline floatx4_t floatx4_rcp_safe(floatx4_t a)
+{
+	return _mm_and_ps(_mm_cmpneq_ps(a, _mm_setzero_ps()), _mm_div_ps(_mm_set1_ps(1.0f), a));
+}
+#elif defined(IVY_MATH_NEON)
+static inline floatx4_t floatx4_set1(float f)
+{
+	return vdupq_n_f32(f);
+}
+
+static inline floatx4_t floatx4_load(const float *p)
+{
+	return vld1q_f32(p);
+}
+
+static inline void floatx4_store(float *p, floatx4_t a)
+{
+	vst1q_f32(p, a);
+}
+
+static inline floatx4_t floatx4_add(floatx4_t a, floatx4_t b)
+{
+	return vaddq_f32(a, b);
+}
+
+static inline floatx4_t floatx4_sub(floatx4_t a, floatx4_t b)
+{
+	return vsubq_f32(a, b);
+}
+
+static inline floatx4_t floatx4_mul(floatx4_t a, floatx4_t b)
+{
+	return vmulq_f32(a, b);
+}
+
+static inline floatx4_t floatx4_div(floatx4_t a, floatx4_t b)
+{
+	return vdivq_f32(a, b);
+}
+
+static inline floatx4_t floatx4_min(floatx4_t a, floatx4_t b)
+{
+	return vminq_f32(a, b);
+}
+
+static inline floatx4_t floatx4_max(floatx4_t a, floatx4_t b)
+{
+	return vmaxq_f32(a, b);
+}
+
+static inline floatx4_t floatx4_sqrt(floatx4_t a)
+{
+	return vsqrtq_f32(a);
+}
+
+static inline floatx4_t floatx4_rcp_safe(floatx4_t a)
+{
+	uint32x4_t nz = vmvnq_u32(vceqq_f32(a, vdupq_n_f32(0.0f)));
+	return vreinterpretq_f32_u32(vandq_u32(nz, vreinterpretq_u32_f32(vdivq_f32(vdupq_n_f32(1.0f), a))));
+}
+#else
+static inline floatx4_t floatx4_set1(float f)
+{
+	return (floatx4_t){{f, f, f, f}};
+}
+
+static inline floatx4_t floatx4_load(const float *p)
+{
+	return (floatx4_t){{p[0], p[1], p[2], p[3]}};
+}
+
+static inline void floatx4_store(float *p, floatx4_t a)
+{
+	for (int i = 0; i < 4; i++) {
+		p[i] = a.v[i];
+	}
+}
+#define IVY_MATH_X4_OP(name, expr)                               \
+	static inline floatx4_t name(floatx4_t a, floatx4_t b)       \
+	{                                                            \
+		floatx4_t r;                                             \
+		for (int i = 0; i < 4; i++) {                            \
+			r.v[i] = expr;                                       \
+		}                                                        \
+		return r;                                                \
+	}
+IVY_MATH_X4_OP(floatx4_add, a.v[i] + b.v[i])
+IVY_MATH_X4_OP(floatx4_sub, a.v[i] - b.v[i])
+IVY_MATH_X4_OP(floatx4_mul, a.v[i] * b.v[i])
+IVY_MATH_X4_OP(floatx4_div, a.v[i] / b.v[i])
+IVY_MATH_X4_OP(floatx4_min, fminf(a.v[i], b.v[i]))
+IVY_MATH_X4_OP(floatx4_max, fmaxf(a.v[i], b.v[i]))
+#undef IVY_MATH_X4_OP
+static inline floatx4_t floatx4_sqrt(floatx4_t a)
+{
+	for (int i = 0; i < 4; i++) {
+		a.v[i] = sqrtf(a.v[i]);
+	}
+	return a;
+}
+
+static inline floatx4_t floatx4_rcp_safe(floatx4_t a)
+{
+	for (int i = 0; i < 4; i++) {
+		a.v[i] = a.v[i] != 0.0f ? 1.0f / a.v[i] : 0.0f;
+	}
+	return a;
+}
+#endif
+
+#if defined(IVY_MATH_X8_AVX)
+static inline floatx8_t floatx8_set1(float f)
+{
+	return _mm256_set1_ps(f);
+}
+
+static inline floatx8_t floatx8_load(const float *p)
+{
+	return _mm256_loadu_ps(p);
+}
+
+static inline void floatx8_store(float *p, floatx8_t a)
+{
+	_mm256_storeu_ps(p, a);
+}
+
+static inline floatx8_t floatx8_add(floatx8_t a, floatx8_t b)
+{
+	return _mm256_add_ps(a, b);
+}
+
+static inline floatx8_t floatx8_sub(floatx8_t a, floatx8_t b)
+{
+	return _mm256_sub_ps(a, b);
+}
+
+static inline floatx8_t floatx8_mul(floatx8_t a, floatx8_t b)
+{
+	return _mm256_mul_ps(a, b);
+}
+
+static inline floatx8_t floatx8_div(floatx8_t a, floatx8_t b)
+{
+	return _mm256_div_ps(a, b);
+}
+
+static inline floatx8_t floatx8_min(floatx8_t a, floatx8_t b)
+{
+	return _mm256_min_ps(a, b);
+}
+
+static inline floatx8_t floatx8_max(floatx8_t a, floatx8_t b)
+{
+	return _mm256_max_ps(a, b);
+}
+
+static inline floatx8_t floatx8_sqrt(floatx8_t a)
+{
+	return _mm256_sqrt_ps(a);
+}
+
+static inline floatx8_t floatx8_rcp_safe(floatx8_t a)
+{
+	return _mm256_and_ps(_mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_NEQ_UQ), _mm256_div_ps(_mm256_set1_ps(1.0f), a));
+}
+#else
+static inline floatx8_t floatx8_set1(float f)
+{
+	return (floatx8_t){floatx4_set1(f), floatx4_set1(f)};
+}
+
+static inline floatx8_t floatx8_load(const float *p)
+{
+	return (floatx8_t){floatx4_load(p), floatx4_load(p + 4)};
 }
 
+static inline void floatx8_store(float *p, floatx8_t a)
+{
+	floatx4_store(p, a.lo);
+	floatx4_store(p + 4, a.hi);
+}
+#define IVY_MATH_X8_OP(name, op)                                        \
+	static inline floatx8_t name(floatx8_t a, floatx8_t b)              \
+	{                                                                   \
+		return (floatx8_t){op(a.lo, b.lo), op(a.hi, b.hi)};             \
+	}
+IVY_MATH_X8_OP(floatx8_add, floatx4_add)
+IVY_MATH_X8_OP(floatx8_sub, floatx4_sub)
+IVY_MATH_X8_OP(floatx8_mul, floatx4_mul)
+IVY_MATH_X8_OP(floatx8_div, floatx4_div)
+IVY_MATH_X8_OP(floatx8_min, floatx4_min)
+IVY_MATH_X8_OP(floatx8_max, floatx4_max)
+#undef IVY_MATH_X8_OP
+static inline floatx8_t floatx8_sqrt(floatx8_t a)
+{
+	return (floatx8_t){floatx4_sqrt(a.lo), floatx4_sqrt(a.hi)};
+}
+
+static inline floatx8_t floatx8_rcp_safe(floatx8_t a)
+{
+	return (floatx8_t){floatx4_rcp_safe(a.lo), floatx4_rcp_safe(a.hi)};
+}
+
+#endif
+
+// Loads and stores of consecutive vec3_t, the SSE versions transpose 4
+// vectors with shuffles instead of going through memory
+#if defined(IVY_MATH_SSE)
+static inline vec3x4_t vec3x4_load(const vec3_t *v)
+{
+	const float *p = &v->x;
+	// [x0 y0 z0 x1] [y1 z1 x2 y2] [z2 x3 y3 z3]
+	__m128 m0 = _mm_loadu_ps(p), m1 = _mm_loadu_ps(p + 4), m2 = _mm_loadu_ps(p + 8);
+	__m128 x = _mm_shuffle_ps(m0, _mm_shuffle_ps(m1, m2, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+	__m128 y = _mm_shuffle_ps(_mm_shuffle_ps(m0, m1, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+	__m128 z = _mm_shuffle_ps(_mm_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(m2, m2, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+	return (vec3x4_t){x, y, z};
+}
+
+static inline void vec3x4_store(vec3_t *v, vec3x4_t a)
+{
+	float *p = &v->x;
+	__m128 xy_lo = _mm_unpacklo_ps(a.x, a.y);
+	__m128 xy_hi = _mm_unpackhi_ps(a.x, a.y);
+	__m128 m0 = _mm_shuffle_ps(xy_lo, _mm_shuffle_ps(a.z, a.x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0));
+	__m128 m1 = _mm_shuffle_ps(_mm_shuffle_ps(a.y, a.z, _MM_SHUFFLE(1, 1, 1, 1)), xy_hi, _MM_SHUFFLE(1, 0, 2, 0));
+	__m128 m2 = _mm_shuffle_ps(a.z, xy_hi, _MM_SHUFFLE(3, 2, 3, 2));
+	m2 = _mm_shuffle_ps(m2, m2, _MM_SHUFFLE(1, 3, 2, 0));
+	_mm_storeu_ps(p, m0);
+	_mm_storeu_ps(p + 4, m1);
+	_mm_storeu_ps(p + 8, m2);
+}
+#else
+static inline vec3x4_t vec3x4_load(const vec3_t *v)
+{
+	float x[4], y[4], z[4];
+	for (int i = 0; i < 4; i++) {
+		x[i] = v[i].x, y[i] = v[i].y, z[i] = v[i].z;
+	}
+	return (vec3x4_t){floatx4_load(x), floatx4_load(y), floatx4_load(z)};
+}
+
+static inline void vec3x4_store(vec3_t *v, vec3x4_t a)
+{
+	float x[4], y[4], z[4];
+	floatx4_store(x, a.x);
+	floatx4_store(y, a.y);
+	floatx4_store(z, a.z);
+	for (int i = 0; i < 4; i++) {
+		v[i] = (vec3_t){x[i], y[i], z[i]};
+	}
+}
+#endif
+
+#if defined(IVY_MATH_X8_AVX)
+static inline vec3x8_t vec3x8_load(const vec3_t *v)
+{
+	vec3x4_t lo = vec3x4_load(v), hi = vec3x4_load(v + 4);
+	return (vec3x8_t){
+		_mm256_insertf128_ps(_mm256_castps128_ps256(lo.x), hi.x, 1),
+		_mm256_insertf128_ps(_mm256_castps128_ps256(lo.y), hi.y, 1),
+		_mm256_insertf128_ps(_mm256_castps128_ps256(lo.z), hi.z, 1),
+	};
+}
+
+static inline void vec3x8_store(vec3_t *v, vec3x8_t a)
+{
+	vec3x4_store(v, (vec3x4_t){_mm256_castps256_ps128(a.x), _mm256_castps256_ps128(a.y), _mm256_castps256_ps128(a.z)});
+	vec3x4_store(v + 4, (vec3x4_t){_mm256_extractf128_ps(a.x, 1), _mm256_extractf128_ps(a.y, 1), _mm256_extractf128_ps(a.z, 1)});
+}
+#else
+static inline vec3x8_t vec3x8_load(const vec3_t *v)
+{
+	vec3x4_t lo = vec3x4_load(v), hi = vec3x4_load(v + 4);
+	return (vec3x8_t){{lo.x, hi.x}, {lo.y, hi.y}, {lo.z, hi.z}};
+}
+
+static inline void vec3x8_store(vec3_t *v, vec3x8_t a)
+{
+	vec3x4_store(v, (vec3x4_t){a.x.lo, a.y.lo, a.z.lo});
+	vec3x4_store(v + 4, (vec3x4_t){a.x.hi, a.y.hi, a.z.hi});
+}
+#endif
+
+// The vec3 API over both widths. Functions taking a float use it on
+// every lane, transform uses the same row vector convention as
+// vec3_transform
+#define IVY_MATH_VEC3XN(N)                                                                      \
+	static inline vec3x##N##_t vec3x##N##_set1(vec3_t v)                                        \
+	{                                                                                           \
+		return (vec3x##N##_t){floatx##N##_set1(v.x), floatx##N##_set1(v.y), floatx##N##_set1(v.z)}; \
+	}                                                                                           \
+	static inline vec3x##N##_t vec3x##N##_add(vec3x##N##_t a, vec3x##N##_t b)                   \
+	{                                                                                           \
+		return (vec3x##N##_t){floatx##N##_add(a.x, b.x), floatx##N##_add(a.y, b.y), floatx##N##_add(a.z, b.z)}; \
+	}                                                                                           \
+	static inline vec3x##N##_t vec3x##N##_sub(vec3x##N##_t a, vec3x##N##_t b)                   \
+	{                                                                                           \
+		return (vec3x##N##_t){floatx##N##_sub(a.x, b.x), floatx##N##_sub(a.y, b.y), floatx##N##_sub(a.z, b.z)}; \
+	}                                                                                           \
+	static inline vec3x##N##_t vec3x##N##_mul(vec3x##N##_t a, vec3x##N##_t b)                   \
+	{                                                                                           \
+		return (vec3x##N##_t){floatx##N##_mul(a.x, b.x), floatx##N##_mul(a.y, b.y), floatx##N##_mul(a.z, b.z)}; \
+	}                                                                                           \
+	static inline vec3x##N##_t vec3x##N##_mulv(vec3x##N##_t a, floatx##N##_t b)                 \
+	{                                                                                           \
+		return (vec3x##N##_t){floatx##N##_mul(a.x, b), floatx##N##_mul(a.y, b), floatx##N##_mul(a.z, b)}; \
+	}                                                                                           \
+	static inline vec3x##N##_t vec3x##N##_min(vec3x##N##_t a, vec3x##N##_t b)                   \
+	{                                                                                           \
+		return (vec3x##N##_t){floatx##N##_min(a.x, b.x), floatx##N##_min(a.y, b.y), floatx##N##_min(a.z, b.z)}; \
+	}                                                                                           \
+	static inline vec3x##N##_t vec3x##N##_max(vec3x##N##_t a, vec3x##N##_t b)                   \
+	{                                                                                           \
+		return (vec3x##N##_t){floatx##N##_max(a.x, b.x), floatx##N##_max(a.y, b.y), floatx##N##_max(a.z, b.z)}; \
+	}                                                                                           \
+	static inline floatx##N##_t vec3x##N##_dot(vec3x##N##_t a, vec3x##N##_t b)                  \
+	{                                                                                           \
+		return floatx##N##_add(floatx##N##_add(floatx##N##_mul(a.x, b.x), floatx##N##_mul(a.y, b.y)), floatx##N##_mul(a.z, b.z)); \
+	}                                                                                           \
+	static inline vec3x##N##_t vec3x##N##_cross(vec3x##N##_t a, vec3x##N##_t b)                 \
+	{                                                                                           \
+		return (vec3x##N##_t){                                                                  \
+			floatx##N##_sub(floatx##N##_mul(a.y, b.z), floatx##N##_mul(a.z, b.y)),              \
+			floatx##N##_sub(floatx##N##_mul(a.z, b.x), floatx##N##_mul(a.x, b.z)),              \
+			floatx##N##_sub(floatx##N##_mul(a.x, b.y), floatx##N##_mul(a.y, b.x)),              \
+		};                                                                                      \
+	}                                                                                           \
+	static inline floatx##N##_t vec3x##N##_lensq(vec3x##N##_t a)                                \
+	{                                                                                           \
+		return vec3x##N##_dot(a, a);                                                            \
+	}                                                                                           \
+	static inline floatx##N##_t vec3x##N##_len(vec3x##N##_t a)                                  \
+	{                                                                                           \
+		return floatx##N##_sqrt(vec3x##N##_dot(a, a));                                          \
+	}                                                                                           \
+	/* Zero length lanes come out as zero, like vec3_normalize */                               \
+	static inline vec3x##N##_t vec3x##N##_normalize(vec3x##N##_t a)                             \
+	{                                                                                           \
+		return vec3x##N##_mulv(a, floatx##N##_rcp_safe(vec3x##N##_len(a)));                     \
+	}                                                                                           \
+	static inline vec3x##N##_t vec3x##N##_lerp(vec3x##N##_t a, vec3x##N##_t b, floatx##N##_t t) \
+	{                                                                                           \
+		return vec3x##N##_add(a, vec3x##N##_mulv(vec3x##N##_sub(b, a), t));                     \
+	}                                                                                           \
+	static inline vec3x##N##_t vec3x##N##_transform(vec3x##N##_t v, const mat4_t *m)            \
+	{                                                                                           \
+		vec3x##N##_t r;                                                                         \
+		const float *c = &m->m00;                                                               \
+		floatx##N##_t *out[3] = {&r.x, &r.y, &r.z};                                             \
+		for (int i = 0; i < 3; i++) {                                                           \
+			floatx##N##_t acc = floatx##N##_mul(v.x, floatx##N##_set1(c[0 * 4 + i]));           \
+			acc = floatx##N##_add(acc, floatx##N##_mul(v.y, floatx##N##_set1(c[1 * 4 + i])));   \
+			acc = floatx##N##_add(acc, floatx##N##_mul(v.z, floatx##N##_set1(c[2 * 4 + i])));   \
+			*out[i] = floatx##N##_add(acc, floatx##N##_set1(c[3 * 4 + i]));                     \
+		}                                                                                       \
+		return r;                                                                               \
+	}
+
+IVY_MATH_VEC3XN(4)
+IVY_MATH_VEC3XN(8)
+#undef IVY_MATH_VEC3XN
+
+// ---------------------------------------------------------------------------
+// FAST PACKETS
+
+// Packet forms of the FAST FLOAT functions with the same polynomials and
+// error bounds, built on a few bitwise and compare primitives. Masks from
+// the compares are all ones or all zeros per lane, like SSE
+
+#if defined(IVY_MATH_SSE)
+static inline floatx4_t floatx4_set1_bits(unsigned int u)
+{
+	return _mm_castsi128_ps(_mm_set1_epi32((int)u));
+}
+
+static inline floatx4_t floatx4_and(floatx4_t a, floatx4_t b)
+{
+	return _mm_and_ps(a, b);
+}
+
+static inline floatx4_t floatx4_or(floatx4_t a, floatx4_t b)
+{
+	return _mm_or_ps(a, b);
+}
+
+static inline floatx4_t floatx4_cmplt(floatx4_t a, floatx4_t b)
+{
+	return _mm_cmplt_ps(a, b);
+}
+
+// mask ? a : b
+static inline floatx4_t floatx4_select(floatx4_t mask, floatx4_t a, floatx4_t b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// To nearest, for |a| < 2^31
+static inline floatx4_t floatx4_round(floatx4_t a)
+{
+	return _mm_cvtepi32_ps(_mm_cvtps_epi32(a));
+}
+
+// 2^n for whole n in [-126, 127]
+static inline floatx4_t _floatx4_pow2i(floatx4_t n)
+{
+	return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127)), 23));
+}
+
+// Unbiased exponent of positive a
+static inline floatx4_t _floatx4_exponent(floatx4_t a)
+{
+	return _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(a), 23), _mm_set1_epi32(127)));
+}
+
+static inline floatx4_t floatx4_rsqrt_fast(floatx4_t a)
+{
+	__m128 y = _mm_rsqrt_ps(a);
+	return _mm_mul_ps(y, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), a), _mm_mul_ps(y, y))));
+}
+
+// Bit i set when lane i of a mask is set
+static inline int floatx4_movemask(floatx4_t mask)
+{
+	return _mm_movemask_ps(mask);
+}
+#elif defined(IVY_MATH_NEON)
+static inline floatx4_t floatx4_set1_bits(unsigned int u)
+{
+	return vreinterpretq_f32_u32(vdupq_n_u32(u));
+}
+
+static inline floatx4_t floatx4_and(floatx4_t a, floatx4_t b)
+{
+	return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+
+static inline floatx4_t floatx4_or(floatx4_t a, floatx4_t b)
+{
+	return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+
+static inline floatx4_t floatx4_cmplt(floatx4_t a, floatx4_t b)
+{
+	return vreinterpretq_f32_u32(vcltq_f32(a, b));
+}
+
+static inline floatx4_t floatx4_select(floatx4_t mask, floatx4_t a, floatx4_t b)
+{
+	return vbslq_f32(vreinterpretq_u32_f32(mask), a, b);
+}
+
+static inline floatx4_t floatx4_round(floatx4_t a)
+{
+	return vrndnq_f32(a);
+}
+
+static inline floatx4_t _floatx4_pow2i(floatx4_t n)
+{
+	return vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(n), vdupq_n_s32(127)), 23));
+}
+
+static inline floatx4_t _floatx4_exponent(floatx4_t a)
+{
+	int32x4_t e = vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_f32(a), 23));
+	return vcvtq_f32_s32(vsubq_s32(e, vdupq_n_s32(127)));
+}
+
+// The NEON estimate only has 8 bits, it takes two steps
+static inline floatx4_t floatx4_rsqrt_fast(floatx4_t a)
+{
+	float32x4_t y = vrsqrteq_f32(a);
+	y = vmulq_f32(y, vrsqrtsq_f32(vmulq_f32(a, y), y));
+	return vmulq_f32(y, vrsqrtsq_f32(vmulq_f32(a, y), y));
+}
+
+static inline int floatx4_movemask(floatx4_t mask)
+{
+	static const uint32_t bits[4] = {1, 2, 4, 8};
+	return vaddvq_u32(vandq_u32(vreinterpretq_u32_f32(mask), vld1q_u32(bits)));
+}
+#else
+static inline floatx4_t floatx4_set1_bits(unsigned int u)
+{
+	_ivy_math_bits_t b = {.u = u};
+	return floatx4_set1(b.f);
+}
+
+#define IVY_MATH_X4_BITS(name, expr)                                   \
+	static inline floatx4_t name(floatx4_t a, floatx4_t b)             \
+	{                                                                  \
+		for (int i = 0; i < 4; i++) {                                  \
+			_ivy_math_bits_t x = {.f = a.v[i]}, y = {.f = b.v[i]};     \
+			x.u = expr;                                                \
+			a.v[i] = x.f;                                              \
+		}                                                              \
+		return a;                                                      \
+	}
+IVY_MATH_X4_BITS(floatx4_and, x.u & y.u)
+IVY_MATH_X4_BITS(floatx4_or, x.u | y.u)
+IVY_MATH_X4_BITS(floatx4_cmplt, x.f < y.f ? 0xffffffffu : 0)
+#undef IVY_MATH_X4_BITS
+static inline floatx4_t floatx4_select(floatx4_t mask, floatx4_t a, floatx4_t b)
+{
+	for (int i = 0; i < 4; i++) {
+		_ivy_math_bits_t m = {.f = mask.v[i]};
+		a.v[i] = m.u ? a.v[i] : b.v[i];
+	}
+	return a;
+}
+
+static inline floatx4_t floatx4_round(floatx4_t a)
+{
+	for (int i = 0; i < 4; i++) {
+		a.v[i] = (float)(int)(a.v[i] + (a.v[i] < 0 ? -0.5f : 0.5f));
+	}
+	return a;
+}
+
+static inline floatx4_t _floatx4_pow2i(floatx4_t n)
+{
+	for (int i = 0; i < 4; i++) {
+		_ivy_math_bits_t b = {.u = (unsigned int)((int)n.v[i] + 127) << 23};
+		n.v[i] = b.f;
+	}
+	return n;
+}
+
+static inline floatx4_t _floatx4_exponent(floatx4_t a)
+{
+	for (int i = 0; i < 4; i++) {
+		_ivy_math_bits_t b = {.f = a.v[i]};
+		a.v[i] = (float)((int)(b.u >> 23) - 127);
+	}
+	return a;
+}
+
+static inline floatx4_t floatx4_rsqrt_fast(floatx4_t a)
+{
+	for (int i = 0; i < 4; i++) {
+		a.v[i] = frsqrt_fast(a.v[i]);
+	}
+	return a;
+}
+
+static inline int floatx4_movemask(floatx4_t mask)
+{
+	int bits = 0;
+	for (int i = 0; i < 4; i++) {
+		_ivy_math_bits_t b = {.f = mask.v[i]};
+		bits |= (b.u >> 31) << i;
+	}
+	return bits;
+}
+#endif
+
+#if defined(IVY_MATH_X8_AVX)
+static inline floatx8_t floatx8_set1_bits(unsigned int u)
+{
+	return _mm256_castsi256_ps(_mm256_set1_epi32((int)u));
+}
+
+static inline floatx8_t floatx8_and(floatx8_t a, floatx8_t b)
+{
+	return _mm256_and_ps(a, b);
+}
+
+static inline floatx8_t floatx8_or(floatx8_t a, floatx8_t b)
+{
+	return _mm256_or_ps(a, b);
+}
+
+static inline floatx8_t floatx8_cmplt(floatx8_t a, floatx8_t b)
+{
+	return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+}
+
+// Not blendv, it is several times slower than the logic ops on some cores
+static inline floatx8_t floatx8_select(floatx8_t mask, floatx8_t a, floatx8_t b)
+{
+	return _mm256_or_ps(_mm256_and_ps(mask, a), _mm256_andnot_ps(mask, b));
+}
+
+static inline floatx8_t floatx8_round(floatx8_t a)
+{
+	return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+
+// AVX has no 256 bit integer shifts, (n + 127) * 2^23 converted to an
+// integer already is the bit pattern
+static inline floatx8_t _floatx8_pow2i(floatx8_t n)
+{
+	__m256 e = _mm256_mul_ps(_mm256_add_ps(n, _mm256_set1_ps(127.0f)), _mm256_set1_ps(8388608.0f));
+	return _mm256_castsi256_ps(_mm256_cvtps_epi32(e));
+}
+
+static inline floatx8_t _floatx8_exponent(floatx8_t a)
+{
+	__m256 e = _mm256_cvtepi32_ps(_mm256_castps_si256(_mm256_and_ps(a, floatx8_set1_bits(0x7f800000))));
+	return _mm256_sub_ps(_mm256_mul_ps(e, _mm256_set1_ps(1.0f / 8388608.0f)), _mm256_set1_ps(127.0f));
+}
+
+static inline floatx8_t floatx8_rsqrt_fast(floatx8_t a)
+{
+	__m256 y = _mm256_rsqrt_ps(a);
+	return _mm256_mul_ps(y, _mm256_sub_ps(_mm256_set1_ps(1.5f), _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), a), _mm256_mul_ps(y, y))));
+}
+
+static inline int floatx8_movemask(floatx8_t mask)
+{
+	return _mm256_movemask_ps(mask);
+}
+#else
+static inline floatx8_t floatx8_set1_bits(unsigned int u)
+{
+	return (floatx8_t){floatx4_set1_bits(u), floatx4_set1_bits(u)};
+}
+
+#define IVY_MATH_X8_OP(name, op)                            \
+	static inline floatx8_t name(floatx8_t a, floatx8_t b)  \
+	{                                                       \
+		return (floatx8_t){op(a.lo, b.lo), op(a.hi, b.hi)}; \
+	}
+IVY_MATH_X8_OP(floatx8_and, floatx4_and)
+IVY_MATH_X8_OP(floatx8_or, floatx4_or)
+IVY_MATH_X8_OP(floatx8_cmplt, floatx4_cmplt)
+#undef IVY_MATH_X8_OP
+static inline floatx8_t floatx8_select(floatx8_t mask, floatx8_t a, floatx8_t b)
+{
+	return (floatx8_t){floatx4_select(mask.lo, a.lo, b.lo), floatx4_select(mask.hi, a.hi, b.hi)};
+}
+
+static inline floatx8_t floatx8_round(floatx8_t a)
+{
+	return (floatx8_t){floatx4_round(a.lo), floatx4_round(a.hi)};
+}
+
+static inline floatx8_t _floatx8_pow2i(floatx8_t n)
+{
+	return (floatx8_t){_floatx4_pow2i(n.lo), _floatx4_pow2i(n.hi)};
+}
+
+static inline floatx8_t _floatx8_exponent(floatx8_t a)
+{
+	return (floatx8_t){_floatx4_exponent(a.lo), _floatx4_exponent(a.hi)};
+}
+
+static inline floatx8_t floatx8_rsqrt_fast(floatx8_t a)
+{
+	return (floatx8_t){floatx4_rsqrt_fast(a.lo), floatx4_rsqrt_fast(a.hi)};
+}
+
+static inline int floatx8_movemask(floatx8_t mask)
+{
+	return floatx4_movemask(mask.lo) | floatx4_movemask(mask.hi) << 4;
+}
+#endif
+
+#define IVY_MATH_FASTN(N)                                                                                                            \
+	static inline floatx##N##_t _floatx##N##_madd(floatx##N##_t a, floatx##N##_t b, floatx##N##_t c)                                 \
+	{                                                                                                                                \
+		return floatx##N##_add(floatx##N##_mul(a, b), c);                                                                            \
+	}                                                                                                                                \
+	static inline floatx##N##_t _floatx##N##_sin_fast(floatx##N##_t x, float phase)                                                  \
+	{                                                                                                                                \
+		floatx##N##_t ph = floatx##N##_set1(phase);                                                                                  \
+		floatx##N##_t k = floatx##N##_round(floatx##N##_mul(floatx##N##_add(x, ph), floatx##N##_set1((float)(0.5 / PI))));           \
+		floatx##N##_t r = floatx##N##_sub(x, floatx##N##_mul(k, floatx##N##_set1(IVY_MATH_TWO_PI_HI)));                              \
+		r = floatx##N##_add(floatx##N##_sub(r, floatx##N##_mul(k, floatx##N##_set1(IVY_MATH_TWO_PI_LO))), ph);                       \
+		floatx##N##_t half = floatx##N##_set1((float)(PI / 2)), pi = floatx##N##_set1((float)PI), zero = floatx##N##_set1(0.0f);     \
+		r = floatx##N##_select(floatx##N##_cmplt(half, r), floatx##N##_sub(pi, r), r);                                               \
+		r = floatx##N##_select(floatx##N##_cmplt(r, floatx##N##_sub(zero, half)), floatx##N##_sub(floatx##N##_sub(zero, pi), r), r); \
+		floatx##N##_t r2 = floatx##N##_mul(r, r);                                                                                    \
+		floatx##N##_t p = _floatx##N##_madd(r2, floatx##N##_set1(IVY_MATH_SIN_C9), floatx##N##_set1(IVY_MATH_SIN_C7));               \
+		p = _floatx##N##_madd(r2, p, floatx##N##_set1(IVY_MATH_SIN_C5));                                                             \
+		p = _floatx##N##_madd(r2, p, floatx##N##_set1(IVY_MATH_SIN_C3));                                                             \
+		p = _floatx##N##_madd(r2, p, floatx##N##_set1(IVY_MATH_SIN_C1));                                                             \
+		return floatx##N##_mul(r, p);                                                                                                \
+	}                                                                                                                                \
+	static inline floatx##N##_t floatx##N##_sin_fast(floatx##N##_t x)                                                                \
+	{                                                                                                                                \
+		return _floatx##N##_sin_fast(x, 0.0f);                                                                                       \
+	}                                                                                                                                \
+	static inline floatx##N##_t floatx##N##_cos_fast(floatx##N##_t x)                                                                \
+	{                                                                                                                                \
+		return _floatx##N##_sin_fast(x, (float)(PI / 2));                                                                            \
+	}                                                                                                                                \
+	static inline floatx##N##_t floatx##N##_exp_fast(floatx##N##_t x)                                                                \
+	{                                                                                                                                \
+		x = floatx##N##_min(floatx##N##_max(x, floatx##N##_set1(-87.0f)), floatx##N##_set1(88.0f));                                  \
+		floatx##N##_t n = floatx##N##_round(floatx##N##_mul(x, floatx##N##_set1(1.442695041f)));                                     \
+		floatx##N##_t r = floatx##N##_sub(x, floatx##N##_mul(n, floatx##N##_set1(IVY_MATH_LN2_HI)));                                 \
+		r = floatx##N##_sub(r, floatx##N##_mul(n, floatx##N##_set1(IVY_MATH_LN2_LO)));                                               \
+		floatx##N##_t p = _floatx##N##_madd(r, floatx##N##_set1(IVY_MATH_EXP_C6), floatx##N##_set1(IVY_MATH_EXP_C5));                \
+		p = _floatx##N##_madd(r, p, floatx##N##_set1(IVY_MATH_EXP_C4));                                                              \
+		p = _floatx##N##_madd(r, p, floatx##N##_set1(IVY_MATH_EXP_C3));                                                              \
+		p = _floatx##N##_madd(r, p, floatx##N##_set1(IVY_MATH_EXP_C2));                                                              \
+		p = _floatx##N##_madd(floatx##N##_mul(r, r), p, floatx##N##_add(floatx##N##_set1(1.0f), r));                                 \
+		return floatx##N##_mul(p, _floatx##N##_pow2i(n));                                                                            \
+	}                                                                                                                                \
+	static inline floatx##N##_t floatx##N##_log_fast(floatx##N##_t x)                                                                \
+	{                                                                                                                                \
+		floatx##N##_t one = floatx##N##_set1(1.0f);                                                                                  \
+		floatx##N##_t e = _floatx##N##_exponent(x);                                                                                  \
+		floatx##N##_t m = floatx##N##_or(floatx##N##_and(x, floatx##N##_set1_bits(0x007fffff)), one);                                \
+		floatx##N##_t big = floatx##N##_cmplt(floatx##N##_set1(1.414213562f), m);                                                    \
+		m = floatx##N##_select(big, floatx##N##_mul(m, floatx##N##_set1(0.5f)), m);                                                  \
+		e = floatx##N##_add(e, floatx##N##_and(big, one));                                                                           \
+		floatx##N##_t s = floatx##N##_div(floatx##N##_sub(m, one), floatx##N##_add(m, one));                                         \
+		floatx##N##_t s2 = floatx##N##_mul(s, s);                                                                                    \
+		floatx##N##_t l = _floatx##N##_madd(s2, floatx##N##_set1(1.0f / 7.0f), floatx##N##_set1(1.0f / 5.0f));                       \
+		l = _floatx##N##_madd(s2, l, floatx##N##_set1(1.0f / 3.0f));                                                                 \
+		l = floatx##N##_mul(floatx##N##_add(s, s), _floatx##N##_madd(s2, l, one));                                                   \
+		return _floatx##N##_madd(e, floatx##N##_set1(IVY_MATH_LN2_HI), _floatx##N##_madd(e, floatx##N##_set1(IVY_MATH_LN2_LO), l));  \
+	}                                                                                                                                \
+	static inline floatx##N##_t floatx##N##_atan2_fast(floatx##N##_t y, floatx##N##_t x)                                             \
+	{                                                                                                                                \
+		floatx##N##_t abs = floatx##N##_set1_bits(0x7fffffff);                                                                       \
+		floatx##N##_t ax = floatx##N##_and(x, abs), ay = floatx##N##_and(y, abs);                                                    \
+		floatx##N##_t z = floatx##N##_mul(floatx##N##_min(ax, ay), floatx##N##_rcp_safe(floatx##N##_max(ax, ay)));                   \
+		floatx##N##_t z2 = floatx##N##_mul(z, z);                                                                                    \
+		floatx##N##_t a = _floatx##N##_madd(z2, floatx##N##_set1(IVY_MATH_ATAN_C11), floatx##N##_set1(IVY_MATH_ATAN_C9));            \
+		a = _floatx##N##_madd(z2, a, floatx##N##_set1(IVY_MATH_ATAN_C7));                                                            \
+		a = _floatx##N##_madd(z2, a, floatx##N##_set1(IVY_MATH_ATAN_C5));                                                            \
+		a = _floatx##N##_madd(z2, a, floatx##N##_set1(IVY_MATH_ATAN_C3));                                                            \
+		a = floatx##N##_mul(z, _floatx##N##_madd(z2, a, floatx##N##_set1(IVY_MATH_ATAN_C1)));                                        \
+		a = floatx##N##_select(floatx##N##_cmplt(ax, ay), floatx##N##_sub(floatx##N##_set1((float)(PI / 2)), a), a);                 \
+		a = floatx##N##_select(floatx##N##_cmplt(x, floatx##N##_set1(0.0f)), floatx##N##_sub(floatx##N##_set1((float)PI), a), a);    \
+		return floatx##N##_or(a, floatx##N##_and(y, floatx##N##_set1_bits(0x80000000)));                                             \
+	}
+IVY_MATH_FASTN(4)
+IVY_MATH_FASTN(8)
+#undef IVY_MATH_FASTN
+
+// ---------------------------------------------------------------------------
+// VEC3 ARRAYS
+
+// Whole buffer operations, 8 vectors per step through vec3x8_t with a
+// scalar tail. Pointers need no alignment and out may be the input
+
+static inline void vec3_array_add(vec3_t *out, const vec3_t *a, const vec3_t *b, size_t count)
+{
+	// Component wise, so the buffers are walked as plain floats
+	const float *pa = &a->x, *pb = &b->x;
+	float *po = &out->x;
+	size_t n = count * 3, body = n & ~(size_t)7, i = 0;
+	for (; i < body; i += 8) {
+		floatx8_store(po + i, floatx8_add(floatx8_load(pa + i), floatx8_load(pb + i)));
+	}
+	for (; i < n; i++) {
+		po[i] = pa[i] + pb[i];
+	}
+}
+
+static inline void vec3_array_scale(vec3_t *out, const vec3_t *a, float s, size_t count)
+{
+	const float *pa = &a->x;
+	float *po = &out->x;
+	const floatx8_t vs = floatx8_set1(s);
+	size_t n = count * 3, body = n & ~(size_t)7, i = 0;
+	for (; i < body; i += 8) {
+		floatx8_store(po + i, floatx8_mul(floatx8_load(pa + i), vs));
+	}
+	for (; i < n; i++) {
+		po[i] = pa[i] * s;
+	}
+}
+
+static inline void vec3_array_normalize(vec3_t *out, const vec3_t *a, size_t count)
+{
+	size_t body = count & ~(size_t)7, i = 0;
+	for (; i < body; i += 8) {
+		vec3x8_store(out + i, vec3x8_normalize(vec3x8_load(a + i)));
+	}
+	for (; i < count; i++) {
+		out[i] = vec3_normalize(a[i]);
+	}
+}
+
+static inline void vec3_array_dot(float *out, const vec3_t *a, const vec3_t *b, size_t count)
+{
+	size_t body = count & ~(size_t)7, i = 0;
+	for (; i < body; i += 8) {
+		floatx8_store(out + i, vec3x8_dot(vec3x8_load(a + i), vec3x8_load(b + i)));
+	}
+	for (; i < count; i++) {
+		out[i] = vec3_dot(a[i], b[i]);
+	}
+}
+
+// Bounding box of count points, min > max when count is 0
+static inline void vec3_array_bounds(const vec3_t *a, size_t count, vec3_t *min, vec3_t *max)
+{
+	vec3x8_t lo = vec3x8_set1(vec3(INFINITY, INFINITY, INFINITY));
+	vec3x8_t hi = vec3x8_set1(vec3(-INFINITY, -INFINITY, -INFINITY));
+	size_t body = count & ~(size_t)7, i = 0;
+	for (; i < body; i += 8) {
+		vec3x8_t p = vec3x8_load(a + i);
+		lo = vec3x8_min(lo, p);
+		hi = vec3x8_max(hi, p);
+	}
+	vec3_t l[8], h[8];
+	vec3x8_store(l, lo);
+	vec3x8_store(h, hi);
+	*min = l[0], *max = h[0];
+	for (int k = 1; k < 8; k++) {
+		*min = vec3_min(*min, l[k]);
+		*max = vec3_max(*max, h[k]);
+	}
+	for (; i < count; i++) {
+		*min = vec3_min(*min, a[i]);
+		*max = vec3_max(*max, a[i]);
+	}
+}
+
+// Gathers component c of 8 vectors stride vec3_t apart
+static inline floatx8_t _vec3_gather8(const vec3_t *v, size_t stride, int c)
+{
+	float f[8];
+	for (int i = 0; i < 8; i++) {
+		f[i] = (&v[i * stride].x)[c];
+	}
+	return floatx8_load(f);
+}
+
+static inline vec3x8_t _vec3x8_gather(const vec3_t *v, size_t stride)
+{
+	return (vec3x8_t){_vec3_gather8(v, stride, 0), _vec3_gather8(v, stride, 1), _vec3_gather8(v, stride, 2)};
+}
+
+#if defined(IVY_MATH_SSE)
+// Faces of a normal followed by its 3 vertices, as in stl_face_t. Each face
+// is 3 vectors of 4 floats, transposing them across 4 faces gives every
+// component in its own register without any gather
+static inline void _vec3_face_normals_interleaved_sse(float *f, size_t count)
+{
+	for (size_t i = 0; i < count; i += 4, f += 48) {
+		__m128 n0 = _mm_loadu_ps(f), n1 = _mm_loadu_ps(f + 12), n2 = _mm_loadu_ps(f + 24), n3 = _mm_loadu_ps(f + 36);
+		__m128 a0 = _mm_loadu_ps(f + 4), a1 = _mm_loadu_ps(f + 16), a2 = _mm_loadu_ps(f + 28), a3 = _mm_loadu_ps(f + 40);
+		__m128 b0 = _mm_loadu_ps(f + 8), b1 = _mm_loadu_ps(f + 20), b2 = _mm_loadu_ps(f + 32), b3 = _mm_loadu_ps(f + 44);
+		// n0-n3 become nx ny nz v1x, a0-a3 v1y v1z v2x v2y, b0-b3 v2z v3x v3y v3z
+		_MM_TRANSPOSE4_PS(n0, n1, n2, n3);
+		_MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+		_MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+		vec3x4_t v1 = {n3, a0, a1};
+		vec3x4_t e1 = vec3x4_sub((vec3x4_t){a2, a3, b0}, v1);
+		vec3x4_t e2 = vec3x4_sub((vec3x4_t){b1, b2, b3}, v1);
+		vec3x4_t n = vec3x4_normalize(vec3x4_cross(e1, e2));
+		n0 = n.x, n1 = n.y, n2 = n.z;
+		_MM_TRANSPOSE4_PS(n0, n1, n2, n3);
+		// Only the first vector of each face changes
+		_mm_storeu_ps(f, n0);
+		_mm_storeu_ps(f + 12, n1);
+		_mm_storeu_ps(f + 24, n2);
+		_mm_storeu_ps(f + 36, n3);
+	}
+}
+#endif
+
+// Unit normals of count counter clockwise triangles. Triangle i has its
+// vertices at vertices[i * vertex_stride] and the two vec3_t after it, its
+// normal goes to normals[i * normal_stride]. Strides count vec3_t, so 3
+// and 1 for packed buffers and 4 and 4 for stl_face_t
+static inline void vec3_array_face_normals(vec3_t *normals, size_t normal_stride, const vec3_t *vertices, size_t vertex_stride, size_t count)
+{
+	size_t body = count & ~(size_t)7, i = 0;
+#if defined(IVY_MATH_SSE)
+	if (normal_stride == 4 && vertex_stride == 4 && vertices == normals + 1) {
+		_vec3_face_normals_interleaved_sse(&normals->x, body);
+		i = body;
+	}
+#endif
+	for (; i < body; i += 8) {
+		const vec3_t *v = vertices + i * vertex_stride;
+		vec3x8_t v1 = _vec3x8_gather(v, vertex_stride);
+		vec3x8_t e1 = vec3x8_sub(_vec3x8_gather(v + 1, vertex_stride), v1);
+		vec3x8_t e2 = vec3x8_sub(_vec3x8_gather(v + 2, vertex_stride), v1);
+		vec3x8_t n = vec3x8_normalize(vec3x8_cross(e1, e2));
+		if (normal_stride == 1) {
+			vec3x8_store(normals + i, n);
+		} else {
+			vec3_t tmp[8];
+			vec3x8_store(tmp, n);
+			for (int k = 0; k < 8; k++) {
+				normals[(i + k) * normal_stride] = tmp[k];
+			}
+		}
+	}
+	for (; i < count; i++) {
+		const vec3_t *v = vertices + i * vertex_stride;
+		normals[i * normal_stride] = vec3_normalize(vec3_cross(vec3_sub(v[1], v[0]), vec3_sub(v[2], v[0])));
+	}
+}
+
+// ---------------------------------------------------------------------------
+// QUATERNION
+
+// Rotations as unit quaternions. quat_mul(a, b) rotates by a then by b,
+// the same order as mat4_mul, and quat_to_mat4 matches mat4_rotate_axis
+
+static inline quat_t quat(float x, float y, float z, float w)
+{
+	return (quat_t){x, y, z, w};
+}
+
+static inline quat_t quat_identity()
+{
+	return (quat_t){0, 0, 0, 1};
+}
+
+// The only trig on the quaternion path, axis does not need to be unit
+static inline quat_t quat_from_axis_angle(vec3_t axis, float angle_rad)
+{
+	vec3_t u = vec3_mulv(vec3_normalize(axis), IVY_MATH_SINF(angle_rad * 0.5f));
+	return (quat_t){u.x, u.y, u.z, IVY_MATH_COSF(angle_rad * 0.5f)};
+}
+
+static inline float quat_dot(quat_t a, quat_t b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+static inline quat_t quat_normalize(quat_t q)
+{
+	float l = sqrtf(quat_dot(q, q));
+	if (l > 0)
+		return (quat_t){q.x / l, q.y / l, q.z / l, q.w / l};
+	return quat_identity();
+}
+
+// The inverse of a unit quaternion
+static inline quat_t quat_conjugate(quat_t q)
+{
+	return (quat_t){-q.x, -q.y, -q.z, q.w};
+}
+
+static inline quat_t quat_mul(quat_t a, quat_t b)
+{
+	// Hamilton product b * a
+	return (quat_t){
+		b.w * a.x + b.x * a.w + b.y * a.z - b.z * a.y,
+		b.w * a.y - b.x * a.z + b.y * a.w + b.z * a.x,
+		b.w * a.z + b.x * a.y - b.y * a.x + b.z * a.w,
+		b.w * a.w - b.x * a.x - b.y * a.y - b.z * a.z,
+	};
+}
+
+// Takes the short way round, cheaper than slerp and close to it for
+// nearby rotations
+static inline quat_t quat_nlerp(quat_t a, quat_t b, float t)
+{
+	float s = quat_dot(a, b) < 0 ? -t : t;
+	return quat_normalize((quat_t){
+		a.x * (1 - t) + b.x * s,
+		a.y * (1 - t) + b.y * s,
+		a.z * (1 - t) + b.z * s,
+		a.w * (1 - t) + b.w * s,
+	});
+}
+
+static inline quat_t quat_slerp(quat_t a, quat_t b, float t)
+{
+	float d = quat_dot(a, b);
+	if (d < 0) {
+		b = (quat_t){-b.x, -b.y, -b.z, -b.w};
+		d = -d;
+	}
+	// sin(theta) goes to 0 for nearly equal rotations
+	if (d > 0.9995f) {
+		return quat_nlerp(a, b, t);
+	}
+	float theta = acosf(d);
+	float s = IVY_MATH_SINF(theta);
+	float wa = IVY_MATH_SINF((1 - t) * theta) / s;
+	float wb = IVY_MATH_SINF(t * theta) / s;
+	return (quat_t){
+		a.x * wa + b.x * wb,
+		a.y * wa + b.y * wb,
+		a.z * wa + b.z * wb,
+		a.w * wa + b.w * wb,
+	};
+}
+
+// v + 2w (u x v) + 2u x (u x v) with u the vector part, no matrix needed
+static inline vec3_t quat_rotate_vec3(quat_t q, vec3_t v)
+{
+	vec3_t u = {q.x, q.y, q.z};
+	vec3_t t = vec3_mulv(vec3_cross(u, v), 2.0f);
+	return vec3_add(vec3_add(v, vec3_mulv(t, q.w)), vec3_cross(u, t));
+}
+
+// clang-format off
+static inline mat4_t quat_to_mat4(quat_t q)
+{
+	float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+	return (mat4_t) {
+		1 - 2 * (yy + zz),     2 * (xy + wz),     2 * (xz - wy), 0,
+		    2 * (xy - wz), 1 - 2 * (xx + zz),     2 * (yz + wx), 0,
+		    2 * (xz + wy),     2 * (yz - wx), 1 - 2 * (xx + yy), 0,
+		                0,                 0,                 0, 1,
+	};
+}
 // clang-format on
 
+// Rotation part of m, which must not be scaled
+static inline quat_t quat_from_mat4(mat4_t m)
+{
+	float trace = m.m00 + m.m11 + m.m22;
+	quat_t q;
+	if (trace > 0) {
+		float s = 0.5f / sqrtf(trace + 1);
+		q = (quat_t){(m.m12 - m.m21) * s, (m.m20 - m.m02) * s, (m.m01 - m.m10) * s, 0.25f / s};
+	} else if (m.m00 > m.m11 && m.m00 > m.m22) {
+		float s = 2 * sqrtf(1 + m.m00 - m.m11 - m.m22);
+		q = (quat_t){0.25f * s, (m.m10 + m.m01) / s, (m.m20 + m.m02) / s, (m.m12 - m.m21) / s};
+	} else if (m.m11 > m.m22) {
+		float s = 2 * sqrtf(1 + m.m11 - m.m00 - m.m22);
+		q = (quat_t){(m.m10 + m.m01) / s, 0.25f * s, (m.m21 + m.m12) / s, (m.m20 - m.m02) / s};
+	} else {
+		float s = 2 * sqrtf(1 + m.m22 - m.m00 - m.m11);
+		q = (quat_t){(m.m20 + m.m02) / s, (m.m21 + m.m12) / s, 0.25f * s, (m.m01 - m.m10) / s};
+	}
+	return quat_normalize(q);
+}
+
+// Same as quat_rotate_vec3 on every lane
+static inline vec3x8_t vec3x8_rotate(vec3x8_t v, quat_t q)
+{
+	vec3x8_t u = vec3x8_set1(vec3(q.x, q.y, q.z));
+	vec3x8_t t = vec3x8_mulv(vec3x8_cross(u, v), floatx8_set1(2.0f));
+	return vec3x8_add(vec3x8_add(v, vec3x8_mulv(t, floatx8_set1(q.w))), vec3x8_cross(u, t));
+}
+
+static inline void quat_rotate_array(vec3_t *out, quat_t q, const vec3_t *a, size_t count)
+{
+	size_t body = count & ~(size_t)7, i = 0;
+	for (; i < body; i += 8) {
+		vec3x8_store(out + i, vec3x8_rotate(vec3x8_load(a + i), q));
+	}
+	for (; i < count; i++) {
+		out[i] = quat_rotate_vec3(q, a[i]);
+	}
+}
+
+// ---------------------------------------------------------------------------
+// RAY
+
+// Moller-Trumbore against 8 triangles per step. Triangles are packed once
+// into tri8_t, vertex 0 and the two edges leaving it in SoA layout, so the
+// hot loop only loads and multiplies. Lanes past the end of a mesh are
+// zero area and never hit
+
+typedef struct {
+	vec3_t origin;
+	vec3_t dir;
+} ray_t;
+
+// Set t to the farthest distance of interest before the first call, only
+// closer hits are reported. u and v are the barycentric weights of vertex
+// 1 and 2, index the triangle
+typedef struct {
+	float t, u, v;
+	unsigned int index;
+} ray_hit_t;
+
+// Plain floats, one row of 8 lanes per component, so packets can live in
+// memory from IVY_MALLOC whatever the alignment the SIMD types want
+typedef struct {
+	float v0[3][8];
+	float e1[3][8];
+	float e2[3][8];
+} tri8_t;
+
+static inline size_t tri8_count(size_t triangles)
+{
+	return (triangles + 7) / 8;
+}
+
+// Packs count triangles into tri8_count(count) packets. Each triangle is
+// 3 consecutive vec3_t and they start every vertex_stride vec3_t, so an
+// stl mesh is packed with &stl.triangles->vertex1 and a stride of 4
+static inline void tri8_pack(tri8_t *packets, const vec3_t *vertices, size_t vertex_stride, size_t count)
+{
+	for (size_t p = 0; p < tri8_count(count); p++) {
+		tri8_t *packet = &packets[p];
+		memset(packet, 0, sizeof(tri8_t));
+		for (size_t l = 0; l < 8 && p * 8 + l < count; l++) {
+			const vec3_t *v = vertices + (p * 8 + l) * vertex_stride;
+			vec3_t e1 = vec3_sub(v[1], v[0]), e2 = vec3_sub(v[2], v[0]);
+			packet->v0[0][l] = v[0].x, packet->v0[1][l] = v[0].y, packet->v0[2][l] = v[0].z;
+			packet->e1[0][l] = e1.x, packet->e1[1][l] = e1.y, packet->e1[2][l] = e1.z;
+			packet->e2[0][l] = e2.x, packet->e2[1][l] = e2.y, packet->e2[2][l] = e2.z;
+		}
+	}
+}
+
+static inline vec3x8_t _tri8_load(const float (*c)[8])
+{
+	return (vec3x8_t){floatx8_load(c[0]), floatx8_load(c[1]), floatx8_load(c[2])};
+}
+
+// Distances along the ray, infinity in the lanes that miss. Parallel and
+// degenerate triangles have no inverse determinant and come out at t = 0,
+// behind the origin
+static inline floatx8_t _ray_tri8(const vec3x8_t *o, const vec3x8_t *d, const tri8_t *tri, floatx8_t *u, floatx8_t *v)
+{
+	vec3x8_t e1 = _tri8_load(tri->e1), e2 = _tri8_load(tri->e2);
+	vec3x8_t p = vec3x8_cross(*d, e2);
+	floatx8_t inv = floatx8_rcp_safe(vec3x8_dot(e1, p));
+	vec3x8_t s = vec3x8_sub(*o, _tri8_load(tri->v0));
+	vec3x8_t q = vec3x8_cross(s, e1);
+	*u = floatx8_mul(vec3x8_dot(s, p), inv);
+	*v = floatx8_mul(vec3x8_dot(*d, q), inv);
+	floatx8_t t = floatx8_mul(vec3x8_dot(e2, q), inv);
+	floatx8_t zero = floatx8_set1(0.0f);
+	floatx8_t miss = floatx8_or(floatx8_cmplt(*u, zero), floatx8_cmplt(*v, zero));
+	miss = floatx8_or(miss, floatx8_cmplt(floatx8_set1(1.0f), floatx8_add(*u, *v)));
+	miss = floatx8_or(miss, floatx8_cmplt(t, floatx8_set1(1e-6f)));
+	return floatx8_select(miss, floatx8_set1(INFINITY), t);
+}
+
+static inline int _ray_tri8_closest(floatx8_t t, floatx8_t u, floatx8_t v, size_t first, ray_hit_t *hit)
+{
+	float ts[8];
+	floatx8_store(ts, t);
+	int lane = -1;
+	for (int l = 0; l < 8; l++) {
+		if (ts[l] < hit->t) {
+			hit->t = ts[l];
+			lane = l;
+		}
+	}
+	if (lane < 0) {
+		return 0;
+	}
+	float us[8], vs[8];
+	floatx8_store(us, u);
+	floatx8_store(vs, v);
+	hit->u = us[lane], hit->v = vs[lane];
+	hit->index = first + lane;
+	return 1;
+}
+
+// Closest hit over packed triangles, for BVH leaves and brute force over a
+// whole mesh. Triangle indices are counted from first, returns 1 when hit
+// got closer
+static inline int ray_tri8_leaf(ray_t ray, const tri8_t *packets, size_t packet_count, size_t first, ray_hit_t *hit)
+{
+	vec3x8_t o = vec3x8_set1(ray.origin), d = vec3x8_set1(ray.dir);
+	int found = 0;
+	for (size_t i = 0; i < packet_count; i++) {
+		floatx8_t u, v;
+		floatx8_t t = _ray_tri8(&o, &d, &packets[i], &u, &v);
+		found |= _ray_tri8_closest(t, u, v, first + i * 8, hit);
+	}
+	return found;
+}
+
+// Brute force straight from unpacked triangles laid out like tri8_pack
+// takes them. Packs 8 at a time on the stack, meshes hit by more than a
+// few rays are faster packed once and run through ray_tri8_leaf
+static inline int ray_triangles_closest(ray_t ray, const vec3_t *vertices, size_t vertex_stride, size_t count, ray_hit_t *hit)
+{
+	int found = 0;
+	for (size_t i = 0; i < count; i += 8) {
+		tri8_t packet;
+		tri8_pack(&packet, vertices + i * vertex_stride, vertex_stride, count - i < 8 ? count - i : 8);
+		found |= ray_tri8_leaf(ray, &packet, 1, i, hit);
+	}
+	return found;
+}
+
+// ---------------------------------------------------------------------------
+// FRUSTUM
+
+// Planes of a view projection, normals point inwards and are unit length
+// so distances are in world units. Order is left, right, bottom, top,
+// near, far
+typedef struct {
+	vec3_t normal[6];
+	float d[6];
+} frustum_t;
+
+// Works on any view projection built from mat4_perspective or mat4_ortho,
+// which clip z to [-w, w]. With row vectors clip = v * m, so the planes
+// come from the columns of m
+static inline frustum_t frustum_from_mat4(mat4_t m)
+{
+	float c[4][4] = {
+		{m.m00, m.m10, m.m20, m.m30},
+		{m.m01, m.m11, m.m21, m.m31},
+		{m.m02, m.m12, m.m22, m.m32},
+		{m.m03, m.m13, m.m23, m.m33},
+	};
+	frustum_t f;
+	for (int i = 0; i < 6; i++) {
+		float s = i & 1 ? -1.0f : 1.0f;
+		const float *a = c[i / 2];
+		vec3_t n = vec3(c[3][0] + s * a[0], c[3][1] + s * a[1], c[3][2] + s * a[2]);
+		float inv = 1.0f / vec3_len(n);
+		f.normal[i] = vec3_mulv(n, inv);
+		f.d[i] = (c[3][3] + s * a[3]) * inv;
+	}
+	return f;
+}
+
+static inline int frustum_sphere_visible(const frustum_t *f, vec3_t center, float radius)
+{
+	for (int i = 0; i < 6; i++) {
+		if (vec3_dot(f->normal[i], center) + f->d[i] < -radius) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// Conservative like every plane test, boxes near a frustum corner can
+// pass while outside
+static inline int frustum_aabb_visible(const frustum_t *f, vec3_t min, vec3_t max)
+{
+	vec3_t c = vec3_mulv(vec3_add(min, max), 0.5f);
+	vec3_t e = vec3_mulv(vec3_sub(max, min), 0.5f);
+	for (int i = 0; i < 6; i++) {
+		vec3_t n = f->normal[i];
+		float r = fabsf(n.x) * e.x + fabsf(n.y) * e.y + fabsf(n.z) * e.z;
+		if (vec3_dot(n, c) + f->d[i] < -r) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// Appends base + the set lanes of mask to visible without branching, the
+// slot after the last visible one is overwritten but never past base + 8
+static inline size_t _frustum_compact(unsigned int *visible, size_t n, int mask, size_t base)
+{
+	for (int l = 0; l < 8; l++) {
+		visible[n] = base + l;
+		n += (mask >> l) & 1;
+	}
+	return n;
+}
+
+// The batch versions test 8 volumes per step and write the indices of
+// the visible ones to visible, which needs room for count. Returns how
+// many are visible
+static inline size_t frustum_cull_spheres(const frustum_t *f, const vec3_t *centers, const float *radii, size_t count, unsigned int *visible)
+{
+	vec3x8_t normal[6];
+	floatx8_t dist[6];
+	for (int p = 0; p < 6; p++) {
+		normal[p] = vec3x8_set1(f->normal[p]);
+		dist[p] = floatx8_set1(f->d[p]);
+	}
+	size_t body = count & ~(size_t)7, i = 0, n = 0;
+	for (; i < body; i += 8) {
+		vec3x8_t c = vec3x8_load(centers + i);
+		floatx8_t r = floatx8_sub(floatx8_set1(0.0f), floatx8_load(radii + i));
+		floatx8_t out = floatx8_set1(0.0f);
+		for (int p = 0; p < 6; p++) {
+			out = floatx8_or(out, floatx8_cmplt(floatx8_add(vec3x8_dot(c, normal[p]), dist[p]), r));
+		}
+		n = _frustum_compact(visible, n, ~floatx8_movemask(out), i);
+	}
+	for (; i < count; i++) {
+		visible[n] = i;
+		n += frustum_sphere_visible(f, centers[i], radii[i]);
+	}
+	return n;
+}
+
+static inline size_t frustum_cull_aabbs(const frustum_t *f, const vec3_t *mins, const vec3_t *maxs, size_t count, unsigned int *visible)
+{
+	vec3x8_t normal[6], normal_abs[6];
+	floatx8_t dist[6];
+	for (int p = 0; p < 6; p++) {
+		vec3_t n = f->normal[p];
+		normal[p] = vec3x8_set1(n);
+		normal_abs[p] = vec3x8_set1(vec3(fabsf(n.x), fabsf(n.y), fabsf(n.z)));
+		dist[p] = floatx8_set1(f->d[p]);
+	}
+	floatx8_t half = floatx8_set1(0.5f), zero = floatx8_set1(0.0f);
+	size_t body = count & ~(size_t)7, i = 0, n = 0;
+	for (; i < body; i += 8) {
+		vec3x8_t lo = vec3x8_load(mins + i), hi = vec3x8_load(maxs + i);
+		vec3x8_t c = vec3x8_mulv(vec3x8_add(lo, hi), half);
+		vec3x8_t e = vec3x8_mulv(vec3x8_sub(hi, lo), half);
+		floatx8_t out = zero;
+		for (int p = 0; p < 6; p++) {
+			floatx8_t d = floatx8_add(floatx8_add(vec3x8_dot(c, normal[p]), dist[p]), vec3x8_dot(e, normal_abs[p]));
+			out = floatx8_or(out, floatx8_cmplt(d, zero));
+		}
+		n = _frustum_compact(visible, n, ~floatx8_movemask(out), i);
+	}
+	for (; i < count; i++) {
+		visible[n] = i;
+		n += frustum_aabb_visible(f, mins[i], maxs[i]);
+	}
+	return n;
+}
+
 // TODO: mat4_determinant mat4_invert mat4_add mat4_sub mat4_mul mat4_frustum
 // mat4_trace
 
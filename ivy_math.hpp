@@ -0,0 +1,480 @@
+#ifndef IVY_MATH_HPP
+#define IVY_MATH_HPP
+
+// C++ value types over ivy_math.h. ivy::vec2f, ivy::vec3f and ivy::mat4f
+// have the layout of vec2_t, vec3_t and mat4_t and convert to and from
+// them implicitly, so they can be passed straight to the C API. The f
+// keeps them clear of the C constructors vec2() and vec3(), which would
+// hide a type of the same name brought in with using.
+//
+// Everything that does not need sqrt or trig is constexpr, constant
+// transforms fold at compile time. At run time the operators do the same
+// arithmetic as the C inline functions and mat4f products go through the
+// same SIMD kernels, so optimized builds generate the same code.
+//
+// Needs C++14.
+
+#include "ivy_math.h"
+
+#include <cstddef>
+#include <type_traits>
+
+// True while a constexpr function is evaluated at compile time. Compilers
+// without the builtin always take the constexpr path, correct but without
+// the SIMD kernels at run time
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define IVY_MATH_CONSTEVAL() __builtin_is_constant_evaluated()
+#endif
+#elif defined(_MSC_VER) && _MSC_VER >= 1925
+#define IVY_MATH_CONSTEVAL() __builtin_is_constant_evaluated()
+#endif
+#ifndef IVY_MATH_CONSTEVAL
+#define IVY_MATH_CONSTEVAL() true
+#endif
+
+namespace ivy {
+
+// ---------------------------------------------------------------------------
+// VECTOR2
+
+struct vec2f {
+	float x, y;
+
+	constexpr vec2f() : x(0), y(0)
+	{
+	}
+
+	constexpr vec2f(float x, float y) : x(x), y(y)
+	{
+	}
+
+	constexpr vec2f(vec2_t v) : x(v.x), y(v.y)
+	{
+	}
+
+	constexpr operator vec2_t() const
+	{
+		return vec2_t{x, y};
+	}
+
+	constexpr vec2f &operator+=(vec2f b)
+	{
+		x += b.x, y += b.y;
+		return *this;
+	}
+
+	constexpr vec2f &operator-=(vec2f b)
+	{
+		x -= b.x, y -= b.y;
+		return *this;
+	}
+
+	constexpr vec2f &operator*=(float v)
+	{
+		x *= v, y *= v;
+		return *this;
+	}
+
+	constexpr vec2f &operator/=(float v)
+	{
+		x /= v, y /= v;
+		return *this;
+	}
+};
+
+constexpr vec2f operator+(vec2f a, vec2f b)
+{
+	return {a.x + b.x, a.y + b.y};
+}
+
+constexpr vec2f operator-(vec2f a, vec2f b)
+{
+	return {a.x - b.x, a.y - b.y};
+}
+
+constexpr vec2f operator-(vec2f a)
+{
+	return {-a.x, -a.y};
+}
+
+// Component wise like vec2_mul
+constexpr vec2f operator*(vec2f a, vec2f b)
+{
+	return {a.x * b.x, a.y * b.y};
+}
+
+constexpr vec2f operator*(vec2f a, float v)
+{
+	return {a.x * v, a.y * v};
+}
+
+constexpr vec2f operator*(float v, vec2f a)
+{
+	return {a.x * v, a.y * v};
+}
+
+constexpr vec2f operator/(vec2f a, float v)
+{
+	return {a.x / v, a.y / v};
+}
+
+constexpr bool operator==(vec2f a, vec2f b)
+{
+	return a.x == b.x && a.y == b.y;
+}
+
+constexpr bool operator!=(vec2f a, vec2f b)
+{
+	return !(a == b);
+}
+
+constexpr float dot(vec2f a, vec2f b)
+{
+	return a.x * b.x + a.y * b.y;
+}
+
+constexpr float cross(vec2f a, vec2f b)
+{
+	return a.x * b.y - a.y * b.x;
+}
+
+constexpr float length_sq(vec2f a)
+{
+	return dot(a, a);
+}
+
+inline float length(vec2f a)
+{
+	return vec2_len(a);
+}
+
+inline vec2f normalize(vec2f a)
+{
+	return vec2_normalize(a);
+}
+
+inline vec2f rotate(vec2f a, float angle_rad)
+{
+	return vec2_rotate(a, angle_rad);
+}
+
+// ---------------------------------------------------------------------------
+// VECTOR3
+
+struct vec3f {
+	float x, y, z;
+
+	constexpr vec3f() : x(0), y(0), z(0)
+	{
+	}
+
+	constexpr vec3f(float x, float y, float z) : x(x), y(y), z(z)
+	{
+	}
+
+	constexpr vec3f(vec3_t v) : x(v.x), y(v.y), z(v.z)
+	{
+	}
+
+	constexpr operator vec3_t() const
+	{
+		return vec3_t{x, y, z};
+	}
+
+	constexpr vec3f &operator+=(vec3f b)
+	{
+		x += b.x, y += b.y, z += b.z;
+		return *this;
+	}
+
+	constexpr vec3f &operator-=(vec3f b)
+	{
+		x -= b.x, y -= b.y, z -= b.z;
+		return *this;
+	}
+
+	constexpr vec3f &operator*=(float v)
+	{
+		x *= v, y *= v, z *= v;
+		return *this;
+	}
+
+	constexpr vec3f &operator/=(float v)
+	{
+		x /= v, y /= v, z /= v;
+		return *this;
+	}
+};
+
+constexpr vec3f operator+(vec3f a, vec3f b)
+{
+	return {a.x + b.x, a.y + b.y, a.z + b.z};
+}
+
+constexpr vec3f operator-(vec3f a, vec3f b)
+{
+	return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+constexpr vec3f operator-(vec3f a)
+{
+	return {-a.x, -a.y, -a.z};
+}
+
+constexpr vec3f operator*(vec3f a, vec3f b)
+{
+	return {a.x * b.x, a.y * b.y, a.z * b.z};
+}
+
+constexpr vec3f operator*(vec3f a, float v)
+{
+	return {a.x * v, a.y * v, a.z * v};
+}
+
+constexpr vec3f operator*(float v, vec3f a)
+{
+	return {a.x * v, a.y * v, a.z * v};
+}
+
+constexpr vec3f operator/(vec3f a, float v)
+{
+	return {a.x / v, a.y / v, a.z / v};
+}
+
+constexpr bool operator==(vec3f a, vec3f b)
+{
+	return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+constexpr bool operator!=(vec3f a, vec3f b)
+{
+	return !(a == b);
+}
+
+constexpr float dot(vec3f a, vec3f b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+constexpr vec3f cross(vec3f a, vec3f b)
+{
+	return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+constexpr float length_sq(vec3f a)
+{
+	return dot(a, a);
+}
+
+constexpr vec3f lerp(vec3f a, vec3f b, float t)
+{
+	return a + (b - a) * t;
+}
+
+inline float length(vec3f a)
+{
+	return vec3_len(a);
+}
+
+inline vec3f normalize(vec3f a)
+{
+	return vec3_normalize(a);
+}
+
+inline vec3f rotate(vec3f a, vec3f axis, float angle_rad)
+{
+	return vec3_rotate_axis(a, axis, angle_rad);
+}
+
+// ---------------------------------------------------------------------------
+// MATRIX4
+
+// Row major with row vectors like mat4_t, a * b applies a then b and
+// v * m transforms a point
+struct mat4f {
+	float m00, m01, m02, m03;
+	float m10, m11, m12, m13;
+	float m20, m21, m22, m23;
+	float m30, m31, m32, m33;
+
+	// Identity, unlike the zeroed C aggregate
+	constexpr mat4f()
+		: m00(1), m01(0), m02(0), m03(0),
+		  m10(0), m11(1), m12(0), m13(0),
+		  m20(0), m21(0), m22(1), m23(0),
+		  m30(0), m31(0), m32(0), m33(1)
+	{
+	}
+
+	constexpr mat4f(float m00, float m01, float m02, float m03,
+				    float m10, float m11, float m12, float m13,
+				    float m20, float m21, float m22, float m23,
+				    float m30, float m31, float m32, float m33)
+		: m00(m00), m01(m01), m02(m02), m03(m03),
+		  m10(m10), m11(m11), m12(m12), m13(m13),
+		  m20(m20), m21(m21), m22(m22), m23(m23),
+		  m30(m30), m31(m31), m32(m32), m33(m33)
+	{
+	}
+
+	constexpr mat4f(const mat4_t &m)
+		: mat4f(m.m00, m.m01, m.m02, m.m03,
+				m.m10, m.m11, m.m12, m.m13,
+				m.m20, m.m21, m.m22, m.m23,
+				m.m30, m.m31, m.m32, m.m33)
+	{
+	}
+
+	constexpr operator mat4_t() const
+	{
+		return mat4_t{
+			m00, m01, m02, m03,
+			m10, m11, m12, m13,
+			m20, m21, m22, m23,
+			m30, m31, m32, m33,
+		};
+	}
+
+	static constexpr mat4f identity()
+	{
+		return mat4f();
+	}
+
+	static constexpr mat4f translate(vec3f t)
+	{
+		return {
+			1, 0, 0, 0,
+			0, 1, 0, 0,
+			0, 0, 1, 0,
+			t.x, t.y, t.z, 1,
+		};
+	}
+
+	static constexpr mat4f scale(vec3f s)
+	{
+		return {
+			s.x, 0, 0, 0,
+			0, s.y, 0, 0,
+			0, 0, s.z, 0,
+			0, 0, 0, 1,
+		};
+	}
+
+	static inline mat4f rotate(vec3f axis, float angle_rad)
+	{
+		return mat4_rotate_axis(axis, angle_rad);
+	}
+
+	static inline mat4f lookat_lh(vec3f eye, vec3f center, vec3f up)
+	{
+		return mat4_lookat_lh(eye, center, up);
+	}
+
+	static inline mat4f lookat_rh(vec3f eye, vec3f center, vec3f up)
+	{
+		return mat4_lookat_rh(eye, center, up);
+	}
+
+	static inline mat4f perspective(float fov_rad, float aspect, float n, float f)
+	{
+		return mat4_perspective(fov_rad, aspect, n, f);
+	}
+
+	static constexpr mat4f ortho(float left, float right, float bottom, float top, float n, float f)
+	{
+		return {
+			2 / (right - left), 0, 0, 0,
+			0, 2 / (top - bottom), 0, 0,
+			0, 0, -2 / (f - n), 0,
+			-(right + left) / (right - left), -(top + bottom) / (top - bottom), -(f + n) / (f - n), 1,
+		};
+	}
+};
+
+// Row i of a times b
+#define IVY_MATH_HPP_ROW(i)                                                           \
+	a.m##i##0 * b.m00 + a.m##i##1 * b.m10 + a.m##i##2 * b.m20 + a.m##i##3 * b.m30,    \
+		a.m##i##0 * b.m01 + a.m##i##1 * b.m11 + a.m##i##2 * b.m21 + a.m##i##3 * b.m31, \
+		a.m##i##0 * b.m02 + a.m##i##1 * b.m12 + a.m##i##2 * b.m22 + a.m##i##3 * b.m32, \
+		a.m##i##0 * b.m03 + a.m##i##1 * b.m13 + a.m##i##2 * b.m23 + a.m##i##3 * b.m33
+
+constexpr mat4f operator*(const mat4f &a, const mat4f &b)
+{
+	if (IVY_MATH_CONSTEVAL()) {
+		return {IVY_MATH_HPP_ROW(0), IVY_MATH_HPP_ROW(1), IVY_MATH_HPP_ROW(2), IVY_MATH_HPP_ROW(3)};
+	}
+	return mat4_mul(a, b);
+}
+#undef IVY_MATH_HPP_ROW
+
+constexpr mat4f &operator*=(mat4f &a, const mat4f &b)
+{
+	return a = a * b;
+}
+
+// Point transform, like vec3_transform
+constexpr vec3f operator*(vec3f v, const mat4f &m)
+{
+	return {
+		v.x * m.m00 + v.y * m.m10 + v.z * m.m20 + m.m30,
+		v.x * m.m01 + v.y * m.m11 + v.z * m.m21 + m.m31,
+		v.x * m.m02 + v.y * m.m12 + v.z * m.m22 + m.m32,
+	};
+}
+
+constexpr bool operator==(const mat4f &a, const mat4f &b)
+{
+	return a.m00 == b.m00 && a.m01 == b.m01 && a.m02 == b.m02 && a.m03 == b.m03 &&
+		   a.m10 == b.m10 && a.m11 == b.m11 && a.m12 == b.m12 && a.m13 == b.m13 &&
+		   a.m20 == b.m20 && a.m21 == b.m21 && a.m22 == b.m22 && a.m23 == b.m23 &&
+		   a.m30 == b.m30 && a.m31 == b.m31 && a.m32 == b.m32 && a.m33 == b.m33;
+}
+
+constexpr bool operator!=(const mat4f &a, const mat4f &b)
+{
+	return !(a == b);
+}
+
+constexpr mat4f transpose(const mat4f &m)
+{
+	if (IVY_MATH_CONSTEVAL()) {
+		return {
+			m.m00, m.m10, m.m20, m.m30,
+			m.m01, m.m11, m.m21, m.m31,
+			m.m02, m.m12, m.m22, m.m32,
+			m.m03, m.m13, m.m23, m.m33,
+		};
+	}
+	return mat4_transpose(m);
+}
+
+inline mat4f inverse(const mat4f &m)
+{
+	return mat4_inverse(m);
+}
+
+// ---------------------------------------------------------------------------
+// LAYOUT
+
+// Pointers to arrays of either type can be cast to the other
+#define IVY_MATH_HPP_SAME_LAYOUT(cpp, c, last)                              \
+	static_assert(sizeof(cpp) == sizeof(c), #cpp " size differs");          \
+	static_assert(alignof(cpp) == alignof(c), #cpp " alignment differs");   \
+	static_assert(std::is_standard_layout<cpp>::value, #cpp " layout");     \
+	static_assert(std::is_trivially_copyable<cpp>::value, #cpp " copy");    \
+	static_assert(offsetof(cpp, last) == offsetof(c, last), #cpp " offsets");
+IVY_MATH_HPP_SAME_LAYOUT(vec2f, vec2_t, y)
+IVY_MATH_HPP_SAME_LAYOUT(vec3f, vec3_t, z)
+IVY_MATH_HPP_SAME_LAYOUT(mat4f, mat4_t, m33)
+#undef IVY_MATH_HPP_SAME_LAYOUT
+
+// Folding at compile time
+static_assert(vec3f(1, 2, 3) + vec3f(1, 1, 1) * 2.0f == vec3f(3, 4, 5), "vec3f arithmetic");
+static_assert(cross(vec3f(1, 0, 0), vec3f(0, 1, 0)) == vec3f(0, 0, 1), "vec3f cross");
+static_assert(vec3f(1, 2, 3) * (mat4f::scale(vec3f(2, 2, 2)) * mat4f::translate(vec3f(1, 0, 0))) == vec3f(3, 4, 6), "mat4f product");
+static_assert(transpose(mat4f::translate(vec3f(1, 2, 3))).m03 == 1, "mat4f transpose");
+
+} // namespace ivy
+
+#endif // IVY_MATH_HPP
@@ -0,0 +1,731 @@
+#include "ivy.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define IVY_MIX_AVX
+#endif
+
+// Control commands in flight to the render side, must be a power of two
+#ifndef IVY_MIX_COMMANDS
+#define IVY_MIX_COMMANDS 256
+#endif // IVY_MIX_COMMANDS
+
+// Frames over which gain and pan changes and stops are smoothed
+#ifndef IVY_MIX_RAMP_FRAMES
+#define IVY_MIX_RAMP_FRAMES 256
+#endif // IVY_MIX_RAMP_FRAMES
+
+// Frames resampled or downmixed at a time
+#ifndef IVY_MIX_SCRATCH_FRAMES
+#define IVY_MIX_SCRATCH_FRAMES 256
+#endif // IVY_MIX_SCRATCH_FRAMES
+
+// Silence fed to a resampled voice after its clip ends, flushes the
+// frames still held back by the filter
+#define MIX_PADDING_FRAMES 64
+
+static const float _mix_silence[MIX_PADDING_FRAMES * 2];
+
+typedef enum {
+	MIX_CMD_PLAY,
+	MIX_CMD_STOP,
+	MIX_CMD_GAIN,
+	MIX_CMD_PAN,
+	MIX_CMD_PITCH,
+	MIX_CMD_PARAMS,
+	MIX_CMD_DSP,
+} MIX_CMD;
+
+typedef struct {
+	int type;
+	u32_t slot;
+	u16_t generation;
+	int flags;
+	float gain;
+	float pan;
+	float pitch;
+	audio_clip_t clip;
+	audio_resampler_t *resampler;
+	audio_stream_t *stream;
+	audio_dsp_t *dsp;
+} mix_cmd_t;
+
+// Owned by the render side
+typedef struct {
+	const float *samples;
+	size_t frames;
+	size_t pos;
+	unsigned int channels;
+	int flags;
+	u16_t generation;
+	bool_t active;
+	bool_t stopping;
+	float gain_param;
+	float pan_param;
+	// Per output channel gain, ramped linearly towards target
+	float gain[2];
+	float target[2];
+	float step[2];
+	unsigned int ramp;
+	// Set when the clip rate differs from the mixer rate
+	audio_resampler_t *resampler;
+	size_t padding;
+	// Set instead of samples for streamed voices
+	audio_stream_t *stream;
+} mix_voice_t;
+
+// Owned by the control side, the resampler is kept after the voice ends
+// and reused by the next clip at the same rate
+typedef struct {
+	u16_t generation;
+	bool_t in_use;
+	audio_resampler_t *resampler;
+	unsigned int resampler_rate;
+	unsigned int resampler_channels;
+} mix_slot_t;
+
+// Accumulates frames of src into out, frame i of channel c is scaled by
+// gain[c] + step[c] * i
+typedef void (*mix_kernel_t)(float *out, const float *src, size_t frames, unsigned int channels,
+							 const float gain[2], const float step[2]);
+
+struct audio_mixer_t {
+	unsigned int channels;
+	unsigned int sample_rate;
+	unsigned int max_voices;
+	mix_voice_t *voices;
+	mix_slot_t *slots;
+	// Set by the render side once a voice has finished, so the control
+	// side can reuse its slot
+	atomic_bool *done;
+
+	mix_cmd_t commands[IVY_MIX_COMMANDS];
+	atomic_size_t cmd_head;
+	atomic_size_t cmd_tail;
+
+	mix_kernel_t mono_to_stereo;
+	mix_kernel_t madd;
+	// Render side copy of the chain run over the finished mix
+	audio_dsp_t *dsp;
+	float scratch[IVY_MIX_SCRATCH_FRAMES * 2];
+};
+
+// ---------------------------------------------------------------
+// KERNELS
+
+static void _mix_mono_to_stereo_scalar(float *out, const float *src, size_t frames, unsigned int channels,
+									   const float gain[2], const float step[2])
+{
+	(void)channels;
+	for (size_t i = 0; i < frames; i++) {
+		out[i * 2 + 0] += src[i] * (gain[0] + step[0] * (float)i);
+		out[i * 2 + 1] += src[i] * (gain[1] + step[1] * (float)i);
+	}
+}
+
+static void _mix_madd_scalar(float *out, const float *src, size_t frames, unsigned int channels,
+							 const float gain[2], const float step[2])
+{
+	for (size_t i = 0; i < frames; i++) {
+		for (unsigned int c = 0; c < channels; c++) {
+			out[i * channels + c] += src[i * channels + c] * (gain[c] + step[c] * (float)i);
+		}
+	}
+}
+
+// The SIMD kernels run whole vectors then finish the tail with the scalar
+// kernel, starting it at the right frame so the ramp stays continuous
+static void _mix_tail(mix_kernel_t kernel, float *out, const float *src, size_t frames, size_t i,
+					  unsigned int src_channels, unsigned int out_channels, unsigned int channels,
+					  const float gain[2], const float step[2])
+{
+	if (i >= frames) {
+		return;
+	}
+	float g[2] = {gain[0] + step[0] * (float)i, gain[1] + step[1] * (float)i};
+	kernel(out + i * out_channels, src + i * src_channels, frames - i, channels, g, step);
+}
+
+#if defined(__SSE2__)
+static void _mix_mono_to_stereo_sse(float *out, const float *src, size_t frames, unsigned int channels,
+									const float gain[2], const float step[2])
+{
+	const __m128 gl = _mm_set1_ps(gain[0]);
+	const __m128 gr = _mm_set1_ps(gain[1]);
+	const __m128 sl = _mm_set1_ps(step[0]);
+	const __m128 sr = _mm_set1_ps(step[1]);
+	const __m128 inc = _mm_set1_ps(4.0f);
+	__m128 idx = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+	size_t i = 0;
+	for (; i + 4 <= frames; i += 4) {
+		__m128 s = _mm_loadu_ps(src + i);
+		__m128 l = _mm_mul_ps(s, _mm_add_ps(gl, _mm_mul_ps(sl, idx)));
+		__m128 r = _mm_mul_ps(s, _mm_add_ps(gr, _mm_mul_ps(sr, idx)));
+		float *o = out + i * 2;
+		_mm_storeu_ps(o, _mm_add_ps(_mm_loadu_ps(o), _mm_unpacklo_ps(l, r)));
+		_mm_storeu_ps(o + 4, _mm_add_ps(_mm_loadu_ps(o + 4), _mm_unpackhi_ps(l, r)));
+		idx = _mm_add_ps(idx, inc);
+	}
+	_mix_tail(_mix_mono_to_stereo_scalar, out, src, frames, i, 1, 2, channels, gain, step);
+}
+
+static void _mix_madd_sse(float *out, const float *src, size_t frames, unsigned int channels,
+						  const float gain[2], const float step[2])
+{
+	// Lane j holds channel j % channels of frame i + j / channels
+	float g[4], s[4], f[4];
+	for (int j = 0; j < 4; j++) {
+		g[j] = gain[j % channels];
+		s[j] = step[j % channels];
+		f[j] = (float)(j / channels);
+	}
+	const __m128 vg = _mm_loadu_ps(g);
+	const __m128 vs = _mm_loadu_ps(s);
+	const __m128 inc = _mm_set1_ps((float)(4 / channels));
+	__m128 idx = _mm_loadu_ps(f);
+	size_t count = frames * channels;
+	size_t k = 0;
+	for (; k + 4 <= count; k += 4) {
+		__m128 v = _mm_mul_ps(_mm_loadu_ps(src + k), _mm_add_ps(vg, _mm_mul_ps(vs, idx)));
+		_mm_storeu_ps(out + k, _mm_add_ps(_mm_loadu_ps(out + k), v));
+		idx = _mm_add_ps(idx, inc);
+	}
+	_mix_tail(_mix_madd_scalar, out, src, frames, k / channels, channels, channels, channels, gain, step);
+}
+#endif
+
+#if defined(IVY_MIX_AVX)
+__attribute__((target("avx"))) static void _mix_mono_to_stereo_avx(float *out, const float *src, size_t frames,
+																	unsigned int channels, const float gain[2],
+																	const float step[2])
+{
+	const __m256 gl = _mm256_set1_ps(gain[0]);
+	const __m256 gr = _mm256_set1_ps(gain[1]);
+	const __m256 sl = _mm256_set1_ps(step[0]);
+	const __m256 sr = _mm256_set1_ps(step[1]);
+	const __m256 inc = _mm256_set1_ps(8.0f);
+	__m256 idx = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+	size_t i = 0;
+	for (; i + 8 <= frames; i += 8) {
+		__m256 s = _mm256_loadu_ps(src + i);
+		__m256 l = _mm256_mul_ps(s, _mm256_add_ps(gl, _mm256_mul_ps(sl, idx)));
+		__m256 r = _mm256_mul_ps(s, _mm256_add_ps(gr, _mm256_mul_ps(sr, idx)));
+		// unpack works per 128 bit half, so the halves need regrouping
+		__m256 lo = _mm256_unpacklo_ps(l, r);
+		__m256 hi = _mm256_unpackhi_ps(l, r);
+		float *o = out + i * 2;
+		_mm256_storeu_ps(o, _mm256_add_ps(_mm256_loadu_ps(o), _mm256_permute2f128_ps(lo, hi, 0x20)));
+		_mm256_storeu_ps(o + 8, _mm256_add_ps(_mm256_loadu_ps(o + 8), _mm256_permute2f128_ps(lo, hi, 0x31)));
+		idx = _mm256_add_ps(idx, inc);
+	}
+	_mix_tail(_mix_mono_to_stereo_scalar, out, src, frames, i, 1, 2, channels, gain, step);
+}
+
+__attribute__((target("avx"))) static void _mix_madd_avx(float *out, const float *src, size_t frames,
+														  unsigned int channels, const float gain[2],
+														  const float step[2])
+{
+	float g[8], s[8], f[8];
+	for (int j = 0; j < 8; j++) {
+		g[j] = gain[j % channels];
+		s[j] = step[j % channels];
+		f[j] = (float)(j / channels);
+	}
+	const __m256 vg = _mm256_loadu_ps(g);
+	const __m256 vs = _mm256_loadu_ps(s);
+	const __m256 inc = _mm256_set1_ps((float)(8 / channels));
+	__m256 idx = _mm256_loadu_ps(f);
+	size_t count = frames * channels;
+	size_t k = 0;
+	for (; k + 8 <= count; k += 8) {
+		__m256 v = _mm256_mul_ps(_mm256_loadu_ps(src + k), _mm256_add_ps(vg, _mm256_mul_ps(vs, idx)));
+		_mm256_storeu_ps(out + k, _mm256_add_ps(_mm256_loadu_ps(out + k), v));
+		idx = _mm256_add_ps(idx, inc);
+	}
+	_mix_tail(_mix_madd_scalar, out, src, frames, k / channels, channels, channels, channels, gain, step);
+}
+#endif
+
+static void _mix_pick_kernels(audio_mixer_t *mixer)
+{
+	mixer->mono_to_stereo = _mix_mono_to_stereo_scalar;
+	mixer->madd = _mix_madd_scalar;
+#if defined(__SSE2__)
+	mixer->mono_to_stereo = _mix_mono_to_stereo_sse;
+	mixer->madd = _mix_madd_sse;
+#endif
+#if defined(IVY_MIX_AVX)
+	if (__builtin_cpu_supports("avx")) {
+		mixer->mono_to_stereo = _mix_mono_to_stereo_avx;
+		mixer->madd = _mix_madd_avx;
+	}
+#endif
+}
+
+// ---------------------------------------------------------------
+// RENDER SIDE
+
+static void _mix_set_target(audio_mixer_t *mixer, mix_voice_t *v)
+{
+	float gain = v->stopping ? 0.0f : v->gain_param;
+	float pan = fminf(fmaxf(v->pan_param, -1.0f), 1.0f);
+	if (mixer->channels == 1) {
+		v->target[0] = gain;
+		v->target[1] = 0.0f;
+	} else if (v->channels == 1) {
+		// Equal power pan law, centre is -3dB on both sides
+		float angle = (pan + 1.0f) * (float)PI * 0.25f;
+		v->target[0] = gain * cosf(angle);
+		v->target[1] = gain * sinf(angle);
+	} else {
+		// Stereo clips get balance, centre leaves both sides untouched
+		v->target[0] = gain * fminf(1.0f, 1.0f - pan);
+		v->target[1] = gain * fminf(1.0f, 1.0f + pan);
+	}
+	v->ramp = IVY_MIX_RAMP_FRAMES;
+	for (int c = 0; c < 2; c++) {
+		v->step[c] = (v->target[c] - v->gain[c]) / IVY_MIX_RAMP_FRAMES;
+	}
+}
+
+static void _mix_apply_commands(audio_mixer_t *mixer)
+{
+	size_t tail = atomic_load_explicit(&mixer->cmd_tail, memory_order_relaxed);
+	size_t head = atomic_load_explicit(&mixer->cmd_head, memory_order_acquire);
+	for (; tail != head; tail++) {
+		const mix_cmd_t *cmd = &mixer->commands[tail & (IVY_MIX_COMMANDS - 1)];
+		if (cmd->type == MIX_CMD_DSP) {
+			mixer->dsp = cmd->dsp;
+			continue;
+		}
+		mix_voice_t *v = &mixer->voices[cmd->slot];
+		if (cmd->type == MIX_CMD_PLAY) {
+			*v = (mix_voice_t){
+				.samples = cmd->clip.samples,
+				.frames = cmd->clip.frames,
+				.channels = cmd->clip.channels,
+				.flags = cmd->flags,
+				.generation = cmd->generation,
+				.active = 1,
+				.gain_param = cmd->gain,
+				.pan_param = cmd->pan,
+				.resampler = cmd->resampler,
+				.stream = cmd->stream,
+			};
+			// Starts at full gain so attacks are not softened
+			_mix_set_target(mixer, v);
+			v->gain[0] = v->target[0];
+			v->gain[1] = v->target[1];
+			v->step[0] = v->step[1] = 0.0f;
+			v->ramp = 0;
+			continue;
+		}
+		if (!v->active || v->generation != cmd->generation || v->stopping) {
+			continue;
+		}
+		switch (cmd->type) {
+		case MIX_CMD_STOP: v->stopping = 1; break;
+		case MIX_CMD_GAIN: v->gain_param = cmd->gain; break;
+		case MIX_CMD_PAN: v->pan_param = cmd->pan; break;
+		case MIX_CMD_PARAMS:
+			v->gain_param = cmd->gain;
+			v->pan_param = cmd->pan;
+			break;
+		}
+		// Voices without a resampler play at their own rate only
+		if ((cmd->type == MIX_CMD_PITCH || cmd->type == MIX_CMD_PARAMS) && v->resampler) {
+			audio_resampler_set_pitch(v->resampler, cmd->pitch);
+		}
+		_mix_set_target(mixer, v);
+	}
+	atomic_store_explicit(&mixer->cmd_tail, tail, memory_order_release);
+}
+
+static void _mix_finish(audio_mixer_t *mixer, unsigned int slot)
+{
+	mixer->voices[slot].active = 0;
+	atomic_store_explicit(&mixer->done[slot], 1, memory_order_release);
+}
+
+static void _mix_advance_ramp(mix_voice_t *v, size_t frames)
+{
+	if (!v->ramp) {
+		return;
+	}
+	v->ramp -= frames;
+	if (v->ramp) {
+		v->gain[0] += v->step[0] * (float)frames;
+		v->gain[1] += v->step[1] * (float)frames;
+	} else {
+		v->gain[0] = v->target[0];
+		v->gain[1] = v->target[1];
+		v->step[0] = v->step[1] = 0.0f;
+	}
+}
+
+// Points src at up to frames frames of the voice at the mixer rate in the
+// clip channel layout, returns 0 once the voice has nothing left to play
+static size_t _mix_fetch(audio_mixer_t *mixer, mix_voice_t *v, size_t frames, const float **src)
+{
+	if (v->stream) {
+		if (frames > IVY_MIX_SCRATCH_FRAMES) {
+			frames = IVY_MIX_SCRATCH_FRAMES;
+		}
+		size_t got = audio_stream_read(v->stream, mixer->scratch, frames);
+		if (!got && audio_stream_finished(v->stream)) {
+			return 0;
+		}
+		// The decoder fell behind, fill the gap with silence
+		memset(mixer->scratch + got * v->channels, 0, (frames - got) * v->channels * sizeof(float));
+		*src = mixer->scratch;
+		return frames;
+	}
+	if (!v->resampler) {
+		if (v->pos == v->frames) {
+			if (!(v->flags & IVY_AUDIO_VOICE_LOOP)) {
+				return 0;
+			}
+			v->pos = 0;
+		}
+		size_t n = v->frames - v->pos < frames ? v->frames - v->pos : frames;
+		*src = v->samples + v->pos * v->channels;
+		v->pos += n;
+		return n;
+	}
+
+	size_t got = 0;
+	if (frames > IVY_MIX_SCRATCH_FRAMES) {
+		frames = IVY_MIX_SCRATCH_FRAMES;
+	}
+	while (got < frames) {
+		const float *in;
+		size_t avail;
+		bool_t silence = 0;
+		if (v->pos < v->frames) {
+			in = v->samples + v->pos * v->channels;
+			avail = v->frames - v->pos;
+		} else if (v->flags & IVY_AUDIO_VOICE_LOOP) {
+			v->pos = 0;
+			continue;
+		} else if (v->padding < MIX_PADDING_FRAMES) {
+			in = _mix_silence;
+			avail = MIX_PADDING_FRAMES - v->padding;
+			silence = 1;
+		} else {
+			break;
+		}
+		size_t used = avail;
+		got += audio_resampler_process(v->resampler, in, &used, mixer->scratch + got * v->channels, frames - got);
+		if (silence) {
+			v->padding += used;
+		} else {
+			v->pos += used;
+		}
+	}
+	*src = mixer->scratch;
+	return got;
+}
+
+static void _mix_voice(audio_mixer_t *mixer, unsigned int slot, float *out, size_t frames)
+{
+	mix_voice_t *v = &mixer->voices[slot];
+	bool_t downmix = v->channels == 2 && mixer->channels == 1;
+	size_t done = 0;
+	while (done < frames) {
+		size_t want = frames - done;
+		// Split where the ramp ends so each kernel call sees one slope
+		if (v->ramp && want > v->ramp) {
+			want = v->ramp;
+		}
+		if (downmix && want > IVY_MIX_SCRATCH_FRAMES) {
+			want = IVY_MIX_SCRATCH_FRAMES;
+		}
+		const float *src;
+		size_t n = _mix_fetch(mixer, v, want, &src);
+		if (!n) {
+			_mix_finish(mixer, slot);
+			return;
+		}
+
+		float *dst = out + done * mixer->channels;
+		if (v->channels == 1 && mixer->channels == 2) {
+			mixer->mono_to_stereo(dst, src, n, 2, v->gain, v->step);
+		} else if (downmix) {
+			// In place is fine when src is the scratch buffer, i <= i * 2
+			for (size_t i = 0; i < n; i++) {
+				mixer->scratch[i] = (src[i * 2] + src[i * 2 + 1]) * 0.5f;
+			}
+			mixer->madd(dst, mixer->scratch, n, 1, v->gain, v->step);
+		} else {
+			mixer->madd(dst, src, n, mixer->channels, v->gain, v->step);
+		}
+
+		_mix_advance_ramp(v, n);
+		done += n;
+		if (v->stopping && !v->ramp) {
+			_mix_finish(mixer, slot);
+			return;
+		}
+	}
+}
+
+void audio_mixer_render(audio_mixer_t *mixer, float *out, size_t frames)
+{
+	_mix_apply_commands(mixer);
+	memset(out, 0, frames * mixer->channels * sizeof(float));
+	for (unsigned int i = 0; i < mixer->max_voices; i++) {
+		if (mixer->voices[i].active) {
+			_mix_voice(mixer, i, out, frames);
+		}
+	}
+	if (mixer->dsp) {
+		audio_dsp_process(mixer->dsp, out, frames);
+	}
+}
+
+void audio_mixer_callback(audio_device_t *audio, float *buf, size_t frames, void *mixer)
+{
+	(void)audio;
+	audio_mixer_render(mixer, buf, frames);
+}
+
+// ---------------------------------------------------------------
+// CONTROL SIDE
+
+audio_mixer_t *audio_mixer_create(unsigned int max_voices, unsigned int channels, unsigned int sample_rate)
+{
+	if (channels != 1 && channels != 2) {
+		WARN("IVY AUDIO: Mixer supports mono or stereo output, got %u channels", channels);
+		return NULL;
+	}
+	if (!max_voices || max_voices > 0xffff) {
+		WARN("IVY AUDIO: Mixer voice count must be between 1 and 65535");
+		return NULL;
+	}
+	audio_mixer_t *mixer = IVY_CALLOC(1, sizeof(audio_mixer_t));
+	if (!mixer) {
+		WARN("IVY AUDIO: Unable to allocate mixer");
+		return NULL;
+	}
+	mixer->channels = channels;
+	mixer->sample_rate = sample_rate;
+	mixer->max_voices = max_voices;
+	mixer->voices = IVY_CALLOC(max_voices, sizeof(mix_voice_t));
+	mixer->slots = IVY_CALLOC(max_voices, sizeof(mix_slot_t));
+	mixer->done = IVY_CALLOC(max_voices, sizeof(atomic_bool));
+	if (!mixer->voices || !mixer->slots || !mixer->done) {
+		WARN("IVY AUDIO: Unable to allocate mixer voices");
+		audio_mixer_destroy(mixer);
+		return NULL;
+	}
+	_mix_pick_kernels(mixer);
+	return mixer;
+}
+
+void audio_mixer_destroy(audio_mixer_t *mixer)
+{
+	if (mixer) {
+		for (unsigned int i = 0; mixer->slots && i < mixer->max_voices; i++) {
+			audio_resampler_destroy(mixer->slots[i].resampler);
+		}
+		IVY_FREE(mixer->voices);
+		IVY_FREE(mixer->slots);
+		IVY_FREE(mixer->done);
+		IVY_FREE(mixer);
+	}
+}
+
+static bool_t _mix_push(audio_mixer_t *mixer, const mix_cmd_t *cmd)
+{
+	size_t head = atomic_load_explicit(&mixer->cmd_head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&mixer->cmd_tail, memory_order_acquire);
+	if (head - tail == IVY_MIX_COMMANDS) {
+		WARN("IVY AUDIO: Mixer command queue full, dropping command");
+		return 0;
+	}
+	mixer->commands[head & (IVY_MIX_COMMANDS - 1)] = *cmd;
+	atomic_store_explicit(&mixer->cmd_head, head + 1, memory_order_release);
+	return 1;
+}
+
+// Returns the slot of a live voice, or -1 for stale and invalid handles
+static int _mix_slot(audio_mixer_t *mixer, audio_voice_t voice)
+{
+	u32_t slot = voice & 0xffff;
+	if (!voice || slot >= mixer->max_voices || !mixer->slots[slot].in_use || mixer->slots[slot].generation != voice >> 16 ||
+		atomic_load_explicit(&mixer->done[slot], memory_order_acquire)) {
+		return -1;
+	}
+	return slot;
+}
+
+static int _mix_free_slot(audio_mixer_t *mixer)
+{
+	for (u32_t slot = 0; slot < mixer->max_voices; slot++) {
+		if (!mixer->slots[slot].in_use || atomic_load_explicit(&mixer->done[slot], memory_order_acquire)) {
+			return slot;
+		}
+	}
+	return -1;
+}
+
+// Queues the play command for slot and hands out its new handle
+static audio_voice_t _mix_start(audio_mixer_t *mixer, int slot, mix_cmd_t *cmd)
+{
+	mix_slot_t *s = &mixer->slots[slot];
+	// Generation 0 is skipped so a handle is never 0
+	u16_t generation = s->generation + 1;
+	if (!generation) {
+		generation = 1;
+	}
+	cmd->type = MIX_CMD_PLAY;
+	cmd->slot = slot;
+	cmd->generation = generation;
+	// Cleared before queueing, the render side may finish a short clip
+	// before this returns
+	atomic_store_explicit(&mixer->done[slot], 0, memory_order_relaxed);
+	if (!_mix_push(mixer, cmd)) {
+		s->in_use = 0;
+		return 0;
+	}
+	s->generation = generation;
+	s->in_use = 1;
+	return ((u32_t)generation << 16) | slot;
+}
+
+audio_voice_t audio_mixer_play(audio_mixer_t *mixer, const audio_clip_t *clip, float gain, float pan, int flags)
+{
+	if (!clip->frames || (clip->channels != 1 && clip->channels != 2)) {
+		WARN("IVY AUDIO: Mixer plays non empty mono or stereo clips only");
+		return 0;
+	}
+	int slot = _mix_free_slot(mixer);
+	if (slot < 0) {
+		return 0;
+	}
+	mix_slot_t *s = &mixer->slots[slot];
+	// The render side is done with the slot, so its resampler is free
+	audio_resampler_t *resampler = NULL;
+	unsigned int rate = clip->sample_rate ? clip->sample_rate : mixer->sample_rate;
+	if (rate != mixer->sample_rate || (flags & IVY_AUDIO_VOICE_PITCH)) {
+		if (s->resampler && s->resampler_rate == rate && s->resampler_channels == clip->channels) {
+			audio_resampler_reset(s->resampler);
+			audio_resampler_set_pitch(s->resampler, 1.0f);
+		} else {
+			audio_resampler_destroy(s->resampler);
+			s->resampler = audio_resampler_create(clip->channels, rate, mixer->sample_rate);
+			s->resampler_rate = rate;
+			s->resampler_channels = clip->channels;
+			if (!s->resampler) {
+				return 0;
+			}
+		}
+		resampler = s->resampler;
+	}
+	mix_cmd_t cmd = {
+		.flags = flags,
+		.gain = gain,
+		.pan = pan,
+		.clip = *clip,
+		.resampler = resampler,
+	};
+	return _mix_start(mixer, slot, &cmd);
+}
+
+audio_voice_t audio_mixer_play_stream(audio_mixer_t *mixer, audio_stream_t *stream, float gain, float pan)
+{
+	if (!stream->native || (stream->channels != 1 && stream->channels != 2)) {
+		WARN("IVY AUDIO: Mixer plays open mono or stereo streams only");
+		return 0;
+	}
+	if (stream->sample_rate != mixer->sample_rate) {
+		WARN("IVY AUDIO: Stream rate %u does not match mixer rate %u", stream->sample_rate, mixer->sample_rate);
+		return 0;
+	}
+	int slot = _mix_free_slot(mixer);
+	if (slot < 0) {
+		return 0;
+	}
+	mix_cmd_t cmd = {
+		.gain = gain,
+		.pan = pan,
+		.clip = {.channels = stream->channels, .sample_rate = stream->sample_rate},
+		.stream = stream,
+	};
+	return _mix_start(mixer, slot, &cmd);
+}
+
+static void _mix_control(audio_mixer_t *mixer, audio_voice_t voice, int type, float value)
+{
+	int slot = _mix_slot(mixer, voice);
+	if (slot < 0) {
+		return;
+	}
+	mix_cmd_t cmd = {
+		.type = type,
+		.slot = slot,
+		.generation = voice >> 16,
+		.gain = value,
+		.pan = value,
+		.pitch = value,
+	};
+	_mix_push(mixer, &cmd);
+}
+
+void audio_mixer_stop(audio_mixer_t *mixer, audio_voice_t voice)
+{
+	_mix_control(mixer, voice, MIX_CMD_STOP, 0.0f);
+}
+
+void audio_mixer_set_gain(audio_mixer_t *mixer, audio_voice_t voice, float gain)
+{
+	_mix_control(mixer, voice, MIX_CMD_GAIN, gain);
+}
+
+void audio_mixer_set_pan(audio_mixer_t *mixer, audio_voice_t voice, float pan)
+{
+	_mix_control(mixer, voice, MIX_CMD_PAN, pan);
+}
+
+void audio_mixer_set_pitch(audio_mixer_t *mixer, audio_voice_t voice, float pitch)
+{
+	_mix_control(mixer, voice, MIX_CMD_PITCH, pitch);
+}
+
+void audio_mixer_set_params(audio_mixer_t *mixer, audio_voice_t voice, float gain, float pan, float pitch)
+{
+	int slot = _mix_slot(mixer, voice);
+	if (slot < 0) {
+		return;
+	}
+	mix_cmd_t cmd = {
+		.type = MIX_CMD_PARAMS,
+		.slot = slot,
+		.generation = voice >> 16,
+		.gain = gain,
+		.pan = pan,
+		.pitch = pitch,
+	};
+	_mix_push(mixer, &cmd);
+}
+
+void audio_mixer_set_dsp(audio_mixer_t *mixer, audio_dsp_t *dsp)
+{
+	mix_cmd_t cmd = {
+		.type = MIX_CMD_DSP,
+		.dsp = dsp,
+	};
+	_mix_push(mixer, &cmd);
+}
+
+bool_t audio_mixer_playing(audio_mixer_t *mixer, audio_voice_t voice)
+{
+	return _mix_slot(mixer, voice) >= 0;
+}
@@ -0,0 +1,289 @@
+#include "ivy.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define IVY_RESAMPLE_AVX
+#endif
+
+// Filter length in input frames, must be a multiple of 8
+#ifndef IVY_RESAMPLE_TAPS
+#define IVY_RESAMPLE_TAPS 32
+#endif // IVY_RESAMPLE_TAPS
+
+// Sub-sample positions in the filter bank, positions in between are
+// linearly interpolated from the two nearest phases
+#ifndef IVY_RESAMPLE_PHASES
+#define IVY_RESAMPLE_PHASES 128
+#endif // IVY_RESAMPLE_PHASES
+
+// Input frames buffered per refill on top of the filter history
+#ifndef IVY_RESAMPLE_BLOCK
+#define IVY_RESAMPLE_BLOCK 256
+#endif // IVY_RESAMPLE_BLOCK
+
+// Kaiser window shape, 8 gives roughly 80dB of stopband attenuation
+#define RESAMPLE_KAISER_BETA 8.0
+// Fraction of the output nyquist kept, the rest is the transition band
+#define RESAMPLE_PASSBAND 0.91
+
+#define RESAMPLE_HALF (IVY_RESAMPLE_TAPS / 2)
+#define RESAMPLE_ONE ((u64_t)1 << 32)
+
+typedef void (*resample_kernel_t)(audio_resampler_t *rs, size_t i, u32_t frac, float *out);
+
+struct audio_resampler_t {
+	unsigned int channels;
+	unsigned int in_rate;
+	unsigned int out_rate;
+	// Input frames per output frame in 32.32 fixed point
+	u64_t step;
+	// Position of the first filter tap in history, 32.32 fixed point
+	u64_t pos;
+	size_t filled;
+	size_t capacity;
+	// Planar, capacity frames per channel
+	float *history;
+	// IVY_RESAMPLE_PHASES + 1 rows of IVY_RESAMPLE_TAPS coefficients
+	float *bank;
+	resample_kernel_t kernel;
+};
+
+// ---------------------------------------------------------------
+// FILTER DESIGN
+
+// Zeroth order modified bessel function, the series converges quickly
+// for the arguments a kaiser window needs
+static double _resample_bessel_i0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	for (int k = 1; k < 32; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if (term < sum * 1e-12) {
+			break;
+		}
+	}
+	return sum;
+}
+
+// Row p holds the taps for an output p / PHASES of a frame past the
+// centre tap, each row is normalized to unity gain at DC
+static void _resample_build_bank(float *bank, double cutoff)
+{
+	double norm = _resample_bessel_i0(RESAMPLE_KAISER_BETA);
+	for (int p = 0; p <= IVY_RESAMPLE_PHASES; p++) {
+		float *row = bank + p * IVY_RESAMPLE_TAPS;
+		double sum = 0.0;
+		for (int k = 0; k < IVY_RESAMPLE_TAPS; k++) {
+			double d = k - (RESAMPLE_HALF - 1) - (double)p / IVY_RESAMPLE_PHASES;
+			double x = d / RESAMPLE_HALF;
+			double w = fabs(x) < 1.0 ? _resample_bessel_i0(RESAMPLE_KAISER_BETA * sqrt(1.0 - x * x)) / norm : 0.0;
+			double s = d == 0.0 ? 1.0 : sin(PI * cutoff * d) / (PI * cutoff * d);
+			row[k] = (float)(w * s);
+			sum += row[k];
+		}
+		for (int k = 0; k < IVY_RESAMPLE_TAPS; k++) {
+			row[k] = (float)(row[k] / sum);
+		}
+	}
+}
+
+// ---------------------------------------------------------------
+// KERNELS
+
+// Each kernel interpolates the taps between the two nearest phases and
+// runs them over every channel of history starting at frame i
+static void _resample_frame_scalar(audio_resampler_t *rs, size_t i, u32_t frac, float *out)
+{
+	u64_t fp = (u64_t)frac * IVY_RESAMPLE_PHASES;
+	const float *h0 = rs->bank + (fp >> 32) * IVY_RESAMPLE_TAPS;
+	const float *h1 = h0 + IVY_RESAMPLE_TAPS;
+	float t = (float)(u32_t)fp * (1.0f / 4294967296.0f);
+	float h[IVY_RESAMPLE_TAPS];
+	for (int k = 0; k < IVY_RESAMPLE_TAPS; k++) {
+		h[k] = h0[k] + (h1[k] - h0[k]) * t;
+	}
+	for (unsigned int c = 0; c < rs->channels; c++) {
+		const float *x = rs->history + c * rs->capacity + i;
+		float sum = 0.0f;
+		for (int k = 0; k < IVY_RESAMPLE_TAPS; k++) {
+			sum += h[k] * x[k];
+		}
+		out[c] = sum;
+	}
+}
+
+#if defined(__SSE2__)
+static void _resample_frame_sse(audio_resampler_t *rs, size_t i, u32_t frac, float *out)
+{
+	u64_t fp = (u64_t)frac * IVY_RESAMPLE_PHASES;
+	const float *h0 = rs->bank + (fp >> 32) * IVY_RESAMPLE_TAPS;
+	const float *h1 = h0 + IVY_RESAMPLE_TAPS;
+	const __m128 t = _mm_set1_ps((float)(u32_t)fp * (1.0f / 4294967296.0f));
+	__m128 h[IVY_RESAMPLE_TAPS / 4];
+	for (int k = 0; k < IVY_RESAMPLE_TAPS / 4; k++) {
+		__m128 a = _mm_loadu_ps(h0 + k * 4);
+		h[k] = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(h1 + k * 4), a), t));
+	}
+	for (unsigned int c = 0; c < rs->channels; c++) {
+		const float *x = rs->history + c * rs->capacity + i;
+		__m128 sum = _mm_setzero_ps();
+		for (int k = 0; k < IVY_RESAMPLE_TAPS / 4; k++) {
+			sum = _mm_add_ps(sum, _mm_mul_ps(h[k], _mm_loadu_ps(x + k * 4)));
+		}
+		sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(2, 3, 0, 1)));
+		out[c] = _mm_cvtss_f32(sum);
+	}
+}
+#endif
+
+#if defined(IVY_RESAMPLE_AVX)
+__attribute__((target("avx"))) static void _resample_frame_avx(audio_resampler_t *rs, size_t i, u32_t frac,
+																float *out)
+{
+	u64_t fp = (u64_t)frac * IVY_RESAMPLE_PHASES;
+	const float *h0 = rs->bank + (fp >> 32) * IVY_RESAMPLE_TAPS;
+	const float *h1 = h0 + IVY_RESAMPLE_TAPS;
+	const __m256 t = _mm256_set1_ps((float)(u32_t)fp * (1.0f / 4294967296.0f));
+	__m256 h[IVY_RESAMPLE_TAPS / 8];
+	for (int k = 0; k < IVY_RESAMPLE_TAPS / 8; k++) {
+		__m256 a = _mm256_loadu_ps(h0 + k * 8);
+		h[k] = _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(h1 + k * 8), a), t));
+	}
+	for (unsigned int c = 0; c < rs->channels; c++) {
+		const float *x = rs->history + c * rs->capacity + i;
+		__m256 sum = _mm256_setzero_ps();
+		for (int k = 0; k < IVY_RESAMPLE_TAPS / 8; k++) {
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(h[k], _mm256_loadu_ps(x + k * 8)));
+		}
+		__m128 s = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+		s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+		s = _mm_add_ss(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(2, 3, 0, 1)));
+		out[c] = _mm_cvtss_f32(s);
+	}
+}
+#endif
+
+// ---------------------------------------------------------------
+// STREAMING
+
+audio_resampler_t *audio_resampler_create(unsigned int channels, unsigned int in_rate, unsigned int out_rate)
+{
+	if (!channels || !in_rate || !out_rate) {
+		WARN("IVY AUDIO: Resampler needs non zero channels and rates");
+		return NULL;
+	}
+	audio_resampler_t *rs = IVY_CALLOC(1, sizeof(audio_resampler_t));
+	if (!rs) {
+		WARN("IVY AUDIO: Unable to allocate resampler");
+		return NULL;
+	}
+	rs->channels = channels;
+	rs->in_rate = in_rate;
+	rs->out_rate = out_rate;
+	rs->capacity = IVY_RESAMPLE_TAPS + IVY_RESAMPLE_BLOCK;
+	rs->history = IVY_CALLOC(rs->capacity * channels, sizeof(float));
+	rs->bank = IVY_MALLOC((IVY_RESAMPLE_PHASES + 1) * IVY_RESAMPLE_TAPS * sizeof(float));
+	if (!rs->history || !rs->bank) {
+		WARN("IVY AUDIO: Unable to allocate resampler");
+		audio_resampler_destroy(rs);
+		return NULL;
+	}
+	// Downsampling moves the cutoff below the output nyquist
+	double cutoff = out_rate < in_rate ? (double)out_rate / in_rate : 1.0;
+	_resample_build_bank(rs->bank, cutoff * RESAMPLE_PASSBAND);
+
+	rs->kernel = _resample_frame_scalar;
+#if defined(__SSE2__)
+	rs->kernel = _resample_frame_sse;
+#endif
+#if defined(IVY_RESAMPLE_AVX)
+	if (__builtin_cpu_supports("avx")) {
+		rs->kernel = _resample_frame_avx;
+	}
+#endif
+	audio_resampler_set_pitch(rs, 1.0f);
+	audio_resampler_reset(rs);
+	return rs;
+}
+
+void audio_resampler_destroy(audio_resampler_t *rs)
+{
+	if (rs) {
+		IVY_FREE(rs->history);
+		IVY_FREE(rs->bank);
+		IVY_FREE(rs);
+	}
+}
+
+void audio_resampler_reset(audio_resampler_t *rs)
+{
+	// Half a filter of silence in front centres the first output on the
+	// first input frame, so the stream is not delayed
+	rs->filled = RESAMPLE_HALF - 1;
+	rs->pos = 0;
+	memset(rs->history, 0, rs->capacity * rs->channels * sizeof(float));
+}
+
+void audio_resampler_set_pitch(audio_resampler_t *rs, float pitch)
+{
+	double step = (double)rs->in_rate / rs->out_rate * pitch;
+	// Keeps at least one output per refill and a non stalling stream
+	step = fmin(fmax(step, 1.0 / 65536.0), (double)IVY_RESAMPLE_BLOCK);
+	rs->step = (u64_t)(step * RESAMPLE_ONE);
+}
+
+// Drops history the filter has moved past and appends up to frames frames
+static size_t _resample_refill(audio_resampler_t *rs, const float *in, size_t frames)
+{
+	size_t drop = rs->pos >> 32;
+	if (drop > rs->filled) {
+		drop = rs->filled;
+	}
+	rs->pos -= (u64_t)drop << 32;
+	rs->filled -= drop;
+	size_t n = rs->capacity - rs->filled;
+	if (n > frames) {
+		n = frames;
+	}
+	for (unsigned int c = 0; c < rs->channels; c++) {
+		float *h = rs->history + c * rs->capacity;
+		memmove(h, h + drop, rs->filled * sizeof(float));
+		for (size_t i = 0; i < n; i++) {
+			h[rs->filled + i] = in[i * rs->channels + c];
+		}
+	}
+	rs->filled += n;
+	return n;
+}
+
+size_t audio_resampler_process(audio_resampler_t *rs, const float *in, size_t *in_frames, float *out,
+							   size_t out_frames)
+{
+	size_t consumed = 0;
+	size_t written = 0;
+	for (;;) {
+		while (written < out_frames) {
+			size_t i = rs->pos >> 32;
+			if (i + IVY_RESAMPLE_TAPS > rs->filled) {
+				break;
+			}
+			rs->kernel(rs, i, (u32_t)rs->pos, out + written * rs->channels);
+			rs->pos += rs->step;
+			written++;
+		}
+		if (written == out_frames || consumed == *in_frames) {
+			break;
+		}
+		consumed += _resample_refill(rs, in + consumed * rs->channels, *in_frames - consumed);
+	}
+	*in_frames = consumed;
+	return written;
+}
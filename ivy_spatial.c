@@ -0,0 +1,250 @@
+#include "ivy.h"
+#include "ivy_math.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define SPATIAL_LANES 4
+
+// Radial speeds are kept under this fraction of the speed of sound, a
+// source at the speed of sound would need an infinite pitch
+#define SPATIAL_MAX_RADIAL 0.5f
+#define SPATIAL_MIN_PITCH 0.5f
+#define SPATIAL_MAX_PITCH 2.0f
+
+// Changes smaller than this are not sent to the mixer
+#define SPATIAL_THRESHOLD 0.0005f
+
+// Sources are stored as parallel arrays so 4 are computed per vector
+typedef struct {
+	float *x, *y, *z;
+	float *vx, *vy, *vz;
+	float *gain;
+	float *ref;
+	float *max;
+	// Results of the last update
+	float *out_gain;
+	float *out_pan;
+	float *out_pitch;
+} spatial_sources_t;
+
+struct audio_spatializer_t {
+	audio_mixer_t *mixer;
+	unsigned int max_sources;
+	// One past the highest source in use, updates stop there
+	unsigned int count;
+	audio_voice_t *voices;
+	// Last values sent to the mixer per source
+	float *sent;
+	spatial_sources_t src;
+	float *memory;
+
+	// Listener position and right axis in world space
+	vec3_t eye;
+	vec3_t right;
+	vec3_t velocity;
+	float speed_of_sound;
+};
+
+// ---------------------------------------------------------------
+// BATCH
+
+#if defined(__SSE2__)
+static void _spatial_compute(audio_spatializer_t *sp, unsigned int count)
+{
+	const spatial_sources_t *s = &sp->src;
+	const __m128 ex = _mm_set1_ps(sp->eye.x), ey = _mm_set1_ps(sp->eye.y), ez = _mm_set1_ps(sp->eye.z);
+	const __m128 rx = _mm_set1_ps(sp->right.x), ry = _mm_set1_ps(sp->right.y), rz = _mm_set1_ps(sp->right.z);
+	const __m128 lvx = _mm_set1_ps(sp->velocity.x), lvy = _mm_set1_ps(sp->velocity.y), lvz = _mm_set1_ps(sp->velocity.z);
+	const __m128 c = _mm_set1_ps(sp->speed_of_sound);
+	const __m128 vmax = _mm_set1_ps(sp->speed_of_sound * SPATIAL_MAX_RADIAL);
+	const __m128 vmin = _mm_sub_ps(_mm_setzero_ps(), vmax);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 tiny = _mm_set1_ps(1e-12f);
+	const __m128 pitch_min = _mm_set1_ps(SPATIAL_MIN_PITCH);
+	const __m128 pitch_max = _mm_set1_ps(SPATIAL_MAX_PITCH);
+	for (unsigned int i = 0; i < count; i += SPATIAL_LANES) {
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(s->x + i), ex);
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(s->y + i), ey);
+		__m128 dz = _mm_sub_ps(_mm_loadu_ps(s->z + i), ez);
+		__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		__m128 d = _mm_sqrt_ps(_mm_max_ps(d2, tiny));
+		__m128 inv = _mm_div_ps(one, d);
+
+		// Sine of the azimuth, no trig needed
+		__m128 lx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, rx), _mm_mul_ps(dy, ry)), _mm_mul_ps(dz, rz));
+		__m128 pan = _mm_min_ps(_mm_max_ps(_mm_mul_ps(lx, inv), _mm_sub_ps(_mm_setzero_ps(), one)), one);
+
+		__m128 ref = _mm_loadu_ps(s->ref + i);
+		__m128 dc = _mm_min_ps(_mm_max_ps(d, ref), _mm_loadu_ps(s->max + i));
+		__m128 gain = _mm_div_ps(_mm_mul_ps(_mm_loadu_ps(s->gain + i), ref), dc);
+
+		// Speeds along the line from the listener to the source
+		__m128 vs = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(s->vx + i), dx), _mm_mul_ps(_mm_loadu_ps(s->vy + i), dy)),
+							   _mm_mul_ps(_mm_loadu_ps(s->vz + i), dz));
+		__m128 vl = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lvx, dx), _mm_mul_ps(lvy, dy)), _mm_mul_ps(lvz, dz));
+		vs = _mm_min_ps(_mm_max_ps(_mm_mul_ps(vs, inv), vmin), vmax);
+		vl = _mm_min_ps(_mm_max_ps(_mm_mul_ps(vl, inv), vmin), vmax);
+		__m128 pitch = _mm_div_ps(_mm_add_ps(c, vl), _mm_add_ps(c, vs));
+		pitch = _mm_min_ps(_mm_max_ps(pitch, pitch_min), pitch_max);
+
+		_mm_storeu_ps(s->out_gain + i, gain);
+		_mm_storeu_ps(s->out_pan + i, pan);
+		_mm_storeu_ps(s->out_pitch + i, pitch);
+	}
+}
+#else
+static void _spatial_compute(audio_spatializer_t *sp, unsigned int count)
+{
+	const spatial_sources_t *s = &sp->src;
+	float c = sp->speed_of_sound;
+	float vmax = c * SPATIAL_MAX_RADIAL;
+	for (unsigned int i = 0; i < count; i++) {
+		vec3_t rel = vec3_sub(vec3(s->x[i], s->y[i], s->z[i]), sp->eye);
+		float d = sqrtf(fmaxf(vec3_lensq(rel), 1e-12f));
+		float inv = 1.0f / d;
+		s->out_pan[i] = fclamp(vec3_dot(rel, sp->right) * inv, -1.0f, 1.0f);
+		s->out_gain[i] = s->gain[i] * s->ref[i] / fminf(fmaxf(d, s->ref[i]), s->max[i]);
+		float vs = fclamp(vec3_dot(vec3(s->vx[i], s->vy[i], s->vz[i]), rel) * inv, -vmax, vmax);
+		float vl = fclamp(vec3_dot(sp->velocity, rel) * inv, -vmax, vmax);
+		s->out_pitch[i] = fclamp((c + vl) / (c + vs), SPATIAL_MIN_PITCH, SPATIAL_MAX_PITCH);
+	}
+}
+#endif
+
+void audio_spatializer_update(audio_spatializer_t *sp)
+{
+	// Arrays are padded to whole vectors, spare lanes compute garbage
+	// that is never sent
+	unsigned int count = (sp->count + SPATIAL_LANES - 1) & ~(SPATIAL_LANES - 1);
+	_spatial_compute(sp, count);
+	const spatial_sources_t *s = &sp->src;
+	for (unsigned int i = 0; i < sp->count; i++) {
+		if (!sp->voices[i]) {
+			continue;
+		}
+		float *sent = &sp->sent[i * 3];
+		float gain = s->out_gain[i], pan = s->out_pan[i];
+		float pitch = sp->speed_of_sound > 0.0f ? s->out_pitch[i] : 1.0f;
+		if (fabsf(gain - sent[0]) > SPATIAL_THRESHOLD || fabsf(pan - sent[1]) > SPATIAL_THRESHOLD ||
+			fabsf(pitch - sent[2]) > SPATIAL_THRESHOLD) {
+			audio_mixer_set_params(sp->mixer, sp->voices[i], gain, pan, pitch);
+			sent[0] = gain, sent[1] = pan, sent[2] = pitch;
+		}
+	}
+}
+
+// ---------------------------------------------------------------
+// CONTROL
+
+audio_spatializer_t *audio_spatializer_create(audio_mixer_t *mixer, unsigned int max_sources)
+{
+	if (!max_sources) {
+		WARN("IVY AUDIO: Spatializer needs at least one source");
+		return NULL;
+	}
+	audio_spatializer_t *sp = IVY_CALLOC(1, sizeof(audio_spatializer_t));
+	if (!sp) {
+		WARN("IVY AUDIO: Unable to allocate spatializer");
+		return NULL;
+	}
+	sp->mixer = mixer;
+	sp->max_sources = max_sources;
+	size_t padded = (max_sources + SPATIAL_LANES - 1) & ~(SPATIAL_LANES - 1);
+	sp->voices = IVY_CALLOC(max_sources, sizeof(audio_voice_t));
+	sp->sent = IVY_CALLOC(max_sources * 3, sizeof(float));
+	sp->memory = IVY_CALLOC(padded * 12, sizeof(float));
+	if (!sp->voices || !sp->sent || !sp->memory) {
+		WARN("IVY AUDIO: Unable to allocate spatializer sources");
+		audio_spatializer_destroy(sp);
+		return NULL;
+	}
+	float **arrays[] = {&sp->src.x, &sp->src.y, &sp->src.z, &sp->src.vx, &sp->src.vy, &sp->src.vz,
+						&sp->src.gain, &sp->src.ref, &sp->src.max, &sp->src.out_gain, &sp->src.out_pan, &sp->src.out_pitch};
+	for (int i = 0; i < 12; i++) {
+		*arrays[i] = sp->memory + i * padded;
+	}
+	// Keeps the spare lanes away from divisions by zero
+	for (size_t i = 0; i < padded; i++) {
+		sp->src.ref[i] = sp->src.max[i] = 1.0f;
+	}
+	audio_spatializer_set_listener(sp, mat4_identity(), vec3_zero());
+	sp->speed_of_sound = 343.0f;
+	return sp;
+}
+
+void audio_spatializer_destroy(audio_spatializer_t *sp)
+{
+	if (sp) {
+		IVY_FREE(sp->voices);
+		IVY_FREE(sp->sent);
+		IVY_FREE(sp->memory);
+		IVY_FREE(sp);
+	}
+}
+
+void audio_spatializer_set_listener(audio_spatializer_t *sp, mat4_t view, vec3_t velocity)
+{
+	// The view is a rotation then a translation, the eye is the point it
+	// moves to the origin and the first column is the right axis
+	vec3_t t = vec3(view.m30, view.m31, view.m32);
+	sp->eye = vec3(-(t.x * view.m00 + t.y * view.m01 + t.z * view.m02),
+				   -(t.x * view.m10 + t.y * view.m11 + t.z * view.m12),
+				   -(t.x * view.m20 + t.y * view.m21 + t.z * view.m22));
+	sp->right = vec3(view.m00, view.m10, view.m20);
+	sp->velocity = velocity;
+}
+
+void audio_spatializer_set_speed_of_sound(audio_spatializer_t *sp, float speed)
+{
+	sp->speed_of_sound = speed > 0.0f ? speed : 0.0f;
+}
+
+audio_source_t audio_spatializer_add(audio_spatializer_t *sp, audio_voice_t voice, float gain, float ref_distance,
+									 float max_distance)
+{
+	if (!voice) {
+		return 0;
+	}
+	for (unsigned int i = 0; i < sp->max_sources; i++) {
+		if (sp->voices[i]) {
+			continue;
+		}
+		sp->voices[i] = voice;
+		sp->src.gain[i] = gain;
+		sp->src.ref[i] = fmaxf(ref_distance, 1e-3f);
+		sp->src.max[i] = fmaxf(max_distance, sp->src.ref[i]);
+		// Forces the first update to reach the mixer
+		sp->sent[i * 3] = sp->sent[i * 3 + 1] = sp->sent[i * 3 + 2] = INFINITY;
+		if (i >= sp->count) {
+			sp->count = i + 1;
+		}
+		audio_spatializer_set_source(sp, i + 1, sp->eye, vec3_zero());
+		return i + 1;
+	}
+	return 0;
+}
+
+void audio_spatializer_remove(audio_spatializer_t *sp, audio_source_t source)
+{
+	if (!source || source > sp->count) {
+		return;
+	}
+	sp->voices[source - 1] = 0;
+	while (sp->count && !sp->voices[sp->count - 1]) {
+		sp->count--;
+	}
+}
+
+void audio_spatializer_set_source(audio_spatializer_t *sp, audio_source_t source, vec3_t position, vec3_t velocity)
+{
+	if (!source || source > sp->count) {
+		return;
+	}
+	unsigned int i = source - 1;
+	sp->src.x[i] = position.x, sp->src.y[i] = position.y, sp->src.z[i] = position.z;
+	sp->src.vx[i] = velocity.x, sp->src.vy[i] = velocity.y, sp->src.vz[i] = velocity.z;
+}
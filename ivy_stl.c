@@ -1,4 +1,5 @@
 #include "ivy.h"
+#include "ivy_math.h"
 
 stl_data_t stl_load(const char *input_filepath)
 {
@@ -42,3 +43,11 @@ void stl_free(stl_data_t stl_data)
 {
 	IVY_FREE(stl_data.triangles);
 }
+
+void stl_compute_normals(stl_data_t *stl_data)
+{
+	if (stl_data->triangles_count) {
+		stl_face_t *t = stl_data->triangles;
+		vec3_array_face_normals(&t->normal, 4, &t->vertex1, 4, stl_data->triangles_count);
+	}
+}
@@ -0,0 +1,547 @@
+#include "ivy.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define IVY_WAV_SSSE3
+#endif
+
+// Frames decoded by the stream thread at a time
+#ifndef IVY_WAV_STREAM_BLOCK
+#define IVY_WAV_STREAM_BLOCK 2048
+#endif // IVY_WAV_STREAM_BLOCK
+
+// Decoded frames buffered ahead of the reader
+#ifndef IVY_WAV_STREAM_FRAMES
+#define IVY_WAV_STREAM_FRAMES 16384
+#endif // IVY_WAV_STREAM_FRAMES
+
+#define WAV_FORMAT_PCM 0x0001
+#define WAV_FORMAT_FLOAT 0x0003
+#define WAV_FORMAT_EXTENSIBLE 0xfffe
+
+// Silence pushed through the resampler at the end of a stream
+#define WAV_PADDING_FRAMES 64
+
+typedef enum {
+	WAV_U8,
+	WAV_S16,
+	WAV_S24,
+	WAV_S32,
+	WAV_F32,
+} WAV_SAMPLE;
+
+typedef struct {
+	u8_t *base;
+	size_t size;
+	bool_t mapped;
+	const u8_t *data;
+	size_t frames;
+	size_t frame_size;
+	unsigned int channels;
+	unsigned int sample_rate;
+	int sample;
+} wav_file_t;
+
+// Owner of a loaded clip, either the mapping itself or converted samples
+typedef struct {
+	wav_file_t file;
+	float *converted;
+} wav_clip_t;
+
+// ---------------------------------------------------------------
+// CONVERSION
+
+static void _wav_convert_scalar(float *dst, const u8_t *src, size_t count, int sample)
+{
+	switch (sample) {
+	case WAV_U8:
+		for (size_t i = 0; i < count; i++) {
+			dst[i] = ((int)src[i] - 128) * (1.0f / 128.0f);
+		}
+		break;
+	case WAV_S16:
+		for (size_t i = 0; i < count; i++) {
+			i16_t s;
+			memcpy(&s, src + i * 2, 2);
+			dst[i] = s * (1.0f / 32768.0f);
+		}
+		break;
+	case WAV_S24:
+		for (size_t i = 0; i < count; i++) {
+			const u8_t *p = src + i * 3;
+			i32_t s = (i32_t)((u32_t)p[0] << 8 | (u32_t)p[1] << 16 | (u32_t)p[2] << 24) >> 8;
+			dst[i] = s * (1.0f / 8388608.0f);
+		}
+		break;
+	case WAV_S32:
+		for (size_t i = 0; i < count; i++) {
+			i32_t s;
+			memcpy(&s, src + i * 4, 4);
+			dst[i] = s * (1.0f / 2147483648.0f);
+		}
+		break;
+	case WAV_F32:
+		memcpy(dst, src, count * sizeof(float));
+		break;
+	}
+}
+
+#if defined(IVY_WAV_SSSE3)
+// Spreads 4 packed 24 bit samples into the top of 4 i32 lanes
+__attribute__((target("ssse3"))) static size_t _wav_convert_s24_ssse3(float *dst, const u8_t *src, size_t count)
+{
+	const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+	const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+	size_t i = 0;
+	// Each load reads 16 bytes but uses 12, stop before running off the end
+	for (; i + 6 <= count; i += 4) {
+		__m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + i * 3)), shuffle);
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+	}
+	return i;
+}
+#endif
+
+// Bulk conversion of count interleaved samples to float
+static void _wav_convert(float *dst, const u8_t *src, size_t count, int sample)
+{
+	size_t i = 0;
+#if defined(__SSE2__)
+	switch (sample) {
+	case WAV_U8: {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i bias = _mm_set1_epi16(128);
+		const __m128 scale = _mm_set1_ps(1.0f / 128.0f);
+		for (; i + 16 <= count; i += 16) {
+			__m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+			__m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(b, zero), bias);
+			__m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(b, zero), bias);
+			// Sign extend the 16 bit lanes by shifting them into the top half
+			_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(zero, lo), 16)), scale));
+			_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(zero, lo), 16)), scale));
+			_mm_storeu_ps(dst + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(zero, hi), 16)), scale));
+			_mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(zero, hi), 16)), scale));
+		}
+		break;
+	}
+	case WAV_S16: {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+		for (; i + 8 <= count; i += 8) {
+			__m128i s = _mm_loadu_si128((const __m128i *)(src + i * 2));
+			_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(zero, s), 16)), scale));
+			_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(zero, s), 16)), scale));
+		}
+		break;
+	}
+	case WAV_S32: {
+		const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+		for (; i + 4 <= count; i += 4) {
+			__m128i s = _mm_loadu_si128((const __m128i *)(src + i * 4));
+			_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(s), scale));
+		}
+		break;
+	}
+	}
+#endif
+#if defined(IVY_WAV_SSSE3)
+	if (sample == WAV_S24 && __builtin_cpu_supports("ssse3")) {
+		i = _wav_convert_s24_ssse3(dst, src, count);
+	}
+#endif
+	static const size_t sample_size[] = {1, 2, 3, 4, 4};
+	_wav_convert_scalar(dst + i, src + i * sample_size[sample], count - i, sample);
+}
+
+// ---------------------------------------------------------------
+// FILE
+
+static u32_t _wav_u32(const u8_t *p)
+{
+	return (u32_t)p[0] | (u32_t)p[1] << 8 | (u32_t)p[2] << 16 | (u32_t)p[3] << 24;
+}
+
+static u16_t _wav_u16(const u8_t *p)
+{
+	return (u16_t)(p[0] | p[1] << 8);
+}
+
+static bool_t _wav_map(wav_file_t *wav, const char *path)
+{
+#if defined(_WIN32)
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		return 0;
+	}
+	fseek(f, 0, SEEK_END);
+	wav->size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	wav->base = IVY_MALLOC(wav->size ? wav->size : 1);
+	bool_t ok = wav->base && fread(wav->base, 1, wav->size, f) == wav->size;
+	fclose(f);
+	if (!ok) {
+		IVY_FREE(wav->base);
+		return 0;
+	}
+	wav->mapped = 0;
+	return 1;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return 0;
+	}
+	struct stat st;
+	if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+		close(fd);
+		return 0;
+	}
+	wav->size = st.st_size;
+	wav->base = mmap(NULL, wav->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (wav->base == MAP_FAILED) {
+		return 0;
+	}
+	wav->mapped = 1;
+	return 1;
+#endif
+}
+
+static void _wav_close(wav_file_t *wav)
+{
+#if !defined(_WIN32)
+	if (wav->mapped) {
+		munmap(wav->base, wav->size);
+		return;
+	}
+#endif
+	IVY_FREE(wav->base);
+}
+
+static bool_t _wav_open(wav_file_t *wav, const char *path)
+{
+	memset(wav, 0, sizeof(wav_file_t));
+	if (!_wav_map(wav, path)) {
+		WARN("IVY WAV: Unable to read file at [%s]", path);
+		return 0;
+	}
+	const u8_t *p = wav->base;
+	if (wav->size < 12 || memcmp(p, "RIFF", 4) || memcmp(p + 8, "WAVE", 4)) {
+		WARN("IVY WAV: [%s] is not a RIFF/WAVE file", path);
+		_wav_close(wav);
+		return 0;
+	}
+
+	int tag = 0, bits = 0;
+	size_t data_size = 0;
+	size_t off = 12;
+	while (off + 8 <= wav->size) {
+		const u8_t *chunk = p + off;
+		size_t size = _wav_u32(chunk + 4);
+		size_t avail = wav->size - off - 8;
+		if (!memcmp(chunk, "fmt ", 4) && size >= 16 && avail >= 16) {
+			tag = _wav_u16(chunk + 8);
+			wav->channels = _wav_u16(chunk + 10);
+			wav->sample_rate = _wav_u32(chunk + 12);
+			bits = _wav_u16(chunk + 22);
+			// The real format tag is the start of the sub format guid
+			if (tag == WAV_FORMAT_EXTENSIBLE && size >= 40 && avail >= 40) {
+				tag = _wav_u16(chunk + 32);
+			}
+		} else if (!memcmp(chunk, "data", 4)) {
+			// Streaming recorders that never patched their header leave
+			// the size at 0 or 0xffffffff, those run to the end of the
+			// file. A truncated file still stops where its bytes do
+			wav->data = chunk + 8;
+			if (size == 0 || size == 0xffffffff) {
+				size = avail;
+			}
+			data_size = size < avail ? size : avail;
+			break;
+		}
+		// Chunks are padded to an even size
+		off += 8 + size + (size & 1);
+	}
+
+	if (tag == WAV_FORMAT_PCM && bits == 8) {
+		wav->sample = WAV_U8;
+	} else if (tag == WAV_FORMAT_PCM && bits == 16) {
+		wav->sample = WAV_S16;
+	} else if (tag == WAV_FORMAT_PCM && bits == 24) {
+		wav->sample = WAV_S24;
+	} else if (tag == WAV_FORMAT_PCM && bits == 32) {
+		wav->sample = WAV_S32;
+	} else if (tag == WAV_FORMAT_FLOAT && bits == 32) {
+		wav->sample = WAV_F32;
+	} else {
+		WARN("IVY WAV: [%s] has unsupported format %d with %d bits", path, tag, bits);
+		_wav_close(wav);
+		return 0;
+	}
+	if (!wav->data || !wav->channels || !wav->sample_rate) {
+		WARN("IVY WAV: [%s] has no fmt or data chunk", path);
+		_wav_close(wav);
+		return 0;
+	}
+	wav->frame_size = wav->channels * (bits / 8);
+	wav->frames = data_size / wav->frame_size;
+	return 1;
+}
+
+// ---------------------------------------------------------------
+// CLIP
+
+audio_clip_t audio_clip_load_wav(const char *path)
+{
+	audio_clip_t clip = {0};
+	wav_clip_t *owner = IVY_CALLOC(1, sizeof(wav_clip_t));
+	if (!owner) {
+		WARN("IVY WAV: Unable to allocate clip");
+		return clip;
+	}
+	wav_file_t *wav = &owner->file;
+	if (!_wav_open(wav, path)) {
+		IVY_FREE(owner);
+		return clip;
+	}
+	clip.frames = wav->frames;
+	clip.channels = wav->channels;
+	clip.sample_rate = wav->sample_rate;
+	clip.native = owner;
+
+	// Aligned float data is played straight out of the mapping
+	if (wav->sample == WAV_F32 && !((uintptr_t)wav->data & (sizeof(float) - 1))) {
+		clip.samples = (const float *)wav->data;
+#if defined(MADV_WILLNEED)
+		if (wav->mapped) {
+			madvise(wav->base, wav->size, MADV_WILLNEED);
+		}
+#endif
+		return clip;
+	}
+
+	size_t count = wav->frames * wav->channels;
+	owner->converted = IVY_MALLOC((count ? count : 1) * sizeof(float));
+	if (!owner->converted) {
+		WARN("IVY WAV: Unable to allocate %zu samples for [%s]", count, path);
+		audio_clip_free(&clip);
+		return clip;
+	}
+	_wav_convert(owner->converted, wav->data, count, wav->sample);
+	clip.samples = owner->converted;
+	// Only the converted copy is used from here on
+	_wav_close(wav);
+	wav->base = NULL;
+	wav->mapped = 0;
+	return clip;
+}
+
+void audio_clip_free(audio_clip_t *clip)
+{
+	wav_clip_t *owner = clip->native;
+	if (owner) {
+		if (owner->file.base) {
+			_wav_close(&owner->file);
+		}
+		IVY_FREE(owner->converted);
+		IVY_FREE(owner);
+	}
+	memset(clip, 0, sizeof(audio_clip_t));
+}
+
+// ---------------------------------------------------------------
+// STREAM
+
+typedef struct {
+	wav_file_t file;
+	size_t pos;
+	size_t padding;
+	int flags;
+	audio_ring_t *ring;
+	audio_resampler_t *resampler;
+	float *decoded;
+	size_t decoded_pos;
+	size_t decoded_len;
+	float *block;
+	unsigned int channels;
+	unsigned int sample_rate;
+	pthread_t thread;
+	atomic_bool running;
+	atomic_bool ended;
+} wav_stream_t;
+
+// Decodes the next chunk of the file into the decoded buffer
+static void _wav_stream_decode(wav_stream_t *s)
+{
+	wav_file_t *wav = &s->file;
+	s->decoded_pos = 0;
+	s->decoded_len = 0;
+	if (s->pos == wav->frames && (s->flags & IVY_AUDIO_VOICE_LOOP)) {
+		s->pos = 0;
+	}
+	if (s->pos < wav->frames) {
+		size_t n = wav->frames - s->pos < IVY_WAV_STREAM_BLOCK ? wav->frames - s->pos : IVY_WAV_STREAM_BLOCK;
+		_wav_convert(s->decoded, wav->data + s->pos * wav->frame_size, n * wav->channels, wav->sample);
+		s->pos += n;
+		s->decoded_len = n;
+	} else if (s->resampler && s->padding < WAV_PADDING_FRAMES) {
+		// Flushes the frames the filter still holds back
+		memset(s->decoded, 0, WAV_PADDING_FRAMES * s->channels * sizeof(float));
+		s->padding = WAV_PADDING_FRAMES;
+		s->decoded_len = WAV_PADDING_FRAMES;
+	}
+}
+
+// Pushes up to one block into the ring, returns 0 at the end of the file
+static bool_t _wav_stream_fill(wav_stream_t *s)
+{
+	size_t room = audio_ring_writable(s->ring);
+	size_t frames = room < IVY_WAV_STREAM_BLOCK ? room : IVY_WAV_STREAM_BLOCK;
+	size_t written = 0;
+	while (written < frames) {
+		if (s->decoded_pos == s->decoded_len) {
+			_wav_stream_decode(s);
+			if (!s->decoded_len) {
+				break;
+			}
+		}
+		const float *in = s->decoded + s->decoded_pos * s->channels;
+		size_t avail = s->decoded_len - s->decoded_pos;
+		if (s->resampler) {
+			size_t used = avail;
+			written += audio_resampler_process(s->resampler, in, &used, s->block + written * s->channels, frames - written);
+			s->decoded_pos += used;
+		} else {
+			size_t n = avail < frames - written ? avail : frames - written;
+			memcpy(s->block + written * s->channels, in, n * s->channels * sizeof(float));
+			s->decoded_pos += n;
+			written += n;
+		}
+	}
+	audio_ring_write(s->ring, s->block, written);
+	return written == frames;
+}
+
+static void *_wav_stream_thread(void *arg)
+{
+	wav_stream_t *s = arg;
+	// Sleeps a quarter block between checks, well ahead of the reader
+	long nap = (long)(IVY_WAV_STREAM_BLOCK * 250000000.0 / s->sample_rate);
+	struct timespec ts = {nap / 1000000000, nap % 1000000000};
+	while (atomic_load_explicit(&s->running, memory_order_acquire)) {
+		if (audio_ring_writable(s->ring) < IVY_WAV_STREAM_BLOCK) {
+			nanosleep(&ts, NULL);
+			continue;
+		}
+		if (!_wav_stream_fill(s)) {
+			break;
+		}
+	}
+	atomic_store_explicit(&s->ended, 1, memory_order_release);
+	return NULL;
+}
+
+static void _wav_stream_free(wav_stream_t *s)
+{
+	_wav_close(&s->file);
+	audio_ring_destroy(s->ring);
+	audio_resampler_destroy(s->resampler);
+	IVY_FREE(s->decoded);
+	IVY_FREE(s->block);
+	IVY_FREE(s);
+}
+
+audio_stream_t audio_stream_open_wav(const char *path, unsigned int sample_rate, int flags)
+{
+	audio_stream_t stream = {0};
+	wav_stream_t *s = IVY_CALLOC(1, sizeof(wav_stream_t));
+	if (!s) {
+		WARN("IVY WAV: Unable to allocate stream");
+		return stream;
+	}
+	if (!_wav_open(&s->file, path)) {
+		IVY_FREE(s);
+		return stream;
+	}
+#if defined(MADV_SEQUENTIAL)
+	if (s->file.mapped) {
+		madvise(s->file.base, s->file.size, MADV_SEQUENTIAL);
+	}
+#endif
+	s->flags = flags;
+	s->channels = s->file.channels;
+	s->sample_rate = sample_rate ? sample_rate : s->file.sample_rate;
+	s->ring = audio_ring_create(IVY_WAV_STREAM_FRAMES, s->channels);
+	s->decoded = IVY_MALLOC(IVY_WAV_STREAM_BLOCK * s->channels * sizeof(float));
+	s->block = IVY_MALLOC(IVY_WAV_STREAM_BLOCK * s->channels * sizeof(float));
+	if (s->sample_rate != s->file.sample_rate) {
+		s->resampler = audio_resampler_create(s->channels, s->file.sample_rate, s->sample_rate);
+	}
+	if (!s->ring || !s->decoded || !s->block || (s->sample_rate != s->file.sample_rate && !s->resampler)) {
+		WARN("IVY WAV: Unable to allocate stream for [%s]", path);
+		_wav_stream_free(s);
+		return stream;
+	}
+
+	// Fills the ring up front so playback can start right away
+	bool_t more = 1;
+	while (more && audio_ring_writable(s->ring) >= IVY_WAV_STREAM_BLOCK) {
+		more = _wav_stream_fill(s);
+	}
+	atomic_store(&s->running, more);
+	atomic_store(&s->ended, !more);
+	if (more && pthread_create(&s->thread, NULL, _wav_stream_thread, s)) {
+		WARN("IVY WAV: Unable to create stream thread");
+		_wav_stream_free(s);
+		return stream;
+	}
+
+	stream.channels = s->channels;
+	stream.sample_rate = s->sample_rate;
+	stream.frames = s->file.frames;
+	stream.native = s;
+	return stream;
+}
+
+size_t audio_stream_read(audio_stream_t *stream, float *buf, size_t frames)
+{
+	wav_stream_t *s = stream->native;
+	return audio_ring_read(s->ring, buf, frames);
+}
+
+bool_t audio_stream_finished(audio_stream_t *stream)
+{
+	wav_stream_t *s = stream->native;
+	return atomic_load_explicit(&s->ended, memory_order_acquire) && !audio_ring_readable(s->ring);
+}
+
+void audio_stream_close(audio_stream_t *stream)
+{
+	wav_stream_t *s = stream->native;
+	if (!s) {
+		return;
+	}
+	if (atomic_load(&s->running)) {
+		atomic_store(&s->running, 0);
+		pthread_join(s->thread, NULL);
+	}
+	_wav_stream_free(s);
+	stream->native = NULL;
+}
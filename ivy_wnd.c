@@ -1,5 +1,35 @@
 #include "ivy.h"
 
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef IVY_INPUT_QUEUE_SIZE
+#define IVY_INPUT_QUEUE_SIZE 256
+#endif // IVY_INPUT_QUEUE_SIZE
+
+// Upper bound on how long the input thread sleeps in poll
+// events already buffered by the native library do not wake poll up
+#ifndef IVY_INPUT_POLL_MS
+#define IVY_INPUT_POLL_MS 2
+#endif // IVY_INPUT_POLL_MS
+
+// Single producer (input thread), single consumer (wnd_update) event queue
+// and a seqlock protected snapshot of the latest input state
+typedef struct {
+	wnd_event_t queue[IVY_INPUT_QUEUE_SIZE];
+	atomic_uint head;
+	atomic_uint tail;
+	atomic_uint dropped;
+
+	atomic_uint seq;
+	wnd_input_t state;
+
+	atomic_bool running;
+	pthread_t thread;
+} wnd_input_queue_t;
+
 static void default_mouse_move_cb(struct window_context_t *wnd, int mx, int my, int p_mx, int p_my)
 {
 	(void)wnd, (void)mx, (void)my, (void)p_mx, (void)p_my;
@@ -38,6 +68,187 @@ static void default_window_resize_cb(struct window_context_t *wnd, int w, int h)
 	(void)wnd, (void)w, (void)h;
 }
 
+u64_t wnd_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64_t)ts.tv_sec * 1000000000ull + (u64_t)ts.tv_nsec;
+}
+
+static void _wnd_publish_input(wnd_input_queue_t *input, const wnd_event_t *ev)
+{
+	wnd_input_t *state = &input->state;
+	unsigned seq = atomic_load_explicit(&input->seq, memory_order_relaxed);
+	atomic_store_explicit(&input->seq, seq + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	state->timestamp_ns = ev->timestamp_ns;
+	switch (ev->type) {
+	case IVY_EVENT_KEY_PRESS:
+	case IVY_EVENT_KEY_RELEASE: {
+		state->mods = ev->mods;
+		if (ev->key >= IVY_KEY_FIRST && ev->key <= IVY_KEY_LAST) {
+			state->keys[ev->key] = ev->type == IVY_EVENT_KEY_PRESS;
+		}
+	} break;
+	case IVY_EVENT_MOUSE_MOVE:
+	case IVY_EVENT_MOUSE_ENTER:
+	case IVY_EVENT_MOUSE_LEAVE: {
+		state->mouse_x = ev->x;
+		state->mouse_y = ev->y;
+	} break;
+	default:
+		break;
+	}
+
+	atomic_store_explicit(&input->seq, seq + 2, memory_order_release);
+}
+
+static void _wnd_dispatch_event(window_context_t *wnd, const wnd_event_t *ev)
+{
+	switch (ev->type) {
+	case IVY_EVENT_KEY_PRESS: {
+		wnd->mods = ev->mods;
+		if (ev->key >= IVY_KEY_FIRST && ev->key <= IVY_KEY_LAST) {
+			wnd->keys[ev->key] = 1;
+		}
+		wnd->on_key_press(wnd, ev->key, wnd->mods);
+	} break;
+	case IVY_EVENT_KEY_RELEASE: {
+		wnd->mods = ev->mods;
+		if (ev->key >= IVY_KEY_FIRST && ev->key <= IVY_KEY_LAST) {
+			wnd->keys[ev->key] = 0;
+		}
+		wnd->on_key_release(wnd, ev->key, wnd->mods);
+	} break;
+	case IVY_EVENT_MOUSE_MOVE: {
+		if (wnd->first_mouse) {
+			wnd->p_mouse_x = ev->x;
+			wnd->p_mouse_y = ev->y;
+		}
+		wnd->mouse_x = ev->x;
+		wnd->mouse_y = ev->y;
+		wnd->on_mouse_move(wnd, ev->x, ev->y, wnd->p_mouse_x, wnd->p_mouse_y);
+		wnd->p_mouse_x = ev->x;
+		wnd->p_mouse_y = ev->y;
+	} break;
+	case IVY_EVENT_MOUSE_ENTER: {
+		wnd->p_mouse_x = wnd->mouse_x = ev->x;
+		wnd->p_mouse_y = wnd->mouse_y = ev->y;
+		wnd->on_mouse_enter(wnd, wnd->mouse_x, wnd->mouse_y, wnd->p_mouse_x, wnd->p_mouse_y);
+	} break;
+	case IVY_EVENT_MOUSE_LEAVE: {
+		wnd->p_mouse_x = wnd->mouse_x = ev->x;
+		wnd->p_mouse_y = wnd->mouse_y = ev->y;
+		wnd->on_mouse_leave(wnd, wnd->mouse_x, wnd->mouse_y, wnd->p_mouse_x, wnd->p_mouse_y);
+	} break;
+	case IVY_EVENT_TEXT_INPUT: {
+		wnd->on_text_input(wnd, ev->text, ev->text_len);
+	} break;
+	case IVY_EVENT_WINDOW_RESIZE: {
+		if (ev->x != wnd->pixels.width || ev->y != wnd->pixels.height) {
+			gfx_resize(&wnd->pixels, ev->x, ev->y);
+			wnd_resize_native(wnd, ev->x, ev->y);
+			wnd->on_window_resize(wnd, ev->x, ev->y);
+		}
+	} break;
+	case IVY_EVENT_WINDOW_CLOSE: {
+		wnd->is_closed = 1;
+	} break;
+	default:
+		break;
+	}
+}
+
+void wnd_push_event(window_context_t *wnd, const wnd_event_t *ev)
+{
+	wnd_input_queue_t *input = wnd->input;
+	_wnd_publish_input(input, ev);
+
+	if (!atomic_load_explicit(&input->running, memory_order_acquire)) {
+		_wnd_dispatch_event(wnd, ev);
+		return;
+	}
+
+	unsigned head = atomic_load_explicit(&input->head, memory_order_relaxed);
+	unsigned tail = atomic_load_explicit(&input->tail, memory_order_acquire);
+	if (head - tail >= IVY_INPUT_QUEUE_SIZE) {
+		// Queue is full, key and mouse state is still published above
+		atomic_fetch_add_explicit(&input->dropped, 1, memory_order_relaxed);
+		return;
+	}
+	input->queue[head % IVY_INPUT_QUEUE_SIZE] = *ev;
+	atomic_store_explicit(&input->head, head + 1, memory_order_release);
+}
+
+static void _wnd_drain_events(window_context_t *wnd)
+{
+	wnd_input_queue_t *input = wnd->input;
+	unsigned tail = atomic_load_explicit(&input->tail, memory_order_relaxed);
+	unsigned head = atomic_load_explicit(&input->head, memory_order_acquire);
+	while (tail != head) {
+		wnd_event_t ev = input->queue[tail % IVY_INPUT_QUEUE_SIZE];
+		tail++;
+		atomic_store_explicit(&input->tail, tail, memory_order_release);
+		_wnd_dispatch_event(wnd, &ev);
+	}
+
+	unsigned dropped = atomic_exchange_explicit(&input->dropped, 0, memory_order_relaxed);
+	if (dropped) {
+		WARN("IVY_WND: Input queue full, dropped %u events", dropped);
+	}
+}
+
+wnd_input_t wnd_input_sample(window_context_t *wnd)
+{
+	wnd_input_queue_t *input = wnd->input;
+	wnd_input_t state;
+	unsigned seq0, seq1;
+	do {
+		seq0 = atomic_load_explicit(&input->seq, memory_order_acquire);
+		memcpy(&state, &input->state, sizeof(state));
+		atomic_thread_fence(memory_order_acquire);
+		seq1 = atomic_load_explicit(&input->seq, memory_order_relaxed);
+	} while ((seq0 & 1) || seq0 != seq1);
+	return state;
+}
+
+static void *_wnd_input_thread(void *arg)
+{
+	window_context_t *wnd = arg;
+	wnd_input_queue_t *input = wnd->input;
+	while (atomic_load_explicit(&input->running, memory_order_acquire)) {
+		wnd_poll_events_native(wnd, IVY_INPUT_POLL_MS);
+	}
+	return NULL;
+}
+
+int wnd_input_thread_start(window_context_t *wnd)
+{
+	wnd_input_queue_t *input = wnd->input;
+	if (atomic_load(&input->running)) {
+		return 1;
+	}
+	atomic_store(&input->running, 1);
+	if (pthread_create(&input->thread, NULL, _wnd_input_thread, wnd)) {
+		atomic_store(&input->running, 0);
+		WARN("IVY_WND: Unable to create input thread");
+		return 0;
+	}
+	return 1;
+}
+
+void wnd_input_thread_stop(window_context_t *wnd)
+{
+	wnd_input_queue_t *input = wnd->input;
+	if (!atomic_load(&input->running)) {
+		return;
+	}
+	atomic_store(&input->running, 0);
+	pthread_join(input->thread, NULL);
+	_wnd_drain_events(wnd);
+}
+
 window_context_t wnd_create(u32_t width, u32_t height, const char *title)
 {
 	window_context_t wnd = {
@@ -55,6 +266,10 @@ window_context_t wnd_create(u32_t width, u32_t height, const char *title)
 	};
 
 	wnd.pixels = gfx_create(width, height);
+	wnd.input = IVY_CALLOC(1, sizeof(wnd_input_queue_t));
+	if (!wnd.input) {
+		FATAL("IVY_WND: Unable to allocate memory");
+	}
 	wnd.native = wnd_create_native(&wnd, width, height, title);
 
 	if (!wnd.native) {
@@ -66,6 +281,15 @@ window_context_t wnd_create(u32_t width, u32_t height, const char *title)
 
 int wnd_update(window_context_t *wnd)
 {
+	if (wnd->is_closed) {
+		return 1;
+	}
+	wnd_input_queue_t *input = wnd->input;
+	if (atomic_load_explicit(&input->running, memory_order_acquire)) {
+		_wnd_drain_events(wnd);
+	} else {
+		wnd_poll_events_native(wnd, 0);
+	}
 	if (wnd->is_closed) {
 		return 1;
 	}
@@ -75,6 +299,9 @@ int wnd_update(window_context_t *wnd)
 void wnd_destroy(window_context_t *wnd)
 {
 	wnd->is_closed = 1;
+	wnd_input_thread_stop(wnd);
 	gfx_destroy(&wnd->pixels);
 	wnd_destroy_native(wnd);
+	IVY_FREE(wnd->input);
+	wnd->input = NULL;
 }
@@ -0,0 +1,811 @@
+#include "../ivy_math.h"
+#define RAYMATH_IMPLEMENTATION
+#include "raymath.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_TSC
+#endif
+
+// Every run works through BENCH_N elements, small enough for the inputs
+// and outputs to stay in L2 so the math is measured and not the memory
+#define BENCH_N 1024
+#define BENCH_MAX_REPS 1000
+
+// Inputs are generated once, raymath gets bit identical copies in its
+// own types
+static float fa[BENCH_N], fb[BENCH_N], fc[BENCH_N], fout[BENCH_N];
+static int iout[BENCH_N];
+static vec2_t v2a[BENCH_N], v2b[BENCH_N], v2out[BENCH_N];
+static vec3_t v3a[BENCH_N], v3b[BENCH_N], v3c[BENCH_N], v3d[BENCH_N], v3out[BENCH_N];
+static mat4_t ma[BENCH_N], mb[BENCH_N], maff[BENCH_N], mrigid[BENCH_N], mout[BENCH_N];
+static affine_t aa[BENCH_N], ab[BENCH_N], arigid[BENCH_N], aout[BENCH_N];
+static quat_t qa[BENCH_N], qb[BENCH_N], qout[BENCH_N];
+
+static Vector2 rv2a[BENCH_N], rv2b[BENCH_N], rv2out[BENCH_N];
+static Vector3 rv3a[BENCH_N], rv3b[BENCH_N], rv3c[BENCH_N], rv3d[BENCH_N], rv3out[BENCH_N];
+static Matrix rma[BENCH_N], rmb[BENCH_N], rmaff[BENCH_N], rmrigid[BENCH_N], rmout[BENCH_N];
+static Quaternion rqa[BENCH_N], rqb[BENCH_N], rqout[BENCH_N];
+
+// Triangle soup for the ray tests, 3 vertices per triangle
+#define BENCH_RAYS 16
+static vec3_t tris[BENCH_N * 3];
+static Vector3 rtris[BENCH_N * 3];
+static tri8_t packets[BENCH_N / 8];
+static ray_t rays[BENCH_RAYS];
+static ray_hit_t ray_result;
+static size_t ray_next;
+
+// Volumes spread wider than the view so part of them is culled
+static frustum_t frustum, frustums[BENCH_N];
+static vec3_t sphere_centers[BENCH_N], box_mins[BENCH_N], box_maxs[BENCH_N];
+static unsigned int visible[BENCH_N];
+static size_t visible_count;
+
+// Outputs that are never read are dead stores to the compiler, every
+// benchmark ends with a pass over all of them
+static volatile float bench_sink;
+
+static void bench_consume(void)
+{
+	float sum = ray_result.t + visible_count + frustums[0].d[0];
+	for (size_t i = 0; i < BENCH_N; i++) {
+		sum += fout[i] + iout[i] + v2out[i].x + v3out[i].x + mout[i].m00 + aout[i].m00 + qout[i].x;
+		sum += rv2out[i].x + rv3out[i].x + rmout[i].m0 + rqout[i].x + visible[i] + frustums[i].d[0];
+	}
+	bench_sink = sum;
+}
+
+static float frand(float min, float max)
+{
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+static vec3_t vrand(float min, float max)
+{
+	return vec3(frand(min, max), frand(min, max), frand(min, max));
+}
+
+static void bench_setup(void)
+{
+	srand(1);
+	for (size_t i = 0; i < BENCH_N; i++) {
+		// Positive and away from zero so log, rsqrt and divisions stay
+		// on their common path
+		fa[i] = frand(0.25f, 4.0f);
+		fb[i] = frand(0.25f, 4.0f);
+		fc[i] = frand(0.0f, 1.0f);
+		v2a[i] = vec2(frand(-4.0f, 4.0f), frand(-4.0f, 4.0f));
+		v2b[i] = vec2(frand(-4.0f, 4.0f), frand(-4.0f, 4.0f));
+		v3a[i] = vrand(-4.0f, 4.0f);
+		v3b[i] = vrand(-4.0f, 4.0f);
+		v3c[i] = vrand(-4.0f, 4.0f);
+		v3d[i] = vrand(-4.0f, 4.0f);
+		float *m = &ma[i].m00, *n = &mb[i].m00;
+		for (int k = 0; k < 16; k++) {
+			m[k] = frand(-2.0f, 2.0f);
+			n[k] = frand(-2.0f, 2.0f);
+		}
+		qa[i] = quat_normalize(quat(frand(-1.0f, 1.0f), frand(-1.0f, 1.0f), frand(-1.0f, 1.0f), frand(-1.0f, 1.0f)));
+		qb[i] = quat_normalize(quat(frand(-1.0f, 1.0f), frand(-1.0f, 1.0f), frand(-1.0f, 1.0f), frand(-1.0f, 1.0f)));
+		mrigid[i] = mat4_mul(quat_to_mat4(qa[i]), mat4_translate(v3a[i]));
+		maff[i] = mat4_mul(mat4_scale(vrand(0.5f, 2.0f)), mrigid[i]);
+		aa[i] = affine_from_mat4(maff[i]);
+		ab[i] = affine_from_mat4(mat4_mul(mat4_scale(vrand(0.5f, 2.0f)), mat4_mul(quat_to_mat4(qb[i]), mat4_translate(v3b[i]))));
+		arigid[i] = affine_from_mat4(mrigid[i]);
+
+		sphere_centers[i] = vrand(-12.0f, 12.0f);
+		box_mins[i] = vec3_subv(sphere_centers[i], fa[i]);
+		box_maxs[i] = vec3_addv(sphere_centers[i], fa[i]);
+
+		vec3_t c = vrand(-1.0f, 1.0f);
+		for (int k = 0; k < 3; k++) {
+			tris[i * 3 + k] = vec3_add(c, vrand(-0.2f, 0.2f));
+		}
+	}
+	for (size_t i = 0; i < BENCH_RAYS; i++) {
+		vec3_t origin = vec3(frand(-1.0f, 1.0f), frand(-1.0f, 1.0f), -5.0f);
+		rays[i] = (ray_t){origin, vec3_normalize(vec3_sub(vrand(-0.5f, 0.5f), origin))};
+	}
+	tri8_pack(packets, tris, 3, BENCH_N);
+	frustum = frustum_from_mat4(mat4_mul(mat4_lookat_rh(vec3(0.0f, 0.0f, 10.0f), vec3_zero(), vec3(0.0f, 1.0f, 0.0f)),
+										 mat4_perspective(1.0f, 1.5f, 0.1f, 20.0f)));
+
+	memcpy(rv2a, v2a, sizeof(v2a));
+	memcpy(rv2b, v2b, sizeof(v2b));
+	memcpy(rv3a, v3a, sizeof(v3a));
+	memcpy(rv3b, v3b, sizeof(v3b));
+	memcpy(rv3c, v3c, sizeof(v3c));
+	memcpy(rv3d, v3d, sizeof(v3d));
+	memcpy(rma, ma, sizeof(ma));
+	memcpy(rmb, mb, sizeof(mb));
+	memcpy(rmaff, maff, sizeof(maff));
+	memcpy(rmrigid, mrigid, sizeof(mrigid));
+	memcpy(rqa, qa, sizeof(qa));
+	memcpy(rqb, qb, sizeof(qb));
+	memcpy(rtris, tris, sizeof(tris));
+}
+
+// ---------------------------------------------------------------------------
+// BENCHMARKS
+
+// One run applies the statement to every element, results go to the out arrays so
+// nothing is optimized away. Loops are throughput, the compiler is free
+// to unroll or vectorize them for either library
+#define BENCH(id, ...)                         \
+	static void id(void)                       \
+	{                                          \
+		for (size_t i = 0; i < BENCH_N; i++) { \
+			__VA_ARGS__;                       \
+		}                                      \
+	}
+
+// FLOAT
+BENCH(ivy_fclamp, fout[i] = fclamp(fa[i], 1.0f, 3.0f))
+BENCH(rm_fclamp, fout[i] = Clamp(fa[i], 1.0f, 3.0f))
+BENCH(ivy_flerp, fout[i] = flerp(fa[i], fb[i], fc[i]))
+BENCH(rm_flerp, fout[i] = Lerp(fa[i], fb[i], fc[i]))
+BENCH(ivy_fnormalize, fout[i] = fnormalize(fa[i], 0.25f, 4.0f))
+BENCH(rm_fnormalize, fout[i] = Normalize(fa[i], 0.25f, 4.0f))
+BENCH(ivy_fremap, fout[i] = fremap(fa[i], 0.25f, 4.0f, -1.0f, 1.0f))
+BENCH(rm_fremap, fout[i] = Remap(fa[i], 0.25f, 4.0f, -1.0f, 1.0f))
+BENCH(ivy_fwrap, fout[i] = fwrap(fa[i], 1.0f, 2.0f))
+BENCH(rm_fwrap, fout[i] = Wrap(fa[i], 1.0f, 2.0f))
+BENCH(ivy_fequal, iout[i] = fequal(fa[i], fb[i]))
+BENCH(rm_fequal, iout[i] = FloatEquals(fa[i], fb[i]))
+BENCH(ivy_fsq, fout[i] = fsq(fa[i]))
+BENCH(ivy_deg_to_rad, fout[i] = deg_to_rad(fa[i]))
+
+// FAST FLOAT, libm is the baseline as raymath calls it too
+BENCH(libm_sin, fout[i] = sinf(fa[i]))
+BENCH(ivy_sin, fout[i] = fsin_fast(fa[i]))
+BENCH(libm_cos, fout[i] = cosf(fa[i]))
+BENCH(ivy_cos, fout[i] = fcos_fast(fa[i]))
+BENCH(libm_exp, fout[i] = expf(fa[i]))
+BENCH(ivy_exp, fout[i] = fexp_fast(fa[i]))
+BENCH(libm_log, fout[i] = logf(fa[i]))
+BENCH(ivy_log, fout[i] = flog_fast(fa[i]))
+BENCH(libm_atan2, fout[i] = atan2f(fa[i] - 2.0f, fb[i] - 2.0f))
+BENCH(ivy_atan2, fout[i] = fatan2_fast(fa[i] - 2.0f, fb[i] - 2.0f))
+BENCH(libm_rsqrt, fout[i] = 1.0f / sqrtf(fa[i]))
+BENCH(ivy_rsqrt, fout[i] = frsqrt_fast(fa[i]))
+
+// Packets step by their width, BENCH_N is a multiple of both
+#define BENCH_PACKET(id, N, expr)                        \
+	static void id(void)                                 \
+	{                                                    \
+		for (size_t i = 0; i < BENCH_N; i += N) {        \
+			floatx##N##_t a = floatx##N##_load(fa + i);  \
+			floatx##N##_t b = floatx##N##_load(fb + i);  \
+			floatx##N##_store(fout + i, expr);           \
+			(void)b;                                     \
+		}                                                \
+	}
+
+BENCH_PACKET(ivy_x4_sin, 4, floatx4_sin_fast(a))
+BENCH_PACKET(ivy_x8_sin, 8, floatx8_sin_fast(a))
+BENCH_PACKET(ivy_x4_cos, 4, floatx4_cos_fast(a))
+BENCH_PACKET(ivy_x8_cos, 8, floatx8_cos_fast(a))
+BENCH_PACKET(ivy_x4_exp, 4, floatx4_exp_fast(a))
+BENCH_PACKET(ivy_x8_exp, 8, floatx8_exp_fast(a))
+BENCH_PACKET(ivy_x4_log, 4, floatx4_log_fast(a))
+BENCH_PACKET(ivy_x8_log, 8, floatx8_log_fast(a))
+BENCH_PACKET(ivy_x4_atan2, 4, floatx4_atan2_fast(floatx4_sub(a, floatx4_set1(2.0f)), floatx4_sub(b, floatx4_set1(2.0f))))
+BENCH_PACKET(ivy_x8_atan2, 8, floatx8_atan2_fast(floatx8_sub(a, floatx8_set1(2.0f)), floatx8_sub(b, floatx8_set1(2.0f))))
+BENCH_PACKET(ivy_x4_rsqrt, 4, floatx4_rsqrt_fast(a))
+BENCH_PACKET(ivy_x8_rsqrt, 8, floatx8_rsqrt_fast(a))
+
+// VECTOR2
+BENCH(ivy_vec2_add, v2out[i] = vec2_add(v2a[i], v2b[i]))
+BENCH(rm_vec2_add, rv2out[i] = Vector2Add(rv2a[i], rv2b[i]))
+BENCH(ivy_vec2_sub, v2out[i] = vec2_sub(v2a[i], v2b[i]))
+BENCH(rm_vec2_sub, rv2out[i] = Vector2Subtract(rv2a[i], rv2b[i]))
+BENCH(ivy_vec2_mul, v2out[i] = vec2_mul(v2a[i], v2b[i]))
+BENCH(rm_vec2_mul, rv2out[i] = Vector2Multiply(rv2a[i], rv2b[i]))
+BENCH(ivy_vec2_addv, v2out[i] = vec2_addv(v2a[i], fa[i]))
+BENCH(rm_vec2_addv, rv2out[i] = Vector2AddValue(rv2a[i], fa[i]))
+BENCH(ivy_vec2_subv, v2out[i] = vec2_subv(v2a[i], fa[i]))
+BENCH(rm_vec2_subv, rv2out[i] = Vector2SubtractValue(rv2a[i], fa[i]))
+BENCH(ivy_vec2_mulv, v2out[i] = vec2_mulv(v2a[i], fa[i]))
+BENCH(rm_vec2_mulv, rv2out[i] = Vector2Scale(rv2a[i], fa[i]))
+BENCH(ivy_vec2_divv, v2out[i] = vec2_divv(v2a[i], fa[i]))
+BENCH(rm_vec2_divv, rv2out[i] = Vector2Scale(rv2a[i], 1.0f / fa[i]))
+BENCH(ivy_vec2_lensq, fout[i] = vec2_lensq(v2a[i]))
+BENCH(rm_vec2_lensq, fout[i] = Vector2LengthSqr(rv2a[i]))
+BENCH(ivy_vec2_len, fout[i] = vec2_len(v2a[i]))
+BENCH(rm_vec2_len, fout[i] = Vector2Length(rv2a[i]))
+BENCH(ivy_vec2_distsq, fout[i] = vec2_distsq(v2a[i], v2b[i]))
+BENCH(rm_vec2_distsq, fout[i] = Vector2DistanceSqr(rv2a[i], rv2b[i]))
+BENCH(ivy_vec2_dist, fout[i] = vec2_dist(v2a[i], v2b[i]))
+BENCH(rm_vec2_dist, fout[i] = Vector2Distance(rv2a[i], rv2b[i]))
+BENCH(ivy_vec2_wrap, v2out[i] = vec2_wrap2(v2a[i], -1.0f, 1.0f))
+BENCH(rm_vec2_wrap, rv2out[i] = (Vector2){Wrap(rv2a[i].x, -1.0f, 1.0f), Wrap(rv2a[i].y, -1.0f, 1.0f)})
+BENCH(ivy_vec2_clamp, v2out[i] = vec2_clamp2(v2a[i], -1.0f, 1.0f))
+BENCH(rm_vec2_clamp, rv2out[i] = Vector2Clamp(rv2a[i], (Vector2){-1.0f, -1.0f}, (Vector2){1.0f, 1.0f}))
+BENCH(ivy_vec2_is_almost_eq, iout[i] = vec2_is_almost_eq(v2a[i], v2b[i]))
+BENCH(rm_vec2_is_almost_eq, iout[i] = Vector2Equals(rv2a[i], rv2b[i]))
+BENCH(ivy_vec2_lerp, v2out[i] = vec2_lerp(v2a[i], v2b[i], fc[i]))
+BENCH(rm_vec2_lerp, rv2out[i] = Vector2Lerp(rv2a[i], rv2b[i], fc[i]))
+BENCH(ivy_vec2_normalize, v2out[i] = vec2_normalize(v2a[i]))
+BENCH(rm_vec2_normalize, rv2out[i] = Vector2Normalize(rv2a[i]))
+BENCH(ivy_vec2_invert, v2out[i] = vec2_invert(v2a[i]))
+BENCH(rm_vec2_invert, rv2out[i] = Vector2Invert(rv2a[i]))
+BENCH(ivy_vec2_dot, fout[i] = vec2_dot(v2a[i], v2b[i]))
+BENCH(rm_vec2_dot, fout[i] = Vector2DotProduct(rv2a[i], rv2b[i]))
+BENCH(ivy_vec2_cross, fout[i] = vec2_cross(v2a[i], v2b[i]))
+BENCH(rm_vec2_cross, fout[i] = Vector2CrossProduct(rv2a[i], rv2b[i]))
+BENCH(ivy_vec2_angle, fout[i] = vec2_angle(v2a[i], v2b[i]))
+BENCH(rm_vec2_angle, fout[i] = Vector2Angle(rv2a[i], rv2b[i]))
+BENCH(ivy_vec2_rotate, v2out[i] = vec2_rotate(v2a[i], fc[i]))
+BENCH(rm_vec2_rotate, rv2out[i] = Vector2Rotate(rv2a[i], fc[i]))
+
+// VECTOR3
+BENCH(ivy_vec3_add, v3out[i] = vec3_add(v3a[i], v3b[i]))
+BENCH(rm_vec3_add, rv3out[i] = Vector3Add(rv3a[i], rv3b[i]))
+BENCH(ivy_vec3_sub, v3out[i] = vec3_sub(v3a[i], v3b[i]))
+BENCH(rm_vec3_sub, rv3out[i] = Vector3Subtract(rv3a[i], rv3b[i]))
+BENCH(ivy_vec3_mul, v3out[i] = vec3_mul(v3a[i], v3b[i]))
+BENCH(rm_vec3_mul, rv3out[i] = Vector3Multiply(rv3a[i], rv3b[i]))
+BENCH(ivy_vec3_div, v3out[i] = vec3_div(v3a[i], v3b[i]))
+BENCH(rm_vec3_div, rv3out[i] = Vector3Divide(rv3a[i], rv3b[i]))
+BENCH(ivy_vec3_addv, v3out[i] = vec3_addv(v3a[i], fa[i]))
+BENCH(rm_vec3_addv, rv3out[i] = Vector3AddValue(rv3a[i], fa[i]))
+BENCH(ivy_vec3_subv, v3out[i] = vec3_subv(v3a[i], fa[i]))
+BENCH(rm_vec3_subv, rv3out[i] = Vector3SubtractValue(rv3a[i], fa[i]))
+BENCH(ivy_vec3_mulv, v3out[i] = vec3_mulv(v3a[i], fa[i]))
+BENCH(rm_vec3_mulv, rv3out[i] = Vector3Scale(rv3a[i], fa[i]))
+BENCH(ivy_vec3_divv, v3out[i] = vec3_divv(v3a[i], fa[i]))
+BENCH(rm_vec3_divv, rv3out[i] = Vector3Scale(rv3a[i], 1.0f / fa[i]))
+BENCH(ivy_vec3_lensq, fout[i] = vec3_lensq(v3a[i]))
+BENCH(rm_vec3_lensq, fout[i] = Vector3LengthSqr(rv3a[i]))
+BENCH(ivy_vec3_len, fout[i] = vec3_len(v3a[i]))
+BENCH(rm_vec3_len, fout[i] = Vector3Length(rv3a[i]))
+BENCH(ivy_vec3_distsq, fout[i] = vec3_distsq(v3a[i], v3b[i]))
+BENCH(rm_vec3_distsq, fout[i] = Vector3DistanceSqr(rv3a[i], rv3b[i]))
+BENCH(ivy_vec3_dist, fout[i] = vec3_dist(v3a[i], v3b[i]))
+BENCH(rm_vec3_dist, fout[i] = Vector3Distance(rv3a[i], rv3b[i]))
+BENCH(ivy_vec3_is_equal, iout[i] = vec3_is_equal(v3a[i], v3b[i]))
+BENCH(rm_vec3_is_equal, iout[i] = Vector3Equals(rv3a[i], rv3b[i]))
+BENCH(ivy_vec3_lerp, v3out[i] = vec3_lerp(v3a[i], v3b[i], fc[i]))
+BENCH(rm_vec3_lerp, rv3out[i] = Vector3Lerp(rv3a[i], rv3b[i], fc[i]))
+BENCH(ivy_vec3_min, v3out[i] = vec3_min(v3a[i], v3b[i]))
+BENCH(rm_vec3_min, rv3out[i] = Vector3Min(rv3a[i], rv3b[i]))
+BENCH(ivy_vec3_max, v3out[i] = vec3_max(v3a[i], v3b[i]))
+BENCH(rm_vec3_max, rv3out[i] = Vector3Max(rv3a[i], rv3b[i]))
+BENCH(ivy_vec3_normalize, v3out[i] = vec3_normalize(v3a[i]))
+BENCH(rm_vec3_normalize, rv3out[i] = Vector3Normalize(rv3a[i]))
+BENCH(ivy_vec3_invert, v3out[i] = vec3_invert(v3a[i]))
+BENCH(rm_vec3_invert, rv3out[i] = Vector3Invert(rv3a[i]))
+BENCH(ivy_vec3_dot, fout[i] = vec3_dot(v3a[i], v3b[i]))
+BENCH(rm_vec3_dot, fout[i] = Vector3DotProduct(rv3a[i], rv3b[i]))
+BENCH(ivy_vec3_cross, v3out[i] = vec3_cross(v3a[i], v3b[i]))
+BENCH(rm_vec3_cross, rv3out[i] = Vector3CrossProduct(rv3a[i], rv3b[i]))
+BENCH(ivy_vec3_transform, v3out[i] = vec3_transform(v3a[i], ma[i]))
+BENCH(rm_vec3_transform, rv3out[i] = Vector3Transform(rv3a[i], rma[i]))
+BENCH(ivy_vec3_angle, fout[i] = vec3_angle(v3a[i], v3b[i]))
+BENCH(rm_vec3_angle, fout[i] = Vector3Angle(rv3a[i], rv3b[i]))
+BENCH(ivy_vec3_rotate_axis, v3out[i] = vec3_rotate_axis(v3a[i], v3b[i], fc[i]))
+BENCH(rm_vec3_rotate_axis, rv3out[i] = Vector3RotateByAxisAngle(rv3a[i], rv3b[i], fc[i]))
+BENCH(ivy_vec3_barycentric, v3out[i] = vec3_barycentric(v3a[i], v3b[i], v3c[i], v3d[i]))
+BENCH(rm_vec3_barycentric, rv3out[i] = Vector3Barycenter(rv3a[i], rv3b[i], rv3c[i], rv3d[i]))
+BENCH(ivy_vec3_reflect, v3out[i] = vec3_reflect(v3a[i], v3b[i]))
+BENCH(rm_vec3_reflect, rv3out[i] = Vector3Reflect(rv3a[i], rv3b[i]))
+
+// MATRIX4, general matrices unless named affine or rigid
+BENCH(ivy_mat4_mul, mout[i] = mat4_mul(ma[i], mb[i]))
+BENCH(ivy_p_mat4_mul, mat4_mul_p(&mout[i], &ma[i], &mb[i]))
+BENCH(rm_mat4_mul, rmout[i] = MatrixMultiply(rma[i], rmb[i]))
+BENCH(ivy_mat4_transpose, mout[i] = mat4_transpose(ma[i]))
+BENCH(ivy_p_mat4_transpose, mat4_transpose_p(&mout[i], &ma[i]))
+BENCH(rm_mat4_transpose, rmout[i] = MatrixTranspose(rma[i]))
+BENCH(ivy_mat4_inverse, mout[i] = mat4_inverse(ma[i]))
+BENCH(ivy_p_mat4_inverse, mat4_inverse_p(&mout[i], &ma[i]))
+BENCH(rm_mat4_inverse, rmout[i] = MatrixInvert(rma[i]))
+BENCH(ivy_mat4_inverse_affine, mout[i] = mat4_inverse(maff[i]))
+BENCH(rm_mat4_inverse_affine, rmout[i] = MatrixInvert(rmaff[i]))
+BENCH(ivy_mat4_inverse_rigid, mout[i] = mat4_inverse_rigid(mrigid[i]))
+BENCH(rm_mat4_inverse_rigid, rmout[i] = MatrixInvert(rmrigid[i]))
+BENCH(ivy_mat4_translate, mout[i] = mat4_translate(v3a[i]))
+BENCH(rm_mat4_translate, rmout[i] = MatrixTranslate(rv3a[i].x, rv3a[i].y, rv3a[i].z))
+BENCH(ivy_mat4_scale, mout[i] = mat4_scale(v3a[i]))
+BENCH(rm_mat4_scale, rmout[i] = MatrixScale(rv3a[i].x, rv3a[i].y, rv3a[i].z))
+BENCH(ivy_mat4_rotate_x, mout[i] = mat4_rotate_x(fc[i]))
+BENCH(rm_mat4_rotate_x, rmout[i] = MatrixRotateX(fc[i]))
+BENCH(ivy_mat4_rotate_y, mout[i] = mat4_rotate_y(fc[i]))
+BENCH(rm_mat4_rotate_y, rmout[i] = MatrixRotateY(fc[i]))
+BENCH(ivy_mat4_rotate_z, mout[i] = mat4_rotate_z(fc[i]))
+BENCH(rm_mat4_rotate_z, rmout[i] = MatrixRotateZ(fc[i]))
+BENCH(ivy_mat4_rotate_axis, mout[i] = mat4_rotate_axis(v3a[i], fc[i]))
+BENCH(rm_mat4_rotate_axis, rmout[i] = MatrixRotate(rv3a[i], fc[i]))
+BENCH(ivy_mat4_lookat, mout[i] = mat4_lookat_rh(v3a[i], v3b[i], vec3(0.0f, 1.0f, 0.0f)))
+BENCH(rm_mat4_lookat, rmout[i] = MatrixLookAt(rv3a[i], rv3b[i], (Vector3){0.0f, 1.0f, 0.0f}))
+BENCH(ivy_mat4_ortho, mout[i] = mat4_ortho(-fa[i], fa[i], -fb[i], fb[i], 0.1f, 100.0f))
+BENCH(rm_mat4_ortho, rmout[i] = MatrixOrtho(-fa[i], fa[i], -fb[i], fb[i], 0.1f, 100.0f))
+BENCH(ivy_mat4_perspective, mout[i] = mat4_perspective(fc[i] + 0.5f, fa[i], 0.1f, 100.0f))
+BENCH(rm_mat4_perspective, rmout[i] = MatrixPerspective(fc[i] + 0.5f, fa[i], 0.1f, 100.0f))
+BENCH(ivy_mat4_is_affine, iout[i] = mat4_is_affine(&maff[i]))
+
+// AFFINE, raymath has no affine type so it does the same work on Matrix
+BENCH(ivy_affine_mul, aout[i] = affine_mul(aa[i], ab[i]))
+BENCH(rm_affine_mul, rmout[i] = MatrixMultiply(rmaff[i], rmrigid[i]))
+BENCH(ivy_affine_inverse, aout[i] = affine_inverse(aa[i]))
+BENCH(rm_affine_inverse, rmout[i] = MatrixInvert(rmaff[i]))
+BENCH(ivy_affine_inverse_rigid, aout[i] = affine_inverse_rigid(arigid[i]))
+BENCH(rm_affine_inverse_rigid, rmout[i] = MatrixInvert(rmrigid[i]))
+BENCH(ivy_affine_transform, v3out[i] = affine_transform(v3a[i], aa[i]))
+BENCH(rm_affine_transform, rv3out[i] = Vector3Transform(rv3a[i], rmaff[i]))
+BENCH(ivy_affine_transform_dir, v3out[i] = affine_transform_dir(v3a[i], aa[i]))
+BENCH(ivy_affine_lookat, aout[i] = affine_lookat_rh(v3a[i], v3b[i], vec3(0.0f, 1.0f, 0.0f)))
+BENCH(rm_affine_lookat, rmout[i] = MatrixLookAt(rv3a[i], rv3b[i], (Vector3){0.0f, 1.0f, 0.0f}))
+BENCH(ivy_affine_from_mat4, aout[i] = affine_from_mat4(maff[i]))
+BENCH(ivy_affine_to_mat4, mout[i] = affine_to_mat4(aa[i]))
+
+// QUATERNION
+BENCH(ivy_quat_mul, qout[i] = quat_mul(qa[i], qb[i]))
+BENCH(rm_quat_mul, rqout[i] = QuaternionMultiply(rqa[i], rqb[i]))
+BENCH(ivy_quat_normalize, qout[i] = quat_normalize(qa[i]))
+BENCH(rm_quat_normalize, rqout[i] = QuaternionNormalize(rqa[i]))
+BENCH(ivy_quat_nlerp, qout[i] = quat_nlerp(qa[i], qb[i], fc[i]))
+BENCH(rm_quat_nlerp, rqout[i] = QuaternionNlerp(rqa[i], rqb[i], fc[i]))
+BENCH(ivy_quat_slerp, qout[i] = quat_slerp(qa[i], qb[i], fc[i]))
+BENCH(rm_quat_slerp, rqout[i] = QuaternionSlerp(rqa[i], rqb[i], fc[i]))
+BENCH(ivy_quat_from_axis_angle, qout[i] = quat_from_axis_angle(v3a[i], fc[i]))
+BENCH(rm_quat_from_axis_angle, rqout[i] = QuaternionFromAxisAngle(rv3a[i], fc[i]))
+BENCH(ivy_quat_to_mat4, mout[i] = quat_to_mat4(qa[i]))
+BENCH(rm_quat_to_mat4, rmout[i] = QuaternionToMatrix(rqa[i]))
+BENCH(ivy_quat_from_mat4, qout[i] = quat_from_mat4(mrigid[i]))
+BENCH(rm_quat_from_mat4, rqout[i] = QuaternionFromMatrix(rmrigid[i]))
+BENCH(ivy_quat_rotate_vec3, v3out[i] = quat_rotate_vec3(qa[i], v3a[i]))
+BENCH(rm_quat_rotate_vec3, rv3out[i] = Vector3RotateByQuaternion(rv3a[i], rqa[i]))
+BENCH(ivy_quat_dot, fout[i] = quat_dot(qa[i], qb[i]))
+BENCH(ivy_quat_conjugate, qout[i] = quat_conjugate(qa[i]))
+
+// VEC3 ARRAYS, ivy_batch entries share the group of the scalar function
+// they replace. A run is one call over the whole buffer
+static void ivy_batch_vec3_add(void)
+{
+	vec3_array_add(v3out, v3a, v3b, BENCH_N);
+}
+
+static void ivy_batch_vec3_mulv(void)
+{
+	vec3_array_scale(v3out, v3a, 1.5f, BENCH_N);
+}
+
+static void ivy_batch_vec3_normalize(void)
+{
+	vec3_array_normalize(v3out, v3a, BENCH_N);
+}
+
+static void ivy_batch_vec3_dot(void)
+{
+	vec3_array_dot(fout, v3a, v3b, BENCH_N);
+}
+
+static void ivy_batch_quat_rotate_vec3(void)
+{
+	quat_rotate_array(v3out, qa[0], v3a, BENCH_N);
+}
+
+static void ivy_batch_vec3_bounds(void)
+{
+	vec3_array_bounds(v3a, BENCH_N, &v3out[0], &v3out[1]);
+}
+
+static void ivy_vec3_bounds(void)
+{
+	vec3_t min = v3a[0], max = v3a[0];
+	for (size_t i = 1; i < BENCH_N; i++) {
+		min = vec3_min(min, v3a[i]);
+		max = vec3_max(max, v3a[i]);
+	}
+	v3out[0] = min, v3out[1] = max;
+}
+
+static void rm_vec3_bounds(void)
+{
+	Vector3 min = rv3a[0], max = rv3a[0];
+	for (size_t i = 1; i < BENCH_N; i++) {
+		min = Vector3Min(min, rv3a[i]);
+		max = Vector3Max(max, rv3a[i]);
+	}
+	rv3out[0] = min, rv3out[1] = max;
+}
+
+// Face normals read BENCH_N / 3 packed triangles out of the vec3 inputs
+static void ivy_batch_vec3_face_normals(void)
+{
+	vec3_array_face_normals(v3out, 1, v3a, 3, BENCH_N / 3);
+}
+
+static void ivy_vec3_face_normals(void)
+{
+	for (size_t i = 0; i < BENCH_N / 3; i++) {
+		const vec3_t *p = &v3a[i * 3];
+		v3out[i] = vec3_normalize(vec3_cross(vec3_sub(p[1], p[0]), vec3_sub(p[2], p[0])));
+	}
+}
+
+static void rm_vec3_face_normals(void)
+{
+	for (size_t i = 0; i < BENCH_N / 3; i++) {
+		const Vector3 *p = &rv3a[i * 3];
+		rv3out[i] = Vector3Normalize(Vector3CrossProduct(Vector3Subtract(p[1], p[0]), Vector3Subtract(p[2], p[0])));
+	}
+}
+
+// RAY, one ray against every triangle per run, the ray changes between
+// runs so the branchy versions can not learn a single pattern
+
+// Moller-Trumbore the way raylib's GetRayCollisionTriangle writes it on
+// top of raymath, keeping the closest hit
+static void rm_ray_triangles(void)
+{
+	ray_t ray = rays[ray_next++ % BENCH_RAYS];
+	Vector3 origin = {ray.origin.x, ray.origin.y, ray.origin.z}, dir = {ray.dir.x, ray.dir.y, ray.dir.z};
+	ray_hit_t hit = {INFINITY, 0.0f, 0.0f, 0};
+	for (size_t i = 0; i < BENCH_N; i++) {
+		const Vector3 *p = &rtris[i * 3];
+		Vector3 e1 = Vector3Subtract(p[1], p[0]), e2 = Vector3Subtract(p[2], p[0]);
+		Vector3 pv = Vector3CrossProduct(dir, e2);
+		float det = Vector3DotProduct(e1, pv);
+		if (det > -EPSILON && det < EPSILON) {
+			continue;
+		}
+		float inv = 1.0f / det;
+		Vector3 tv = Vector3Subtract(origin, p[0]);
+		float u = Vector3DotProduct(tv, pv) * inv;
+		if (u < 0.0f || u > 1.0f) {
+			continue;
+		}
+		Vector3 qv = Vector3CrossProduct(tv, e1);
+		float v = Vector3DotProduct(dir, qv) * inv;
+		if (v < 0.0f || u + v > 1.0f) {
+			continue;
+		}
+		float t = Vector3DotProduct(e2, qv) * inv;
+		if (t > EPSILON && t < hit.t) {
+			hit = (ray_hit_t){t, u, v, i};
+		}
+	}
+	ray_result = hit;
+}
+
+static void ivy_batch_ray_triangles(void)
+{
+	ray_hit_t hit = {INFINITY, 0.0f, 0.0f, 0};
+	ray_triangles_closest(rays[ray_next++ % BENCH_RAYS], tris, 3, BENCH_N, &hit);
+	ray_result = hit;
+}
+
+static void ivy_packed_ray_triangles(void)
+{
+	ray_hit_t hit = {INFINITY, 0.0f, 0.0f, 0};
+	ray_tri8_leaf(rays[ray_next++ % BENCH_RAYS], packets, BENCH_N / 8, 0, &hit);
+	ray_result = hit;
+}
+
+static void ivy_tri8_pack(void)
+{
+	tri8_pack(packets, tris, 3, BENCH_N);
+}
+
+// FRUSTUM, raymath has nothing to compare with so the per volume test is
+// the baseline of the batch versions
+static void ivy_frustum_spheres(void)
+{
+	size_t n = 0;
+	for (size_t i = 0; i < BENCH_N; i++) {
+		visible[n] = i;
+		n += frustum_sphere_visible(&frustum, sphere_centers[i], fa[i]);
+	}
+	visible_count = n;
+}
+
+static void ivy_batch_frustum_spheres(void)
+{
+	visible_count = frustum_cull_spheres(&frustum, sphere_centers, fa, BENCH_N, visible);
+}
+
+static void ivy_frustum_aabbs(void)
+{
+	size_t n = 0;
+	for (size_t i = 0; i < BENCH_N; i++) {
+		visible[n] = i;
+		n += frustum_aabb_visible(&frustum, box_mins[i], box_maxs[i]);
+	}
+	visible_count = n;
+}
+
+static void ivy_batch_frustum_aabbs(void)
+{
+	visible_count = frustum_cull_aabbs(&frustum, box_mins, box_maxs, BENCH_N, visible);
+}
+
+BENCH(ivy_frustum_from_mat4, frustums[i] = frustum_from_mat4(ma[i]))
+
+// ---------------------------------------------------------------------------
+// HARNESS
+
+typedef struct {
+	const char *group;
+	const char *impl;
+	void (*run)(void);
+	// Operations in one run, results are per operation
+	size_t ops;
+} bench_t;
+
+#define IVY(group) {#group, "ivy", ivy_##group, BENCH_N}
+#define IVY_P(group) {#group, "ivy_p", ivy_p_##group, BENCH_N}
+#define IVY_X4(group) {#group, "ivy_x4", ivy_x4_##group, BENCH_N}
+#define IVY_X8(group) {#group, "ivy_x8", ivy_x8_##group, BENCH_N}
+#define IVY_BATCH(group) {#group, "ivy_batch", ivy_batch_##group, BENCH_N}
+#define RM(group) {#group, "raymath", rm_##group, BENCH_N}
+#define LIBM(group) {#group, "libm", libm_##group, BENCH_N}
+
+static const bench_t benches[] = {
+	RM(fclamp), IVY(fclamp),
+	RM(flerp), IVY(flerp),
+	RM(fnormalize), IVY(fnormalize),
+	RM(fremap), IVY(fremap),
+	RM(fwrap), IVY(fwrap),
+	RM(fequal), IVY(fequal),
+	IVY(fsq),
+	IVY(deg_to_rad),
+
+	LIBM(sin), IVY(sin), IVY_X4(sin), IVY_X8(sin),
+	LIBM(cos), IVY(cos), IVY_X4(cos), IVY_X8(cos),
+	LIBM(exp), IVY(exp), IVY_X4(exp), IVY_X8(exp),
+	LIBM(log), IVY(log), IVY_X4(log), IVY_X8(log),
+	LIBM(atan2), IVY(atan2), IVY_X4(atan2), IVY_X8(atan2),
+	LIBM(rsqrt), IVY(rsqrt), IVY_X4(rsqrt), IVY_X8(rsqrt),
+
+	RM(vec2_add), IVY(vec2_add),
+	RM(vec2_sub), IVY(vec2_sub),
+	RM(vec2_mul), IVY(vec2_mul),
+	RM(vec2_addv), IVY(vec2_addv),
+	RM(vec2_subv), IVY(vec2_subv),
+	RM(vec2_mulv), IVY(vec2_mulv),
+	RM(vec2_divv), IVY(vec2_divv),
+	RM(vec2_lensq), IVY(vec2_lensq),
+	RM(vec2_len), IVY(vec2_len),
+	RM(vec2_distsq), IVY(vec2_distsq),
+	RM(vec2_dist), IVY(vec2_dist),
+	RM(vec2_wrap), IVY(vec2_wrap),
+	RM(vec2_clamp), IVY(vec2_clamp),
+	RM(vec2_is_almost_eq), IVY(vec2_is_almost_eq),
+	RM(vec2_lerp), IVY(vec2_lerp),
+	RM(vec2_normalize), IVY(vec2_normalize),
+	RM(vec2_invert), IVY(vec2_invert),
+	RM(vec2_dot), IVY(vec2_dot),
+	RM(vec2_cross), IVY(vec2_cross),
+	RM(vec2_angle), IVY(vec2_angle),
+	RM(vec2_rotate), IVY(vec2_rotate),
+
+	RM(vec3_add), IVY(vec3_add), IVY_BATCH(vec3_add),
+	RM(vec3_sub), IVY(vec3_sub),
+	RM(vec3_mul), IVY(vec3_mul),
+	RM(vec3_div), IVY(vec3_div),
+	RM(vec3_addv), IVY(vec3_addv),
+	RM(vec3_subv), IVY(vec3_subv),
+	RM(vec3_mulv), IVY(vec3_mulv), IVY_BATCH(vec3_mulv),
+	RM(vec3_divv), IVY(vec3_divv),
+	RM(vec3_lensq), IVY(vec3_lensq),
+	RM(vec3_len), IVY(vec3_len),
+	RM(vec3_distsq), IVY(vec3_distsq),
+	RM(vec3_dist), IVY(vec3_dist),
+	RM(vec3_is_equal), IVY(vec3_is_equal),
+	RM(vec3_lerp), IVY(vec3_lerp),
+	RM(vec3_min), IVY(vec3_min),
+	RM(vec3_max), IVY(vec3_max),
+	RM(vec3_normalize), IVY(vec3_normalize), IVY_BATCH(vec3_normalize),
+	RM(vec3_invert), IVY(vec3_invert),
+	RM(vec3_dot), IVY(vec3_dot), IVY_BATCH(vec3_dot),
+	RM(vec3_cross), IVY(vec3_cross),
+	RM(vec3_transform), IVY(vec3_transform),
+	RM(vec3_angle), IVY(vec3_angle),
+	RM(vec3_rotate_axis), IVY(vec3_rotate_axis),
+	RM(vec3_barycentric), IVY(vec3_barycentric),
+	RM(vec3_reflect), IVY(vec3_reflect),
+	RM(vec3_bounds), IVY(vec3_bounds), IVY_BATCH(vec3_bounds),
+	{"vec3_face_normals", "raymath", rm_vec3_face_normals, BENCH_N / 3},
+	{"vec3_face_normals", "ivy", ivy_vec3_face_normals, BENCH_N / 3},
+	{"vec3_face_normals", "ivy_batch", ivy_batch_vec3_face_normals, BENCH_N / 3},
+
+	RM(mat4_mul), IVY(mat4_mul), IVY_P(mat4_mul),
+	RM(mat4_transpose), IVY(mat4_transpose), IVY_P(mat4_transpose),
+	RM(mat4_inverse), IVY(mat4_inverse), IVY_P(mat4_inverse),
+	RM(mat4_inverse_affine), IVY(mat4_inverse_affine),
+	RM(mat4_inverse_rigid), IVY(mat4_inverse_rigid),
+	RM(mat4_translate), IVY(mat4_translate),
+	RM(mat4_scale), IVY(mat4_scale),
+	RM(mat4_rotate_x), IVY(mat4_rotate_x),
+	RM(mat4_rotate_y), IVY(mat4_rotate_y),
+	RM(mat4_rotate_z), IVY(mat4_rotate_z),
+	RM(mat4_rotate_axis), IVY(mat4_rotate_axis),
+	RM(mat4_lookat), IVY(mat4_lookat),
+	RM(mat4_ortho), IVY(mat4_ortho),
+	RM(mat4_perspective), IVY(mat4_perspective),
+	IVY(mat4_is_affine),
+
+	RM(affine_mul), IVY(affine_mul),
+	RM(affine_inverse), IVY(affine_inverse),
+	RM(affine_inverse_rigid), IVY(affine_inverse_rigid),
+	RM(affine_transform), IVY(affine_transform),
+	IVY(affine_transform_dir),
+	RM(affine_lookat), IVY(affine_lookat),
+	IVY(affine_from_mat4),
+	IVY(affine_to_mat4),
+
+	RM(quat_mul), IVY(quat_mul),
+	RM(quat_normalize), IVY(quat_normalize),
+	RM(quat_nlerp), IVY(quat_nlerp),
+	RM(quat_slerp), IVY(quat_slerp),
+	RM(quat_from_axis_angle), IVY(quat_from_axis_angle),
+	RM(quat_to_mat4), IVY(quat_to_mat4),
+	RM(quat_from_mat4), IVY(quat_from_mat4),
+	RM(quat_rotate_vec3), IVY(quat_rotate_vec3), IVY_BATCH(quat_rotate_vec3),
+	IVY(quat_dot),
+	IVY(quat_conjugate),
+
+	RM(ray_triangles), IVY_BATCH(ray_triangles),
+	{"ray_triangles", "ivy_packed", ivy_packed_ray_triangles, BENCH_N},
+	IVY(tri8_pack),
+
+	IVY(frustum_spheres), IVY_BATCH(frustum_spheres),
+	IVY(frustum_aabbs), IVY_BATCH(frustum_aabbs),
+	IVY(frustum_from_mat4),
+};
+
+typedef struct {
+	int reps;
+	double warmup_ms;
+	double sample_ms;
+	const char *filter;
+} bench_opts_t;
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Time stamp counter on x86, which ticks at a fixed reference rate that
+// can differ from the core clock under turbo or power saving
+static unsigned long long now_cycles(void)
+{
+#if defined(BENCH_TSC)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static int compare_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+// Nearest rank on sorted samples
+static double percentile(const double *sorted, int count, double p)
+{
+	return sorted[(int)(p * (count - 1) + 0.5)];
+}
+
+static void bench_run(const bench_t *b, const bench_opts_t *o)
+{
+	// Warmup brings caches, branch predictors and clocks up to speed, and
+	// sizes how many runs make up one sample
+	size_t runs = 0;
+	double start = now_ns(), elapsed;
+	do {
+		b->run();
+		runs++;
+	} while ((elapsed = now_ns() - start) < o->warmup_ms * 1e6);
+	size_t batch = (size_t)(runs * o->sample_ms * 1e6 / elapsed);
+	if (!batch) {
+		batch = 1;
+	}
+
+	double ns[BENCH_MAX_REPS], cycles[BENCH_MAX_REPS];
+	double ops = (double)batch * b->ops;
+	for (int r = 0; r < o->reps; r++) {
+		double t0 = now_ns();
+		unsigned long long c0 = now_cycles();
+		for (size_t k = 0; k < batch; k++) {
+			b->run();
+		}
+		unsigned long long c1 = now_cycles();
+		ns[r] = (now_ns() - t0) / ops;
+		cycles[r] = (c1 - c0) / ops;
+	}
+	bench_consume();
+	qsort(ns, o->reps, sizeof(double), compare_double);
+	qsort(cycles, o->reps, sizeof(double), compare_double);
+
+	printf("{\"group\":\"%s\",\"impl\":\"%s\",\"ops\":%zu,\"runs\":%zu,\"reps\":%d,"
+		   "\"ns_median\":%.4f,\"ns_min\":%.4f,\"ns_p10\":%.4f,\"ns_p90\":%.4f,\"ns_max\":%.4f,",
+		   b->group, b->impl, b->ops, batch, o->reps,
+		   percentile(ns, o->reps, 0.5), ns[0], percentile(ns, o->reps, 0.1), percentile(ns, o->reps, 0.9), ns[o->reps - 1]);
+#if defined(BENCH_TSC)
+	printf("\"cycles_median\":%.4f,\"cycles_p10\":%.4f,\"cycles_p90\":%.4f}\n",
+		   percentile(cycles, o->reps, 0.5), percentile(cycles, o->reps, 0.1), percentile(cycles, o->reps, 0.9));
+#else
+	printf("\"cycles_median\":null,\"cycles_p10\":null,\"cycles_p90\":null}\n");
+#endif
+	fflush(stdout);
+}
+
+static const char *simd_name(void)
+{
+#if defined(IVY_MATH_NEON)
+	return "neon";
+#elif defined(IVY_MATH_X8_AVX)
+	return "avx";
+#elif defined(IVY_MATH_SSE)
+	return "sse";
+#else
+	return "scalar";
+#endif
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-r reps] [-w warmup_ms] [-s sample_ms] [filter]\n"
+					"Prints one JSON object per line, the first describes the build and\n"
+					"the rest one implementation of a group each. filter keeps the groups\n"
+					"whose name contains it\n",
+			name);
+}
+
+int main(int argc, char **argv)
+{
+	bench_opts_t o = {21, 20.0, 2.0, NULL};
+	for (int i = 1; i < argc; i++) {
+		if (argv[i][0] == '-' && argv[i][1] && !argv[i][2] && i + 1 < argc) {
+			switch (argv[i][1]) {
+			case 'r':
+				o.reps = atoi(argv[++i]);
+				continue;
+			case 'w':
+				o.warmup_ms = atof(argv[++i]);
+				continue;
+			case 's':
+				o.sample_ms = atof(argv[++i]);
+				continue;
+			}
+		} else if (argv[i][0] != '-' && !o.filter) {
+			o.filter = argv[i];
+			continue;
+		}
+		usage(argv[0]);
+		return 1;
+	}
+	if (o.reps < 1 || o.reps > BENCH_MAX_REPS) {
+		fprintf(stderr, "reps must be between 1 and %d\n", BENCH_MAX_REPS);
+		return 1;
+	}
+
+	bench_setup();
+
+	printf("{\"suite\":\"ivy_math\",\"simd\":\"%s\",\"compiler\":\"%s\",\"n\":%d,\"reps\":%d,\"warmup_ms\":%g,\"sample_ms\":%g,\"cycles\":\"%s\"}\n",
+		   simd_name(), __VERSION__, BENCH_N, o.reps, o.warmup_ms, o.sample_ms,
+#if defined(BENCH_TSC)
+		   "tsc"
+#else
+		   "none"
+#endif
+	);
+	for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+		if (!o.filter || strstr(benches[i].group, o.filter)) {
+			bench_run(&benches[i], &o);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,75 @@
+#include "../ivy.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Build against an fbdev library, the device is faked with a file:
+// make WND_BACKEND=fbdev AUDIO_BACKEND=null
+// cc test/test_fbdev.c libivy.a -lm -lpthread -o test_fbdev
+
+#define TEST_FBDEV_PATH "ivy_test_fbdev.raw"
+#define TEST_WIDTH 64
+#define TEST_HEIGHT 48
+#define TEST_PAGE (TEST_WIDTH * TEST_HEIGHT)
+
+static pixel_t pages[2 * TEST_PAGE];
+
+static void read_pages(void)
+{
+	FILE *f = fopen(TEST_FBDEV_PATH, "rb");
+	size_t n = f ? fread(pages, sizeof(pixel_t), 2 * TEST_PAGE, f) : 0;
+	if (f) {
+		fclose(f);
+	}
+	if (n != 2 * TEST_PAGE) {
+		memset(pages, 0, sizeof(pages));
+	}
+}
+
+// The whole page is fill except for the pixel at (x, y), which is p
+static void check_page(const char *test_name, const pixel_t *page, pixel_t fill, int x, int y, pixel_t p)
+{
+	for (int i = 0; i < TEST_PAGE; i++) {
+		pixel_t expect = i == y * TEST_WIDTH + x ? p : fill;
+		if (page[i] != expect) {
+			WARN("TEST FAILED: %s\nPixel (%d, %d)\nExpected: %08x\nGot: %08x", test_name, i % TEST_WIDTH,
+				 i / TEST_WIDTH, expect, page[i]);
+			return;
+		}
+	}
+	INFO("TEST PASSED: %s", test_name);
+}
+
+int main()
+{
+	// The fake device must exist, it is sized to two pages on open
+	FILE *f = fopen(TEST_FBDEV_PATH, "wb");
+	fclose(f);
+	setenv("IVY_FBDEV", TEST_FBDEV_PATH, 1);
+	// An empty list opens no evdev devices
+	setenv("IVY_FBDEV_INPUT", "", 1);
+
+	INFO("FBDEV -----------------------------------");
+	window_context_t wnd = wnd_create(TEST_WIDTH, TEST_HEIGHT, "test_fbdev");
+	pixel_t red = 0x00ff0000, blue = 0x000000ff;
+
+	// First frame is drawn into page 1 and presented from there
+	for (int i = 0; i < TEST_PAGE; i++) {
+		wnd.pixels.buffer[i] = red;
+	}
+	wnd_update(&wnd);
+	read_pages();
+	check_page("Fbdev first present", pages + TEST_PAGE, red, 0, 0, red);
+	check_page("Fbdev back page carries the presented frame", wnd.pixels.buffer, red, 0, 0, red);
+
+	// Only one pixel changes, the rest must still be the first frame
+	gfx_set_pixel(&wnd.pixels, 5, 7, blue);
+	wnd_update(&wnd);
+	read_pages();
+	check_page("Fbdev incremental present", pages, red, 5, 7, blue);
+	check_page("Fbdev next back page after a flip", pages + TEST_PAGE, red, 5, 7, blue);
+
+	wnd_destroy(&wnd);
+	remove(TEST_FBDEV_PATH);
+	return 0;
+}
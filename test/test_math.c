@@ -205,6 +205,415 @@ void test_mat4()
 	expect_m4 = MatrixPerspective(a.x, a.y, a.z, b.x);
 	got_m4 = mat4_perspective(a.x, a.y, a.z, b.x);
 	compare_mat4("Perspective", expect_m4, got_m4, 1);
+
+	// Random matrices are often near singular, a rigid transform is not
+	ma = MatrixMultiply(MatrixRotate(Vector3Normalize(a), theta), MatrixTranslate(b.x, b.y, b.z));
+	expect_m4 = MatrixInvert(ma);
+	got_m4 = mat4_inverse(*(mat4_t *)&ma);
+	compare_mat4("Inverse", expect_m4, got_m4, 0);
+}
+
+// The dispatched kernels against the scalar ones they replace
+void test_mat4_simd()
+{
+	Matrix ma, mb;
+	mat4_t a, b, expect, got;
+	ma = rand_mat4();
+	mb = rand_mat4();
+	a = *(mat4_t *)&ma;
+	b = *(mat4_t *)&mb;
+
+	_mat4_mul_scalar(&expect, &a, &b);
+	mat4_mul_p(&got, &a, &b);
+	compare_float_array("Multiply SIMD", (float *)&expect, (float *)&got, 16);
+
+	got = a;
+	mat4_mul_p(&got, &got, &b);
+	compare_float_array("Multiply SIMD aliased", (float *)&expect, (float *)&got, 16);
+
+	_mat4_transpose_scalar(&expect, &a);
+	mat4_transpose_p(&got, &a);
+	compare_float_array("Transpose SIMD", (float *)&expect, (float *)&got, 16);
+
+	ma = MatrixMultiply(MatrixRotate(Vector3Normalize(rand_vec3()), 0.7f), MatrixTranslate(1.0f, -2.0f, 3.0f));
+	a = *(mat4_t *)&ma;
+	_mat4_inverse_scalar(&expect, &a);
+	mat4_inverse_p(&got, &a);
+	compare_float_array("Inverse SIMD", (float *)&expect, (float *)&got, 16);
+}
+
+// Every lane of the packets against the scalar vec3 function
+void test_vec3_packets()
+{
+	vec3_t a[8], b[8], expect[8], got[8];
+	float expect_f[8], got_f[8];
+	Matrix ma = MatrixMultiply(MatrixRotate(Vector3Normalize(rand_vec3()), 0.7f), MatrixTranslate(1.0f, -2.0f, 3.0f));
+	mat4_t m = *(mat4_t *)&ma;
+	for (int i = 0; i < 8; i++) {
+		Vector3 va = rand_vec3(), vb = rand_vec3();
+		a[i] = *(vec3_t *)&va;
+		b[i] = *(vec3_t *)&vb;
+	}
+	vec3x8_t pa = vec3x8_load(a), pb = vec3x8_load(b);
+	vec3x4_t qa = vec3x4_load(a), qb = vec3x4_load(b);
+
+	for (int i = 0; i < 8; i++) {
+		expect_f[i] = vec3_dot(a[i], b[i]);
+	}
+	floatx8_store(got_f, vec3x8_dot(pa, pb));
+	compare_float_array("Dot x8", expect_f, got_f, 8);
+	floatx4_store(got_f, vec3x4_dot(qa, qb));
+	compare_float_array("Dot x4", expect_f, got_f, 4);
+
+	for (int i = 0; i < 8; i++) {
+		expect[i] = vec3_cross(a[i], b[i]);
+	}
+	vec3x8_store(got, vec3x8_cross(pa, pb));
+	compare_float_array("Cross x8", (float *)expect, (float *)got, 24);
+
+	for (int i = 0; i < 8; i++) {
+		expect[i] = vec3_normalize(a[i]);
+	}
+	vec3x8_store(got, vec3x8_normalize(pa));
+	compare_float_array("Normalize x8", (float *)expect, (float *)got, 24);
+
+	for (int i = 0; i < 8; i++) {
+		expect[i] = vec3_lerp(a[i], b[i], 0.25f);
+	}
+	vec3x8_store(got, vec3x8_lerp(pa, pb, floatx8_set1(0.25f)));
+	compare_float_array("Lerp x8", (float *)expect, (float *)got, 24);
+
+	for (int i = 0; i < 8; i++) {
+		expect[i] = vec3_transform(a[i], m);
+	}
+	vec3x8_store(got, vec3x8_transform(pa, &m));
+	compare_float_array("Transform x8", (float *)expect, (float *)got, 24);
+	vec3x4_store(got, vec3x4_transform(qa, &m));
+	compare_float_array("Transform x4", (float *)expect, (float *)got, 12);
+}
+
+// Sizes that are not a multiple of the packet width exercise the tails
+void test_vec3_arrays()
+{
+	enum { COUNT = 21 };
+	vec3_t a[COUNT], b[COUNT], expect[COUNT], got[COUNT];
+	float expect_f[COUNT], got_f[COUNT];
+	stl_face_t faces[COUNT];
+	for (int i = 0; i < COUNT; i++) {
+		Vector3 va = rand_vec3(), vb = rand_vec3(), vc = rand_vec3();
+		a[i] = *(vec3_t *)&va;
+		b[i] = *(vec3_t *)&vb;
+		faces[i].vertex1 = a[i];
+		faces[i].vertex2 = b[i];
+		faces[i].vertex3 = *(vec3_t *)&vc;
+	}
+
+	for (int i = 0; i < COUNT; i++) {
+		expect[i] = vec3_add(a[i], b[i]);
+	}
+	vec3_array_add(got, a, b, COUNT);
+	compare_float_array("Array add", (float *)expect, (float *)got, COUNT * 3);
+
+	for (int i = 0; i < COUNT; i++) {
+		expect[i] = vec3_mulv(a[i], 1.5f);
+	}
+	vec3_array_scale(got, a, 1.5f, COUNT);
+	compare_float_array("Array scale", (float *)expect, (float *)got, COUNT * 3);
+
+	for (int i = 0; i < COUNT; i++) {
+		expect[i] = vec3_normalize(a[i]);
+	}
+	vec3_array_normalize(got, a, COUNT);
+	compare_float_array("Array normalize", (float *)expect, (float *)got, COUNT * 3);
+
+	for (int i = 0; i < COUNT; i++) {
+		expect_f[i] = vec3_dot(a[i], b[i]);
+	}
+	vec3_array_dot(got_f, a, b, COUNT);
+	compare_float_array("Array dot", expect_f, got_f, COUNT);
+
+	vec3_t bounds[2], expect_bounds[2] = {a[0], a[0]};
+	for (int i = 1; i < COUNT; i++) {
+		expect_bounds[0] = vec3_min(expect_bounds[0], a[i]);
+		expect_bounds[1] = vec3_max(expect_bounds[1], a[i]);
+	}
+	vec3_array_bounds(a, COUNT, &bounds[0], &bounds[1]);
+	compare_float_array("Array bounds", (float *)expect_bounds, (float *)bounds, 6);
+
+	for (int i = 0; i < COUNT; i++) {
+		stl_face_t *f = &faces[i];
+		expect[i] = vec3_normalize(vec3_cross(vec3_sub(f->vertex2, f->vertex1), vec3_sub(f->vertex3, f->vertex1)));
+	}
+	// In place over stl_face_t, as stl_compute_normals does
+	vec3_array_face_normals(&faces[0].normal, 4, &faces[0].vertex1, 4, COUNT);
+	for (int i = 0; i < COUNT; i++) {
+		got[i] = faces[i].normal;
+	}
+	compare_float_array("Face normals", (float *)expect, (float *)got, COUNT * 3);
+	vec3_array_face_normals(got, 1, &faces[0].vertex1, 4, COUNT);
+	compare_float_array("Face normals strided", (float *)expect, (float *)got, COUNT * 3);
+}
+
+void test_quat()
+{
+	Vector3 ra = rand_vec3(), rb = rand_vec3(), rv = rand_vec3();
+	vec3_t axis_a = *(vec3_t *)&ra, axis_b = *(vec3_t *)&rb, v = *(vec3_t *)&rv;
+	quat_t qa = quat_from_axis_angle(axis_a, 0.7f);
+	quat_t qb = quat_from_axis_angle(axis_b, -1.9f);
+	mat4_t expect_m4, got_m4;
+	vec3_t expect_f3, got_f3;
+
+	expect_m4 = mat4_rotate_axis(axis_a, 0.7f);
+	got_m4 = quat_to_mat4(qa);
+	compare_float_array("Quat to mat4", (float *)&expect_m4, (float *)&got_m4, 16);
+
+	expect_f3 = vec3_rotate_axis(v, axis_a, 0.7f);
+	got_f3 = quat_rotate_vec3(qa, v);
+	compare_float_array("Quat rotate", (float *)&expect_f3, (float *)&got_f3, 3);
+
+	expect_m4 = mat4_mul(mat4_rotate_axis(axis_a, 0.7f), mat4_rotate_axis(axis_b, -1.9f));
+	got_m4 = quat_to_mat4(quat_mul(qa, qb));
+	compare_float_array("Quat multiply", (float *)&expect_m4, (float *)&got_m4, 16);
+
+	// q and -q are the same rotation, compare the matrices
+	expect_m4 = quat_to_mat4(quat_mul(qa, qb));
+	got_m4 = quat_to_mat4(quat_from_mat4(expect_m4));
+	compare_float_array("Quat from mat4", (float *)&expect_m4, (float *)&got_m4, 16);
+
+	Vector4 expect_q4 = QuaternionSlerp(*(Vector4 *)&qa, *(Vector4 *)&qb, 0.3f);
+	quat_t got_q4 = quat_slerp(qa, qb, 0.3f);
+	if (quat_dot(*(quat_t *)&expect_q4, got_q4) < 0) {
+		got_q4 = (quat_t){-got_q4.x, -got_q4.y, -got_q4.z, -got_q4.w};
+	}
+	compare_float_array("Quat slerp", (float *)&expect_q4, (float *)&got_q4, 4);
+
+	// raymath does not take the short way round, flip b for it
+	if (quat_dot(qa, qb) < 0) {
+		qb = (quat_t){-qb.x, -qb.y, -qb.z, -qb.w};
+	}
+	expect_q4 = QuaternionNlerp(*(Vector4 *)&qa, *(Vector4 *)&qb, 0.3f);
+	got_q4 = quat_nlerp(qa, qb, 0.3f);
+	compare_float_array("Quat nlerp", (float *)&expect_q4, (float *)&got_q4, 4);
+
+	enum { COUNT = 13 };
+	vec3_t points[COUNT], expect[COUNT], got[COUNT];
+	for (int i = 0; i < COUNT; i++) {
+		Vector3 p = rand_vec3();
+		points[i] = *(vec3_t *)&p;
+		expect[i] = quat_rotate_vec3(qb, points[i]);
+	}
+	quat_rotate_array(got, qb, points, COUNT);
+	compare_float_array("Quat rotate array", (float *)expect, (float *)got, COUNT * 3);
+}
+
+void test_affine()
+{
+	Vector3 ra = rand_vec3(), rb = rand_vec3(), rv = rand_vec3();
+	vec3_t a = *(vec3_t *)&ra, b = *(vec3_t *)&rb, v = *(vec3_t *)&rv;
+	mat4_t ma = mat4_mul(mat4_mul(mat4_scale(vec3(2.0f, 0.5f, 3.0f)), mat4_rotate_axis(a, 0.7f)), mat4_translate(b));
+	mat4_t mb = mat4_mul(mat4_rotate_axis(b, -1.3f), mat4_translate(a));
+	affine_t aa = affine_from_mat4(ma), ab = affine_from_mat4(mb);
+	mat4_t expect_m4, got_m4;
+	vec3_t expect_f3, got_f3;
+
+	expect_m4 = mat4_mul(ma, mb);
+	got_m4 = affine_to_mat4(affine_mul(aa, ab));
+	compare_float_array("Affine multiply", (float *)&expect_m4, (float *)&got_m4, 16);
+
+	expect_f3 = vec3_transform(v, ma);
+	got_f3 = affine_transform(v, aa);
+	compare_float_array("Affine transform", (float *)&expect_f3, (float *)&got_f3, 3);
+
+	_mat4_inverse_scalar(&expect_m4, &ma);
+	got_m4 = affine_to_mat4(affine_inverse(aa));
+	compare_float_array("Affine inverse", (float *)&expect_m4, (float *)&got_m4, 16);
+
+	mat4_inverse_p(&got_m4, &ma);
+	compare_float_array("Affine inverse general", (float *)&expect_m4, (float *)&got_m4, 16);
+
+	_mat4_inverse_scalar(&expect_m4, &mb);
+	got_m4 = mat4_inverse_rigid(mb);
+	compare_float_array("Affine inverse rigid", (float *)&expect_m4, (float *)&got_m4, 16);
+
+	expect_m4 = mat4_lookat_lh(a, b, vec3(0, 1, 0));
+	got_m4 = mat4_mul(mat4_inverse_rigid(expect_m4), expect_m4);
+	expect_m4 = mat4_identity();
+	compare_float_array("Affine lookat rigid", (float *)&expect_m4, (float *)&got_m4, 16);
+}
+
+// Deterministic sweeps over the ranges ivy_math.h documents for the fast
+// functions, the reference is libm in double
+#define FAST_SWEEP (1 << 16)
+
+static float fast_x[FAST_SWEEP], fast_y[FAST_SWEEP], fast_got[FAST_SWEEP];
+static double fast_expect[FAST_SWEEP], fast_scale[FAST_SWEEP];
+
+// Error is |got - expect| / scale, so a scale of 1 is absolute error and
+// one of |expect| relative error
+void compare_fast(const char *test_name, double bound)
+{
+	double max = 0.0;
+	int worst = 0;
+	for (int i = 0; i < FAST_SWEEP; i++) {
+		double err = fabs(fast_got[i] - fast_expect[i]) / fast_scale[i];
+		if (!(err <= max)) {
+			max = err, worst = i;
+		}
+	}
+	if (max < bound) {
+		INFO("TEST PASSED: %s, max error %g", test_name, max);
+	} else {
+		WARN("TEST FAILED: %s\nExpected: error < %g\nGot: %g at x %g y %g", test_name, bound, max, fast_x[worst], fast_y[worst]);
+	}
+}
+
+void fast_sweep_linear(float min, float max)
+{
+	for (int i = 0; i < FAST_SWEEP; i++) {
+		fast_x[i] = min + (max - min) * ((i + 0.5) / FAST_SWEEP);
+	}
+}
+
+// Every binade of normal floats gets the same number of points
+void fast_sweep_normals()
+{
+	for (int i = 0; i < FAST_SWEEP; i++) {
+		union {
+			unsigned int u;
+			float f;
+		} b = {.u = 0x00800000u + (unsigned int)((0x7f7fffffull - 0x00800000u) * i / (FAST_SWEEP - 1))};
+		fast_x[i] = b.f;
+	}
+}
+
+// Scalar, x4 and x8 forms of one function over the current sweep
+#define FAST_MATH_CASE(name, bound, scalar, x4, x8)                                                  \
+	for (int i = 0; i < FAST_SWEEP; i++) {                                                            \
+		fast_got[i] = scalar;                                                                         \
+	}                                                                                                 \
+	compare_fast(name, bound);                                                                        \
+	for (int i = 0; i < FAST_SWEEP; i += 4) {                                                         \
+		floatx4_store(fast_got + i, x4);                                                              \
+	}                                                                                                 \
+	compare_fast(name " x4", bound);                                                                  \
+	for (int i = 0; i < FAST_SWEEP; i += 8) {                                                         \
+		floatx8_store(fast_got + i, x8);                                                              \
+	}                                                                                                 \
+	compare_fast(name " x8", bound);
+
+void test_fast_math()
+{
+	float ranges[2] = {100.0f, 1e5f};
+	double sin_bounds[2] = {5e-7, 2e-6};
+	for (int r = 0; r < 2; r++) {
+		fast_sweep_linear(-ranges[r], ranges[r]);
+		for (int i = 0; i < FAST_SWEEP; i++) {
+			fast_expect[i] = sin(fast_x[i]);
+			fast_scale[i] = 1.0;
+		}
+		FAST_MATH_CASE("Fast sin", sin_bounds[r], fsin_fast(fast_x[i]), floatx4_sin_fast(floatx4_load(fast_x + i)), floatx8_sin_fast(floatx8_load(fast_x + i)))
+		for (int i = 0; i < FAST_SWEEP; i++) {
+			fast_expect[i] = cos(fast_x[i]);
+		}
+		FAST_MATH_CASE("Fast cos", sin_bounds[r], fcos_fast(fast_x[i]), floatx4_cos_fast(floatx4_load(fast_x + i)), floatx8_cos_fast(floatx8_load(fast_x + i)))
+	}
+
+	fast_sweep_linear(-87.0f, 88.0f);
+	for (int i = 0; i < FAST_SWEEP; i++) {
+		fast_expect[i] = exp(fast_x[i]);
+		fast_scale[i] = fast_expect[i];
+	}
+	FAST_MATH_CASE("Fast exp", 2e-7, fexp_fast(fast_x[i]), floatx4_exp_fast(floatx4_load(fast_x + i)), floatx8_exp_fast(floatx8_load(fast_x + i)))
+	compare_float("Fast exp clamp low", fexp_fast(-87.0f), fexp_fast(-1000.0f));
+	compare_float("Fast exp clamp high", fexp_fast(88.0f), fexp_fast(1000.0f));
+
+	fast_sweep_normals();
+	for (int i = 0; i < FAST_SWEEP; i++) {
+		fast_expect[i] = log(fast_x[i]);
+		fast_scale[i] = fmax(1.0, fabs(fast_expect[i]));
+	}
+	FAST_MATH_CASE("Fast log", 2e-7, flog_fast(fast_x[i]), floatx4_log_fast(floatx4_load(fast_x + i)), floatx8_log_fast(floatx8_load(fast_x + i)))
+	for (int i = 0; i < FAST_SWEEP; i++) {
+		fast_expect[i] = 1.0 / sqrt(fast_x[i]);
+		fast_scale[i] = fast_expect[i];
+	}
+	FAST_MATH_CASE("Fast rsqrt", 5e-6, frsqrt_fast(fast_x[i]), floatx4_rsqrt_fast(floatx4_load(fast_x + i)), floatx8_rsqrt_fast(floatx8_load(fast_x + i)))
+
+	// Full circle at radii from tiny to huge, then the axes and the origin
+	double radii[5] = {1e-30, 1e-3, 1.0, 1e3, 1e30};
+	for (int i = 0; i < FAST_SWEEP; i++) {
+		double a = -PI + 2.0 * PI * (i + 0.5) / FAST_SWEEP;
+		fast_x[i] = radii[i % 5] * cos(a);
+		fast_y[i] = radii[i % 5] * sin(a);
+	}
+	float axes[8][2] = {{0, 0}, {0, 1}, {0, -1}, {1, 0}, {-1, 0}, {-0.0f, 0}, {1e-30f, -1}, {-1e30f, 1e-30f}};
+	for (int i = 0; i < 8; i++) {
+		fast_y[i] = axes[i][0], fast_x[i] = axes[i][1];
+	}
+	for (int i = 0; i < FAST_SWEEP; i++) {
+		fast_expect[i] = atan2(fast_y[i], fast_x[i]);
+		fast_scale[i] = 1.0;
+	}
+	FAST_MATH_CASE("Fast atan2", 2e-6, fatan2_fast(fast_y[i], fast_x[i]),
+				   floatx4_atan2_fast(floatx4_load(fast_y + i), floatx4_load(fast_x + i)),
+				   floatx8_atan2_fast(floatx8_load(fast_y + i), floatx8_load(fast_x + i)))
+#undef FAST_MATH_CASE
+}
+
+void test_ray()
+{
+	// Every third face covers the ray, the later ones are closer
+	stl_face_t faces[21];
+	for (int i = 0; i < 21; i++) {
+		float z = 30.0f - i, shift = i % 3 ? 10.0f : 0.0f;
+		faces[i].normal = vec3(0, 0, -1);
+		faces[i].vertex1 = vec3(-1 + shift, -1, z);
+		faces[i].vertex2 = vec3(2 + shift, -1, z);
+		faces[i].vertex3 = vec3(-1 + shift, 2, z);
+	}
+	ray_t ray = {vec3(0.2f, 0.1f, 0), vec3(0, 0, 1)};
+	float expect[4] = {12.0f, 0.4f, 1.1f / 3.0f, 18};
+
+	ray_hit_t hit = {INFINITY, 0.0f, 0.0f, 0};
+	ray_triangles_closest(ray, &faces->vertex1, 4, 21, &hit);
+	float got[4] = {hit.t, hit.u, hit.v, hit.index};
+	compare_float_array("Ray brute force", expect, got, 4);
+
+	tri8_t packets[3];
+	tri8_pack(packets, &faces->vertex1, 4, 21);
+	hit = (ray_hit_t){INFINITY, 0.0f, 0.0f, 0};
+	ray_tri8_leaf(ray, packets, tri8_count(21), 0, &hit);
+	float got_leaf[4] = {hit.t, hit.u, hit.v, hit.index};
+	compare_float_array("Ray leaf", expect, got_leaf, 4);
+
+	hit = (ray_hit_t){11.0f, 0.0f, 0.0f, 0};
+	compare_float("Ray max distance", 0, ray_tri8_leaf(ray, packets, tri8_count(21), 0, &hit));
+}
+
+void test_frustum()
+{
+	// 90 degree fov looking down -z, the side planes are x = +-z
+	mat4_t view = mat4_lookat_rh(vec3(0, 0, 0), vec3(0, 0, -1), vec3(0, 1, 0));
+	frustum_t f = frustum_from_mat4(mat4_mul(view, mat4_perspective(PI / 2, 1.0f, 0.1f, 100.0f)));
+	vec3_t centers[11] = {
+		{0, 0, -10}, {0, 0, 10}, {20, 0, -10}, {10.5f, 0, -10}, {0, -12.5f, -10}, {0, 0, -101.5f},
+		{0, 0, -100.5f}, {-5, 5, -50}, {0, 0, -0.5f}, {0, 0, 2}, {30, 30, -20},
+	};
+	float radii[11] = {1, 1, 1, 1, 1, 1, 1, 1, 0.1f, 1, 1};
+	unsigned int visible[11];
+	size_t n = frustum_cull_spheres(&f, centers, radii, 11, visible);
+	float expect[6] = {5, 0, 3, 6, 7, 8};
+	float got[6] = {n, visible[0], visible[1], visible[2], visible[3], visible[4]};
+	compare_float_array("Frustum spheres", expect, got, 6);
+
+	vec3_t mins[11], maxs[11];
+	for (int i = 0; i < 11; i++) {
+		mins[i] = vec3_subv(centers[i], radii[i]);
+		maxs[i] = vec3_addv(centers[i], radii[i]);
+	}
+	n = frustum_cull_aabbs(&f, mins, maxs, 11, visible);
+	got[0] = n, got[1] = visible[0], got[2] = visible[1], got[3] = visible[2], got[4] = visible[3], got[5] = visible[4];
+	compare_float_array("Frustum aabbs", expect, got, 6);
 }
 
 int main()
@@ -214,5 +623,21 @@ int main()
 	test_vec3();
 	INFO("----------------- TESTING MAT4 -----------------");
 	test_mat4();
+	INFO("----------------- TESTING MAT4 SIMD -----------------");
+	test_mat4_simd();
+	INFO("----------------- TESTING VEC3 PACKETS -----------------");
+	test_vec3_packets();
+	INFO("----------------- TESTING VEC3 ARRAYS -----------------");
+	test_vec3_arrays();
+	INFO("----------------- TESTING QUAT -----------------");
+	test_quat();
+	INFO("----------------- TESTING AFFINE -----------------");
+	test_affine();
+	INFO("----------------- TESTING FAST MATH -----------------");
+	test_fast_math();
+	INFO("----------------- TESTING RAY -----------------");
+	test_ray();
+	INFO("----------------- TESTING FRUSTUM -----------------");
+	test_frustum();
 	return 0;
 }
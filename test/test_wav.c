@@ -0,0 +1,79 @@
+#include "../ivy.h"
+#include <stdio.h>
+#include <string.h>
+
+// Build against a headless library:
+// make WND_BACKEND=headless AUDIO_BACKEND=null
+// cc test/test_wav.c libivy.a -lm -lpthread -o test_wav
+
+#define TEST_WAV_PATH "ivy_test_wav.wav"
+#define TEST_FRAMES 16
+#define TEST_CHANNELS 2
+
+static void put_u32(u8_t *p, u32_t v)
+{
+	p[0] = v, p[1] = v >> 8, p[2] = v >> 16, p[3] = v >> 24;
+}
+
+static void put_u16(u8_t *p, u16_t v)
+{
+	p[0] = v, p[1] = v >> 8;
+}
+
+// Canonical 44 byte header followed by frames of float samples, the RIFF
+// and data sizes are written as given
+static void write_wav(u32_t riff_size, u32_t data_size, const float *samples, size_t frames)
+{
+	u8_t h[44];
+	u32_t frame_size = TEST_CHANNELS * sizeof(float);
+	memcpy(h, "RIFF", 4);
+	put_u32(h + 4, riff_size);
+	memcpy(h + 8, "WAVEfmt ", 8);
+	put_u32(h + 16, 16);
+	put_u16(h + 20, 3);
+	put_u16(h + 22, TEST_CHANNELS);
+	put_u32(h + 24, 48000);
+	put_u32(h + 28, 48000 * frame_size);
+	put_u16(h + 32, frame_size);
+	put_u16(h + 34, 32);
+	memcpy(h + 36, "data", 4);
+	put_u32(h + 40, data_size);
+	FILE *f = fopen(TEST_WAV_PATH, "wb");
+	fwrite(h, 1, sizeof(h), f);
+	fwrite(samples, frame_size, frames, f);
+	fclose(f);
+}
+
+static void test_load(const char *test_name, u32_t riff_size, u32_t data_size, size_t expected_frames)
+{
+	float samples[TEST_FRAMES * TEST_CHANNELS];
+	for (int i = 0; i < TEST_FRAMES * TEST_CHANNELS; i++) {
+		samples[i] = (i - TEST_FRAMES) / (float)(TEST_FRAMES * TEST_CHANNELS);
+	}
+	write_wav(riff_size, data_size, samples, TEST_FRAMES);
+	audio_clip_t clip = audio_clip_load_wav(TEST_WAV_PATH);
+	remove(TEST_WAV_PATH);
+
+	if (clip.frames != expected_frames || clip.channels != TEST_CHANNELS || clip.sample_rate != 48000) {
+		WARN("TEST FAILED: %s\nExpected: %zu frames\nGot: %zu frames, %u channels, %u Hz", test_name,
+			 expected_frames, clip.frames, clip.channels, clip.sample_rate);
+	} else if (expected_frames && memcmp(clip.samples, samples, expected_frames * TEST_CHANNELS * sizeof(float))) {
+		WARN("TEST FAILED: %s\nSamples differ", test_name);
+	} else {
+		INFO("TEST PASSED: %s", test_name);
+	}
+	audio_clip_free(&clip);
+}
+
+int main()
+{
+	u32_t data_size = TEST_FRAMES * TEST_CHANNELS * sizeof(float);
+	INFO("WAV LOADER ------------------------------");
+	test_load("Patched header", 36 + data_size, data_size, TEST_FRAMES);
+	test_load("Shorter data chunk", 36 + data_size, data_size / 2, TEST_FRAMES / 2);
+	// Recorders that crash before patching the header
+	test_load("Unpatched zero sizes", 0, 0, TEST_FRAMES);
+	test_load("Unpatched 0xffffffff sizes", 0xffffffff, 0xffffffff, TEST_FRAMES);
+	test_load("Truncated file", 36 + data_size * 2, data_size * 2, TEST_FRAMES);
+	return 0;
+}